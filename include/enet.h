@@ -36,9 +36,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstddef>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <stdlib.h>
@@ -55,12 +63,12 @@
 #define ENET_VERSION_GET_PATCH(version) ((version)&0xFF)
 #define ENET_VERSION ENET_VERSION_CREATE(ENET_VERSION_MAJOR, ENET_VERSION_MINOR, ENET_VERSION_PATCH)
 
-#define ENET_TIME_OVERFLOW 86400000
-#define ENET_TIME_LESS(a, b) ((a) - (b) >= ENET_TIME_OVERFLOW)
-#define ENET_TIME_GREATER(a, b) ((b) - (a) >= ENET_TIME_OVERFLOW)
+#define ENET_TIME_MILLISECOND 1000 /* service time is kept in microseconds */
+#define ENET_TIME_LESS(a, b) ((std::make_signed_t<decltype((a) - (b))>) ((a) - (b)) < 0)
+#define ENET_TIME_GREATER(a, b) ENET_TIME_LESS(b, a)
 #define ENET_TIME_LESS_EQUAL(a, b) (! ENET_TIME_GREATER (a, b))
 #define ENET_TIME_GREATER_EQUAL(a, b) (! ENET_TIME_LESS (a, b))
-#define ENET_TIME_DIFFERENCE(a, b) ((a) - (b) >= ENET_TIME_OVERFLOW ? (b) - (a) : (a) - (b))
+#define ENET_TIME_DIFFERENCE(a, b) (ENET_TIME_LESS(a, b) ? (b) - (a) : (a) - (b))
 
 // =======================================================================//
 // !
@@ -168,6 +176,31 @@
     #define MSG_NOSIGNAL 0
     #endif
 
+    #if defined(__linux__) && !defined(ENET_NO_MMSG)
+    #define ENET_HAS_MMSG 1 /**< sendmmsg and recvmmsg are available for batched datagram transfers */
+    #endif
+
+    #if defined(__linux__) && !defined(ENET_NO_EPOLL)
+    #include <sys/epoll.h>
+    #define ENET_HAS_EPOLL 1 /**< the sockets of an ENetReactor are waited on through one epoll set */
+    #endif
+
+    #if defined(__linux__) && !defined(ENET_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #if defined(IORING_RECV_MULTISHOT) && defined(IORING_ENTER_EXT_ARG)
+    #define ENET_HAS_IO_URING 1 /**< sockets may move datagrams through io_uring, see ENetHost::set_io_uring() */
+    #endif
+    #endif
+
+    #if defined(ENET_HAS_MMSG) && !defined(ENET_NO_SEGMENTATION_OFFLOAD)
+    #include <netinet/udp.h>
+    #if defined(UDP_SEGMENT) && defined(UDP_GRO)
+    #define ENET_HAS_SEGMENTATION_OFFLOAD 1 /**< UDP_SEGMENT and UDP_GRO can move several datagrams as one buffer */
+    #endif
+    #endif
+
     #ifdef MSG_MAXIOVLEN
     #define ENET_BUFFER_MAXIMUM MSG_MAXIOVLEN
     #endif
@@ -200,6 +233,10 @@
 #define ENET_BUFFER_MAXIMUM (1 + 2 * ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS)
 #endif
 
+#ifndef ENET_MESSAGE_MAXIMUM
+#define ENET_MESSAGE_MAXIMUM 64 /**< maximum number of datagrams moved by a single batched socket call */
+#endif
+
 #define ENET_IPV6           1
 #define ENET_HOST_ANY       in6addr_any
 #define ENET_HOST_BROADCAST 0xFFFFFFFFU
@@ -227,6 +264,34 @@
     extern void *enet_malloc(size_t);
     extern void enet_free(void *);
 
+    enum {
+        ENET_POOL_DEFAULT_SLAB_BLOCKS = 64
+    };
+
+    /**
+     * Free list of fixed-size blocks carved from slabs obtained through enet_malloc.
+     *
+     * Released blocks are kept for reuse until the pool is destroyed, so a steady stream of
+     * allocations of the same size never reaches the allocator once the pool has warmed up.
+     */
+    struct ENetPool
+    {
+        explicit ENetPool(size_t blockSize, size_t slabBlocks = ENET_POOL_DEFAULT_SLAB_BLOCKS);
+        ENetPool(const ENetPool &) = delete;
+        ENetPool &operator=(const ENetPool &) = delete;
+        ~ENetPool();
+
+        void * allocate();
+        void   release(void *);
+
+        size_t              blockSize;
+        size_t              slabBlocks;
+        void *              freeBlocks = nullptr;
+        std::vector<void *> slabs;
+        size_t              hits   = 0; /**< allocations served from released blocks */
+        size_t              misses = 0; /**< allocations that needed a new slab */
+    };
+
 // =======================================================================//
 // !
 // ! List
@@ -259,14 +324,69 @@
 #define enet_list_front(list) ((void *)(list)->sentinel.next)
 #define enet_list_back(list) ((void *)(list)->sentinel.previous)
 
-    extern void enet_peer_reset_incoming_commands(ENetList *queue);
+// =======================================================================//
+// !
+// ! Timer wheel
+// !
+// =======================================================================//
+
+    enum {
+        ENET_TIMER_WHEEL_LEVELS    = 4,
+        ENET_TIMER_WHEEL_SLOT_BITS = 6,
+        ENET_TIMER_WHEEL_SLOTS     = 1 << ENET_TIMER_WHEEL_SLOT_BITS
+    };
+
+    /** A deadline kept by an ENetTimerWheel; node.next is nullptr while the timer is not scheduled. */
+    typedef struct _ENetTimer {
+        ENetListNode node;
+        enet_uint64  expires;
+        void *       data;
+    } ENetTimer;
 
-    extern void enet_peer_reset_outgoing_commands(ENetList *queue);
+    /**
+     * Hierarchical timing wheel of millisecond deadlines.
+     *
+     * Level n holds the timers due within 64^(n+1) ticks, so four levels of 64 slots cover about
+     * 4.6 hours; later deadlines are clamped and cascade down again once they come into range.
+     * Scheduling and cancelling are O(1), and expiring only touches the slots that are passed.
+     */
+    struct ENetTimerWheel
+    {
+        ENetTimerWheel();
+        ENetTimerWheel(const ENetTimerWheel &) = delete;
+        ENetTimerWheel &operator=(const ENetTimerWheel &) = delete;
+
+        void        schedule(ENetTimer *, enet_uint64);
+        void        cancel(ENetTimer *);
+        ENetTimer * expire(enet_uint64);
+        enet_uint64 next_deadline();
+
+        ENetList    slots[ENET_TIMER_WHEEL_LEVELS][ENET_TIMER_WHEEL_SLOTS];
+        enet_uint64 tick       = 0; /**< tick of the slot that is currently expiring */
+        enet_uint64 time       = 0; /**< service time, in milliseconds, that corresponds to tick */
+        size_t      timerCount = 0;
+
+    private:
+        void        place(ENetTimer *);
+    };
 
+    struct ENetHost;
     struct ENetOutgoingCommand;
-    extern void enet_peer_reset_outgoing_commands(std::list<ENetOutgoingCommand *> &queue);
+    struct _ENetIncomingCommand;
+
+    extern void enet_peer_reset_incoming_commands(ENetHost *host, ENetList *queue);
+
+    template <typename Command> struct ENetSequenceIndex;
+
+    extern void enet_peer_reset_incoming_commands(ENetHost *host, ENetSequenceIndex<struct _ENetIncomingCommand> &queue);
+
+    extern void enet_peer_reset_outgoing_commands(ENetHost *host, ENetList *queue);
+
+    extern void enet_peer_reset_outgoing_commands(ENetHost *host, std::list<ENetOutgoingCommand *> &queue);
+
+    extern void enet_peer_remove_incoming_commands(ENetHost *host, [[maybe_unused]] ENetList *queue, ENetListIterator startCommand, ENetListIterator endCommand);
 
-    extern void enet_peer_remove_incoming_commands([[maybe_unused]] ENetList *queue, ENetListIterator startCommand, ENetListIterator endCommand);
+    extern void enet_peer_free_incoming_command(ENetHost *host, struct _ENetIncomingCommand *incomingCommand);
 
     // =======================================================================//
     // !
@@ -300,7 +420,8 @@
         ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT          = 10,
         ENET_PROTOCOL_COMMAND_THROTTLE_CONFIGURE       = 11,
         ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT = 12,
-        ENET_PROTOCOL_COMMAND_COUNT                    = 13,
+        ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE        = 13,
+        ENET_PROTOCOL_COMMAND_COUNT                    = 14,
 
         ENET_PROTOCOL_COMMAND_MASK                     = 0x0F
     } ENetProtocolCommand;
@@ -317,6 +438,24 @@
         ENET_PROTOCOL_HEADER_SESSION_SHIFT     = 12
     } ENetProtocolFlag;
 
+    /** Optional protocol extensions, agreed on by both ends during the connection handshake.
+     *
+     *  They travel in the incomingSessionID byte of CONNECT and VERIFY_CONNECT: bits 0-1 hold the
+     *  session ID, bit 2 stands for an unset session ID (older peers send 0xFF instead) and bits 3-6
+     *  hold the capabilities. Older peers only ever send 0xFF or a bare session ID, which decode as
+     *  no capabilities, and a host only echoes capabilities the connecting peer advertised, so older
+     *  peers never see them.
+     */
+    typedef enum _ENetProtocolCapability {
+        ENET_PROTOCOL_CAPABILITY_ACKNOWLEDGE_RANGE = (1 << 0), /** acknowledgements may be sent as ENetProtocolAcknowledgeRange */
+        ENET_PROTOCOL_CAPABILITIES_SUPPORTED       = ENET_PROTOCOL_CAPABILITY_ACKNOWLEDGE_RANGE,
+
+        ENET_PROTOCOL_SESSION_ID_MASK              = 0x03,
+        ENET_PROTOCOL_SESSION_ID_UNSET             = 0x04,
+        ENET_PROTOCOL_CAPABILITY_SHIFT             = 3,
+        ENET_PROTOCOL_CAPABILITY_MASK              = 0x0F
+    } ENetProtocolCapability;
+
     #ifdef _MSC_VER
     #pragma pack(push, 1)
     #define ENET_PACKED
@@ -343,6 +482,17 @@
         enet_uint16               receivedSentTime;
     } ENET_PACKED ENetProtocolAcknowledge;
 
+    /** Acknowledges receivedReliableSequenceNumber and, for every bit i set in receivedMask, also
+     *  receivedReliableSequenceNumber + 1 + i, all on the same channel. receivedSentTime is that of
+     *  the most recent datagram among them.
+     */
+    typedef struct _ENetProtocolAcknowledgeRange {
+        ENetProtocolCommandHeader header;
+        enet_uint16               receivedReliableSequenceNumber;
+        enet_uint16               receivedSentTime;
+        enet_uint32               receivedMask;
+    } ENET_PACKED ENetProtocolAcknowledgeRange;
+
     typedef struct _ENetProtocolConnect {
         ENetProtocolCommandHeader header;
         enet_uint16               outgoingPeerID;
@@ -428,6 +578,7 @@
     typedef union _ENetProtocol {
         ENetProtocolCommandHeader     header;
         ENetProtocolAcknowledge       acknowledge;
+        ENetProtocolAcknowledgeRange  acknowledgeRange;
         ENetProtocolConnect           connect;
         ENetProtocolVerifyConnect     verifyConnect;
         ENetProtocolDisconnect        disconnect;
@@ -468,6 +619,9 @@
         ENET_SOCKOPT_ERROR     = 8,
         ENET_SOCKOPT_NODELAY   = 9,
         ENET_SOCKOPT_IPV6_V6ONLY = 10,
+        ENET_SOCKOPT_UDP_SEGMENT = 11,
+        ENET_SOCKOPT_UDP_GRO     = 12,
+        ENET_SOCKOPT_REUSEPORT   = 13,
     } ENetSocketOption;
 
     typedef enum _ENetSocketShutdown {
@@ -494,6 +648,24 @@
 
     #define in6_equal(in6_addr_a, in6_addr_b) (memcmp(&in6_addr_a, &in6_addr_b, sizeof(struct in6_addr)) == 0)
 
+    /**
+     * A single datagram handled by a batched socket call.
+     *
+     * For receives, buffers must describe the storage the datagram is placed into; address and
+     * dataLength are filled in for every datagram that was received. For sends, address and
+     * buffers describe the datagram, and dataLength is filled in once it was sent.
+     *
+     * A non-zero segmentSize marks a train of datagrams to the same address carried in one
+     * buffer: every datagram but the last is exactly segmentSize bytes long.
+     */
+    typedef struct _ENetSocketMessage {
+        ENetAddress  address;     /**< source or destination of the datagram */
+        ENetBuffer * buffers;     /**< storage holding the datagram */
+        size_t       bufferCount; /**< number of entries in buffers */
+        size_t       dataLength;  /**< length of the datagram that was received or sent */
+        size_t       segmentSize; /**< length of each datagram of a train, or 0 for a single datagram */
+    } ENetSocketMessage;
+
     /**
      * Packet flag bit constants.
      *
@@ -513,6 +685,8 @@
 
     typedef void (ENET_CALLBACK *ENetPacketFreeCallback)(void *);
 
+    struct ENetReceiveSlab;
+
     /**
      * ENet packet structure.
      *
@@ -536,8 +710,63 @@
         size_t                 dataLength;     /**< length of data */
         ENetPacketFreeCallback freeCallback;   /**< function to be called when the packet is no longer in use */
         void *                 userData;       /**< application private data, may be freely modified */
+        struct ENetPacketPool *pool;           /**< internal use only, pool the packet is returned to */
+        enet_uint8             poolClass;      /**< internal use only, size class within the pool */
+        struct ENetReceiveSlab *slab;          /**< internal use only, receive slab the data points into */
     } ENetPacket;
 
+    enum {
+        ENET_PACKET_POOL_MINIMUM_CLASS_SIZE = 64,
+        ENET_PACKET_POOL_CLASS_COUNT        = 7, /* 64 bytes up to ENET_PROTOCOL_MAXIMUM_MTU */
+        ENET_PACKET_POOL_SLAB_SIZE          = 64 * 1024
+    };
+
+    /**
+     * Storage one datagram, or one train of datagrams, is received into when the host delivers
+     * packets without copying them (see ENetHost::set_zero_copy_receive()). The host holds a
+     * reference while the slab sits in its receive batch and every packet pointing into it holds
+     * another; the slab goes back to its pool with the last one. The references are only counted
+     * on the host's thread, which is why zero-copy receive keeps ENetPacketPool::concurrentRelease set.
+     */
+    struct alignas(std::max_align_t) ENetReceiveSlab
+    {
+        enet_uint8 *data() { return (enet_uint8 *) this + sizeof(ENetReceiveSlab); }
+
+        size_t           references;
+        size_t           size; /**< bytes of data following the slab */
+        ENetReceiveSlab *next; /**< next free slab of the pool */
+    };
+
+    /**
+     * Power-of-two size classes of packets, from ENET_PACKET_POOL_MINIMUM_CLASS_SIZE bytes of
+     * data up to ENET_PROTOCOL_MAXIMUM_MTU. Larger packets are allocated with enet_malloc.
+     *
+     * The pool is owned by its host and by every packet it handed out, so packets may still be
+     * destroyed after the host is gone; the pool is freed together with its last reference.
+     */
+    struct ENetPacketPool
+    {
+        ENetPacketPool();
+        ~ENetPacketPool();
+        ENetPacketPool(const ENetPacketPool &) = delete;
+        ENetPacketPool &operator=(const ENetPacketPool &) = delete;
+
+        ENetPacket *      allocate(size_t);
+        void              release(ENetPacket *);
+        void              reclaim();
+        void              unreference();
+        ENetReceiveSlab * acquire_slab(size_t);
+        void              release_slab(ENetReceiveSlab *);
+
+        std::array<ENetPool, ENET_PACKET_POOL_CLASS_COUNT> classes;
+        std::atomic<size_t>       references{1}; /**< the owning host plus one per outstanding pooled packet */
+        size_t                    largeAllocations = 0; /**< packets too large for any class, allocated with enet_malloc */
+        bool                      concurrentRelease = true; /**< packets may be destroyed on threads other than the host's; clear it only if they never are */
+        std::atomic<ENetPacket *> returned{nullptr}; /**< packets destroyed by other threads, not yet back in their class */
+        ENetReceiveSlab *         freeSlabs = nullptr; /**< receive slabs no longer referenced, all of slabSize bytes */
+        size_t                    slabSize  = 0;
+    };
+
     typedef struct _ENetAcknowledgement
     {
         ENetProtocol command;
@@ -549,16 +778,21 @@
         ENetListNode outgoingCommandList;
         enet_uint16  reliableSequenceNumber;
         enet_uint16  unreliableSequenceNumber;
-        enet_uint32  sentTime;
-        enet_uint32  roundTripTimeout;
-        enet_uint32  roundTripTimeoutLimit;
+        enet_uint64  sentTime;
+        enet_uint64  roundTripTimeout;      /**< microseconds */
+        enet_uint64  roundTripTimeoutLimit;
         enet_uint32  fragmentOffset;
         enet_uint16  fragmentLength;
         enet_uint16  sendAttempts;
+        enet_uint8   inTransit; /**< the command sits in sentReliableCommands rather than waiting to be resent */
         ENetProtocol command;
         ENetPacket * packet;
     };
 
+    enum {
+        ENET_INCOMING_COMMAND_FRAGMENT_WORDS = 4 /**< fragment bitmap words kept inside an incoming command */
+    };
+
     typedef struct _ENetIncomingCommand {
         ENetListNode incomingCommandList;
         enet_uint16  reliableSequenceNumber;
@@ -566,8 +800,9 @@
         ENetProtocol command;
         enet_uint32  fragmentCount;
         enet_uint32  fragmentsRemaining;
-        enet_uint32 *fragments;
+        enet_uint32 *fragments; /**< points at fragmentBitmap unless the packet has too many fragments for it */
         ENetPacket * packet;
+        enet_uint32  fragmentBitmap[ENET_INCOMING_COMMAND_FRAGMENT_WORDS];
     } ENetIncomingCommand;
 
     enum class ENetPeerState : uint8_t
@@ -584,6 +819,10 @@
         ZOMBIE                   = 9
     };
 
+    typedef enum _ENetHostFlag {
+        ENET_HOST_FLAG_REUSE_PORT = (1 << 0), /** bind with SO_REUSEPORT so that several hosts can share the port */
+    } ENetHostFlag;
+
     enum {
         ENET_HOST_RECEIVE_BUFFER_SIZE          = 256 * 1024,
         ENET_HOST_SEND_BUFFER_SIZE             = 256 * 1024,
@@ -591,6 +830,17 @@
         ENET_HOST_DEFAULT_MTU                  = 1400,
         ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE  = 32 * 1024 * 1024,
         ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA = 32 * 1024 * 1024,
+        ENET_HOST_DEFAULT_RECEIVE_BATCH_SIZE   = 1,
+        ENET_HOST_DEFAULT_SEND_BATCH_SIZE      = 1,
+        ENET_HOST_SEGMENT_MAXIMUM              = 64,
+        ENET_HOST_SEGMENT_BUFFER_MAXIMUM       = 1024,
+        ENET_HOST_SEGMENT_DATA_MAXIMUM         = 65507,
+        ENET_HOST_SEGMENT_RECEIVE_BUFFER_SIZE  = 65536,
+        ENET_HOST_SHARD_SERVICE_TIMEOUT        = 100,
+        ENET_HOST_EVENT_RING_STALL_TIMEOUT     = 1,
+        ENET_HOST_SUBMISSION_NODES             = 256,
+        ENET_HOST_URING_RECEIVE_BUFFERS        = 256,
+        ENET_HOST_URING_SEGMENT_BUFFERS        = 32,
 
         ENET_PEER_DEFAULT_ROUND_TRIP_TIME      = 500,
         ENET_PEER_DEFAULT_PACKET_THROTTLE      = 32,
@@ -611,7 +861,190 @@
         ENET_PEER_FREE_UNSEQUENCED_WINDOWS     = 32,
         ENET_PEER_RELIABLE_WINDOWS             = 16,
         ENET_PEER_RELIABLE_WINDOW_SIZE         = 0x1000,
-        ENET_PEER_FREE_RELIABLE_WINDOWS        = 8
+        ENET_PEER_FREE_RELIABLE_WINDOWS        = 8,
+        ENET_PEER_ACKNOWLEDGEMENT_RING_SIZE    = 2 * ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS,
+        ENET_PEER_ACKNOWLEDGEMENT_FOLD_SCAN    = 64,
+        ENET_PEER_SEQUENCE_INDEX_SIZE          = 64
+    };
+
+    /**
+     * Commands of one channel found by reliable sequence number: the reliable commands sent at least
+     * once and not yet acknowledged, and the reliable commands received ahead of the next one due.
+     *
+     * An open-addressed table probed linearly from the low bits of the sequence number, so the
+     * consecutive numbers a channel usually holds each sit in their own slot. It doubles once more
+     * than half its slots are taken and is freed whenever it empties past ENET_PEER_SEQUENCE_INDEX_SIZE
+     * slots, so its size follows the number of commands held rather than the span of their numbers.
+     * It lives in channels allocated with enet_malloc, so it stays trivial and is set up with {}.
+     */
+    template <typename Command>
+    struct ENetSequenceIndex
+    {
+        /** Records a command, growing the table if it would become more than half full.
+         *  @retval 0 on success
+         *  @retval < 0 if the table could not grow
+         */
+        int insert(Command *command)
+        {
+            if (this->slots == nullptr || (this->count + 1) * 2 > (size_t) this->mask + 1)
+            {
+                size_t size = this->slots == nullptr ? ENET_PEER_SEQUENCE_INDEX_SIZE : ((size_t) this->mask + 1) * 2;
+
+                if (size > 0x10000) {
+                    return -1;
+                }
+
+                auto slots = (Command **) enet_malloc(size * sizeof(Command *));
+
+                if (slots == nullptr) {
+                    return -1;
+                }
+
+                std::fill(slots, slots + size, nullptr);
+
+                if (this->slots != nullptr)
+                {
+                    for (size_t i = 0; i <= this->mask; ++i)
+                    {
+                        if (this->slots[i] != nullptr) {
+                            size_t slot = this->slots[i]->reliableSequenceNumber & (size - 1);
+
+                            while (slots[slot] != nullptr) {
+                                slot = (slot + 1) & (size - 1);
+                            }
+
+                            slots[slot] = this->slots[i];
+                        }
+                    }
+
+                    enet_free(this->slots);
+                }
+
+                this->slots = slots;
+                this->mask  = (enet_uint32) (size - 1);
+            }
+
+            size_t slot = command->reliableSequenceNumber & this->mask;
+
+            while (this->slots[slot] != nullptr) {
+                slot = (slot + 1) & this->mask;
+            }
+
+            this->slots[slot] = command;
+            ++this->count;
+            return 0;
+        }
+
+        Command *find(enet_uint16 reliableSequenceNumber) const
+        {
+            if (this->slots == nullptr) {
+                return nullptr;
+            }
+
+            for (size_t slot = reliableSequenceNumber & this->mask; this->slots[slot] != nullptr; slot = (slot + 1) & this->mask)
+            {
+                if (this->slots[slot]->reliableSequenceNumber == reliableSequenceNumber) {
+                    return this->slots[slot];
+                }
+            }
+
+            return nullptr;
+        }
+
+        /** Removes a command held by the table, moving back the commands probed past its slot. */
+        void erase(const Command *command)
+        {
+            size_t slot = command->reliableSequenceNumber & this->mask;
+
+            while (this->slots[slot] != command) {
+                slot = (slot + 1) & this->mask;
+            }
+
+            for (size_t next = (slot + 1) & this->mask; this->slots[next] != nullptr; next = (next + 1) & this->mask)
+            {
+                size_t home = this->slots[next]->reliableSequenceNumber & this->mask;
+
+                /* a command may fill the hole unless its home slot lies between the hole and itself */
+                if (((next - home) & this->mask) >= ((next - slot) & this->mask))
+                {
+                    this->slots[slot] = this->slots[next];
+                    slot              = next;
+                }
+            }
+
+            this->slots[slot] = nullptr;
+
+            if (--this->count == 0 && this->mask + 1 > ENET_PEER_SEQUENCE_INDEX_SIZE) {
+                this->destroy();
+            }
+        }
+
+        void destroy()
+        {
+            enet_free(this->slots);
+            this->slots = nullptr;
+            this->mask  = 0;
+            this->count = 0;
+        }
+
+        Command   **slots;
+        enet_uint32 mask;
+        size_t      count; /**< number of commands held */
+    };
+
+    /**
+     * Ring of a peer's pending acknowledgements.
+     *
+     * Starts at ENET_PEER_ACKNOWLEDGEMENT_RING_SIZE slots and doubles when a burst outgrows it;
+     * the storage is kept across resets, so steady traffic queues acknowledgements without
+     * allocating.
+     */
+    struct ENetAcknowledgementRing
+    {
+        void push_back(const ENetAcknowledgement &acknowledgement)
+        {
+            if (this->count == this->slots.size())
+            {
+                std::vector<ENetAcknowledgement> slots(std::max<size_t>(this->slots.size() * 2, ENET_PEER_ACKNOWLEDGEMENT_RING_SIZE));
+
+                for (size_t i = 0; i < this->count; ++i)
+                {
+                    slots[i] = this->slots[(this->head + i) % this->slots.size()];
+                }
+
+                this->slots.swap(slots);
+                this->head = 0;
+            }
+
+            this->slots[(this->head + this->count++) % this->slots.size()] = acknowledgement;
+        }
+
+        void pop_front()
+        {
+            this->head = (this->head + 1) % this->slots.size();
+            --this->count;
+
+            if (this->deferred > 0) {
+                --this->deferred;
+            }
+        }
+
+        void clear()
+        {
+            this->head     = 0;
+            this->count    = 0;
+            this->deferred = 0;
+        }
+
+        ENetAcknowledgement &front() { return this->slots[this->head]; }
+        ENetAcknowledgement &operator[](size_t index) { return this->slots[(this->head + index) % this->slots.size()]; }
+        bool                 empty() const { return this->count == 0; }
+        size_t               size() const { return this->count; }
+
+        std::vector<ENetAcknowledgement> slots;
+        size_t                           head     = 0;
+        size_t                           count    = 0;
+        size_t                           deferred = 0; /**< entries at the front already counted in ENetPeer::deferredAcknowledgements */
     };
 
     typedef struct _ENetChannel {
@@ -621,8 +1054,9 @@
         std::array<enet_uint16, ENET_PEER_RELIABLE_WINDOWS> reliableWindows;
         enet_uint16 incomingReliableSequenceNumber;
         enet_uint16 incomingUnreliableSequenceNumber;
-        ENetList    incomingReliableCommands;
+        ENetSequenceIndex<ENetIncomingCommand> incomingReliableCommands; /**< reliable commands received ahead of the next one due */
         ENetList    incomingUnreliableCommands;
+        ENetSequenceIndex<ENetOutgoingCommand> sentReliableCommands; /**< reliable commands of the channel awaiting acknowledgement */
     } ENetChannel;
 
     /**
@@ -666,7 +1100,7 @@
          *  responsiveness during traffic spikes.
          *
          *  @param peer the peer to adjust
-         *  @param pingInterval the interval at which to send pings; defaults to ENET_PEER_PING_INTERVAL if 0
+         *  @param pingInterval the interval, in milliseconds, at which to send pings; defaults to ENET_PEER_PING_INTERVAL if 0
          */
         void ping_interval(enet_uint32);
 
@@ -683,8 +1117,8 @@
          *
          *  @param peer the peer to adjust
          *  @param timeoutLimit the timeout limit; defaults to ENET_PEER_TIMEOUT_LIMIT if 0
-         *  @param timeoutMinimum the timeout minimum; defaults to ENET_PEER_TIMEOUT_MINIMUM if 0
-         *  @param timeoutMaximum the timeout maximum; defaults to ENET_PEER_TIMEOUT_MAXIMUM if 0
+         *  @param timeoutMinimum the timeout minimum, in milliseconds; defaults to ENET_PEER_TIMEOUT_MINIMUM if 0
+         *  @param timeoutMaximum the timeout maximum, in milliseconds; defaults to ENET_PEER_TIMEOUT_MAXIMUM if 0
          */
         void timeout(enet_uint32, enet_uint32, enet_uint32);
 
@@ -767,7 +1201,7 @@
         enet_uint32 get_id();
         enet_uint32 get_ip(char *ip, size_t ipLength);
         enet_uint16 get_port();
-        enet_uint32 get_rtt();
+        enet_uint32 get_rtt(); /**< mean round trip time in milliseconds */
         enet_uint64 get_packets_sent();
         enet_uint32 get_packets_lost();
         enet_uint64 get_bytes_sent();
@@ -778,71 +1212,137 @@
         void *get_data();
         void  set_data(const void *);
 
-        std::array<enet_uint32, (ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32)> unsequencedWindow;
-        std::list<ENetAcknowledgement>                                    acknowledgements;
-        std::list<ENetOutgoingCommand *>                                  sentUnreliableCommands;
-        ENetAddress       address; /**< Internet address of the peer */
-        enet_uint32       eventData;
+        /* The fields are ordered by how often a service pass touches them, so that a pass over a
+         * peer stays within its first three cache lines on 64-bit targets: first what every pass
+         * reads to schedule the peer, then what sending and acknowledging commands use, then
+         * configuration and statistics. Only sentUnreliableCommands, used by unreliable sends,
+         * reaches into the fourth line. */
+
+        ENetPeerState     state;
+        uint8_t           needsDispatch : 1;
+        uint8_t           needsSend : 1; /**< the peer is in the host's sendQueue */
+        enet_uint8        capabilities = 0; /**< ENetProtocolCapability constants agreed with the remote peer */
+        enet_uint8        outgoingSessionID;
+        enet_uint8        incomingSessionID;
+        enet_uint16       outgoingPeerID;
+        enet_uint16       incomingPeerID;
+        enet_uint16       activeIndex; /**< position of the peer in the host's activePeers while it is not disconnected */
+        enet_uint32       mtu;
+        struct ENetHost * host;
+        enet_uint64       nextTimeout;
+        enet_uint64       earliestTimeout;
+        enet_uint64       lastReceiveTime;
+        enet_uint64       lastSendTime;
+        enet_uint32       pingInterval;
         ENetList          sentReliableCommands;
         ENetList          outgoingReliableCommands;
         ENetList          outgoingUnreliableCommands;
+        ENetTimer         timer = {}; /**< retransmission or ping deadline, scheduled on the host's timers */
+        ENetAcknowledgementRing acknowledgements;
+        std::list<ENetOutgoingCommand *> sentUnreliableCommands;
+
+        ENetAddress       address; /**< Internet address of the peer */
+        enet_uint32       connectID;
+        enet_uint32       reliableDataInTransit;
+        enet_uint32       windowSize;
+        enet_uint32       packetThrottle;
+        enet_uint32       packetThrottleCounter;
+        enet_uint32       roundTripTime; /**< mean round trip time (RTT), in microseconds, between sending a reliable packet and receiving its acknowledgement */
+        enet_uint32       roundTripTimeVariance;
+        enet_uint32       timeoutLimit;
+        enet_uint32       timeoutMinimum;
+        enet_uint32       timeoutMaximum;
+        enet_uint64       packetLossEpoch;
+        enet_uint32       packetsSent;
+        enet_uint32       packetsLost;
+        enet_uint32       incomingDataTotal;
+        enet_uint32       outgoingDataTotal;
+        enet_uint16       outgoingReliableSequenceNumber;
+        enet_uint16       outgoingUnsequencedGroup;
+        ENetChannel *     channels;
+        size_t            channelCount;      /**< Number of channels allocated for communication with peer */
         ENetList          dispatchedCommands;
-        struct ENetHost * host;
+        ENetSequenceIndex<ENetOutgoingCommand> sentControlCommands = {}; /**< reliable commands outside any channel (channel 0xFF) awaiting acknowledgement */
+        size_t            deferredAcknowledgements = 0; /**< acknowledgements held over to a later datagram because one was full, each counted once */
+
+        enet_uint32       eventData;
         void *            data;    /**< Application private data, may be freely modified */
-        ENetChannel *     channels;
         enet_uint64       totalDataReceived;
         enet_uint64       totalDataSent;
         enet_uint64       totalPacketsSent;  /**< total number of packets sent during a session */
-        size_t            channelCount;      /**< Number of channels allocated for communication with peer */
         size_t            totalWaitingData;
-        enet_uint32 incomingBandwidth; /**< Downstream bandwidth of the client in bytes/second */
+        enet_uint32       incomingBandwidth; /**< Downstream bandwidth of the client in bytes/second */
         enet_uint32       outgoingBandwidth; /**< Upstream bandwidth of the client in bytes/second */
-        enet_uint32       incomingBandwidthThrottleEpoch;
-        enet_uint32       outgoingBandwidthThrottleEpoch;
-        enet_uint32       incomingDataTotal;
-        enet_uint32       outgoingDataTotal;   
-        enet_uint32       lastSendTime;
-        enet_uint32       lastReceiveTime;
-        enet_uint32       nextTimeout;
-        enet_uint32       earliestTimeout;
-        enet_uint32       packetLossEpoch;
-        enet_uint32       packetsSent;
-        enet_uint32       packetsLost;
+        enet_uint64       incomingBandwidthThrottleEpoch;
+        enet_uint64       outgoingBandwidthThrottleEpoch;
         enet_uint32       totalPacketsLost;     /**< total number of packets lost during a session */
         enet_uint32       packetLoss; /**< mean packet loss of reliable packets as a ratio with respect to the constant ENET_PEER_PACKET_LOSS_SCALE */
         enet_uint32       packetLossVariance;
-        enet_uint32       packetThrottle;
         enet_uint32       packetThrottleLimit;
-        enet_uint32       packetThrottleCounter;
-        enet_uint32       packetThrottleEpoch;
+        enet_uint64       packetThrottleEpoch;
         enet_uint32       packetThrottleAcceleration;
         enet_uint32       packetThrottleDeceleration;
         enet_uint32       packetThrottleInterval;
-        enet_uint32       pingInterval;
-        enet_uint32       timeoutLimit;
-        enet_uint32       timeoutMinimum;
-        enet_uint32       timeoutMaximum;
         enet_uint32       lastRoundTripTime;
         enet_uint32       lowestRoundTripTime;
         enet_uint32       lastRoundTripTimeVariance;
         enet_uint32       highestRoundTripTimeVariance;
-        enet_uint32       roundTripTime; /**< mean round trip time (RTT), in milliseconds, between sending a reliable packet and receiving its acknowledgement */
-        enet_uint32       roundTripTimeVariance;
-        enet_uint32       mtu;
-        enet_uint32       windowSize;
-        enet_uint32       reliableDataInTransit;
-        enet_uint32       connectID;
-        enet_uint16       outgoingReliableSequenceNumber;
         enet_uint16       incomingUnsequencedGroup;
-        enet_uint16       outgoingUnsequencedGroup;
-        enet_uint16       outgoingPeerID;
-        enet_uint16       incomingPeerID;
-        enet_uint8        outgoingSessionID;
-        enet_uint8        incomingSessionID;
-        ENetPeerState     state;
-        uint8_t           needsDispatch : 1;
+        std::array<enet_uint32, (ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32)> unsequencedWindow;
+    };
+
+    /** Identifies a connection by the remote address, port and connect ID of its peer. */
+    typedef struct _ENetPeerKey {
+        struct in6_addr host;
+        enet_uint16     port;
+        enet_uint32     connectID;
+
+        bool operator==(const _ENetPeerKey &key) const
+        {
+            return in6_equal(host, key.host) && port == key.port && connectID == key.connectID;
+        }
+    } ENetPeerKey;
+
+    /** FNV-1a over a byte range, used to hash the host's peer index keys. */
+    inline size_t enet_hash_bytes(const void *data, size_t length, enet_uint64 hash = 14695981039346656037ULL)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash = (hash ^ ((const enet_uint8 *) data)[i]) * 1099511628211ULL;
+        }
+
+        return (size_t) hash;
+    }
+
+    struct ENetPeerKeyHash {
+        size_t operator()(const ENetPeerKey &key) const
+        {
+            size_t hash = enet_hash_bytes(&key.host, sizeof(key.host));
+            hash = enet_hash_bytes(&key.port, sizeof(key.port), hash);
+            return enet_hash_bytes(&key.connectID, sizeof(key.connectID), hash);
+        }
+    };
+
+    struct ENetAddressHostHash {
+        size_t operator()(const struct in6_addr &host) const { return enet_hash_bytes(&host, sizeof(host)); }
     };
 
+    struct ENetAddressHostEqual {
+        bool operator()(const struct in6_addr &a, const struct in6_addr &b) const { return in6_equal(a, b); }
+    };
+
+    /** A datagram assembled by a send pass, waiting to be handed to the socket together with the rest of the pass. */
+    typedef struct _ENetDatagram {
+        ENetPeer *   peer;
+        ENetBuffer   buffers[ENET_BUFFER_MAXIMUM];
+        size_t       bufferCount;
+        size_t       dataLength;
+        size_t       messageIndex; /**< socket message carrying the datagram when it is flushed */
+        ENetProtocol commands[ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS];
+        enet_uint8   headerData[sizeof(ENetProtocolHeader) + sizeof(enet_uint32)];
+        enet_uint8   compressedData[ENET_PROTOCOL_MAXIMUM_MTU];
+    } ENetDatagram;
+
     /** An ENet packet compressor for compressing UDP packets before socket sends or receives. */
     typedef struct _ENetCompressor {
         /** Context data for the compressor. Must be non-nullptr. */
@@ -859,12 +1359,45 @@
         void (ENET_CALLBACK * destroy)(void *context);
     } ENetCompressor;
 
+    enum {
+        ENET_LZ_HASH_LOG           = 12,
+        ENET_LZ_HASH_SIZE          = 1 << ENET_LZ_HASH_LOG,
+        ENET_LZ_MINIMUM_MATCH      = 4,
+        ENET_LZ_MAXIMUM_OFFSET     = 65535,
+        ENET_LZ_DICTIONARY_MAXIMUM = ENET_LZ_MAXIMUM_OFFSET
+    };
+
+    /** A position the LZ compressor has seen, with the end of the buffer it belongs to. */
+    typedef struct _ENetLZEntry {
+        const enet_uint8 *data;
+        enet_uint32       position;
+        enet_uint32       limit;
+    } ENetLZEntry;
+
+    /**
+     * Context of the built-in LZ4-style compressor.
+     *
+     * Both ends of a connection must be configured with the same preset dictionary. Positions of
+     * the datagram being compressed are numbered from base onwards, so entries left behind by
+     * earlier datagrams fall below base and are ignored without clearing the table.
+     */
+    typedef struct _ENetLZ {
+        ENetLZEntry table[ENET_LZ_HASH_SIZE];           /**< positions of the datagrams compressed so far */
+        ENetLZEntry dictionaryTable[ENET_LZ_HASH_SIZE]; /**< positions of the preset dictionary */
+        enet_uint32 base;
+        size_t      dictionaryLength;
+        enet_uint8  dictionary[ENET_LZ_DICTIONARY_MAXIMUM];
+    } ENetLZ;
+
     /** Callback that computes the checksum of the data held in buffers[0:bufferCount-1] */
     typedef enet_uint32 (ENET_CALLBACK * ENetChecksumCallback)(const ENetBuffer *buffers, size_t bufferCount);
 
     /** Callback for intercepting received raw UDP packets. Should return 1 to intercept, 0 to ignore, or -1 to propagate an error. */
     typedef int(ENET_CALLBACK *ENetInterceptCallback)(struct ENetHost *host, void *event);
 
+    /** Callback that returns the current monotonic time in microseconds, for hosts that do not use enet_time_get_us(). */
+    typedef enet_uint64(ENET_CALLBACK *ENetTimeSourceCallback)(void *context);
+
     /**
      * An ENet event type, as specified in @ref ENetEvent.
      */
@@ -915,7 +1448,103 @@
         ENetEventType type; /**< type of the event */
     };
 
-    struct ENetSocket
+    /**
+     * Bounded multi-producer multi-consumer queue of events, see ENetHost::set_event_ring().
+     *
+     * Each cell carries a sequence number telling whether it is ready to be written for the
+     * current lap or to be read, so producers and consumers only contend on their own position.
+     */
+    struct ENetEventRing
+    {
+        explicit ENetEventRing(size_t capacity);
+
+        bool   push(const ENetEvent &);
+        bool   pop(ENetEvent &);
+        bool   full();
+        void   wait_for_space(enet_uint32);
+
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            ENetEvent           event;
+        };
+
+        std::unique_ptr<Cell[]>          cells;
+        size_t                           mask;
+        alignas(64) std::atomic<size_t>  enqueuePosition{0};
+        alignas(64) std::atomic<size_t>  dequeuePosition{0};
+        std::atomic<bool>                producerWaiting{false}; /**< set while the producer blocks on a full ring */
+        std::mutex                       spaceLock;
+        std::condition_variable          spaceAvailable; /**< signalled by pop() while producerWaiting is set */
+    };
+
+#ifdef ENET_HAS_IO_URING
+    /**
+     * io_uring backend of an ENetSocket, see ENetHost::set_io_uring().
+     *
+     * One multishot recvmsg stays armed on the socket and fills a registered ring of provided
+     * buffers, so received datagrams are taken from the completion queue without a system call
+     * each; the buffers of a batch are handed back to the kernel when the next batch is taken.
+     * Sends are queued as sendmsg submissions linked to each other, so that, like sendmmsg, they
+     * stop at the first datagram the socket refuses, and are submitted with one io_uring_enter.
+     */
+    struct ENetUring
+    {
+        ENetUring() = default;
+        ENetUring(const ENetUring &) = delete;
+        ENetUring &operator=(const ENetUring &) = delete;
+        ~ENetUring();
+
+        int  open(int, size_t, size_t, size_t);
+        int  receive_many(ENetSocketMessage *, size_t);
+        int  send_many(ENetSocketMessage *, size_t);
+        int  wait(enet_uint32 &, enet_uint64);
+        int  enter(unsigned, unsigned, void *, size_t);
+        void reap();
+        io_uring_sqe *prepare();
+        int  arm_receive();
+        void provide_buffer(enet_uint16);
+        bool pending();
+
+        struct Completion
+        {
+            int         result;
+            enet_uint16 bufferID;
+        };
+
+        int                      ringFD   = -1;
+        int                      socket   = -1;
+        void *                   ring     = nullptr; /**< submission and completion rings, mapped together */
+        size_t                   ringSize = 0;
+        io_uring_sqe *           sqes     = nullptr;
+        size_t                   sqesSize = 0;
+        unsigned *               sqHead, *sqTail, *sqArray, sqMask, sqEntries;
+        unsigned                 sqPending = 0; /**< entries prepared but not yet published to the kernel */
+        unsigned *               cqHead, *cqTail, cqMask;
+        io_uring_cqe *           cqes;
+        io_uring_buf_ring *      bufferRing     = nullptr;
+        size_t                   bufferRingSize = 0;
+        enet_uint16              bufferCount    = 0;
+        enet_uint16              bufferTail     = 0;
+        size_t                   bufferSize     = 0; /**< recvmsg header, address, control data and payload */
+        std::vector<enet_uint8>  bufferData;
+        std::vector<ENetBuffer>  receiveBuffers; /**< payload of each provided buffer, by buffer ID */
+        std::vector<enet_uint16> heldBuffers;    /**< buffers of the last batch, provided again by the next */
+        std::vector<Completion>  completions;    /**< received datagrams reaped but not yet taken */
+        size_t                   completionIndex = 0;
+        struct msghdr            receiveHeader   = {};
+        enet_uint8               receiveArmed    = 0;
+        unsigned                 sendPending     = 0;
+        int                      sendResults[ENET_MESSAGE_MAXIMUM];
+        struct msghdr            sendHeaders[ENET_MESSAGE_MAXIMUM];
+        struct sockaddr_in6      sendNames[ENET_MESSAGE_MAXIMUM];
+    #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+        alignas(struct cmsghdr) char sendControl[ENET_MESSAGE_MAXIMUM][CMSG_SPACE(sizeof(enet_uint16))];
+    #endif
+    };
+#endif
+
+    struct ENetSocket
     {
         ENetSocket() = default;
 
@@ -928,15 +1557,68 @@
         int connect(const ENetAddress *);
         int send(const ENetAddress *, const ENetBuffer *, size_t);
         int receive(ENetAddress *, ENetBuffer *, size_t);
+        int receive_many(ENetSocketMessage *, size_t);
+        int send_many(ENetSocketMessage *, size_t);
         int wait(enet_uint32 &, enet_uint64);
         int set_option(ENetSocketOption, int);
         int get_option(ENetSocketOption, int *);
         int shutdown(ENetSocketShutdown);
         int select(ENetSocketSet *, ENetSocketSet *, enet_uint32);
+        int wait_handle();
+        void close();
 
         inline bool is_null() { return m_socket == ENET_SOCKET_NULL; }
 
         int m_socket = socket(PF_INET6, SOCK_DGRAM, 0);
+    #ifdef ENET_HAS_IO_URING
+        std::unique_ptr<ENetUring> uring; /**< moves the datagrams instead of recvmmsg and sendmmsg, if set */
+    #endif
+    };
+
+    /**
+     * Fixed ring of peers waiting to be dispatched.
+     *
+     * A peer is queued at most once, guarded by its needsDispatch flag which stays set until the
+     * entry is popped, so a ring of peerCount slots never overflows and never allocates.
+     */
+    struct ENetPeerRing
+    {
+        void reset(size_t capacity)
+        {
+            this->peers.assign(capacity, nullptr);
+            this->head  = 0;
+            this->count = 0;
+        }
+
+        void push_back(ENetPeer *peer)
+        {
+            assert(this->count < this->peers.size());
+            this->peers[(this->head + this->count++) % this->peers.size()] = peer;
+        }
+
+        void pop_front()
+        {
+            this->head = (this->head + 1) % this->peers.size();
+            --this->count;
+        }
+
+        ENetPeer *front() const { return this->peers[this->head]; }
+        bool      empty() const { return this->count == 0; }
+
+        std::vector<ENetPeer *> peers;
+        size_t                  head  = 0;
+        size_t                  count = 0;
+    };
+
+    /** A packet submitted to a host by another thread, see ENetHost::submit(). */
+    struct ENetSubmission
+    {
+        ENetSubmission * next;
+        enet_uint32      nextFree; /**< index + 1 of the next node on the free stack, 0 at its bottom */
+        enet_uint32      connectID; /**< connection of the peer when the packet was submitted */
+        ENetPeer *       peer;      /**< nullptr to broadcast */
+        enet_uint8       channelID;
+        ENetPacket *     packet;
     };
 
     /** An ENet host for communicating with peers.
@@ -960,23 +1642,49 @@
         ENetHost() = default;
 
         ENetHost(const ENetAddress *address, size_t peerCount, size_t channelLimit,
-                 enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth);
+                 enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth, enet_uint32 flags = 0);
 
         ~ENetHost();
 
         ENetPeer *  connect(const ENetAddress *, size_t, enet_uint32);
         bool        check_events(ENetEvent &);
         int         service(ENetEvent *, enet_uint32);
+        int         service_many(ENetEvent *, size_t, enet_uint32);
         int         send_raw(const ENetAddress *, enet_uint8 *, size_t);
         int         send_raw_ex(const ENetAddress *address, enet_uint8 *data, size_t skipBytes,
                                 size_t bytesToSend);
         void        set_intercept(const ENetInterceptCallback);
+        void        set_time_source(const ENetTimeSourceCallback, void *);
+        enet_uint64 update_time();
         void        flush();
         void        broadcast(enet_uint8, ENetPacket *);
+        ENetPacket *create_packet(const void *, size_t, enet_uint32);
+        ENetPacket *create_received_packet(const void *, size_t, enet_uint32);
         void        compress(const ENetCompressor *);
+        int         compress_with_lz(const void *, size_t);
         void        channel_limit(size_t);
         void        bandwidth_limit(enet_uint32, enet_uint32);
         void        bandwidth_throttle();
+        int         set_receive_batch(size_t);
+        int         set_send_batch(size_t);
+        int         set_segmentation_offload(int);
+        int         set_zero_copy_receive(int);
+        int         set_io_uring(int);
+        int         renew_receive_slabs();
+        int         submit(ENetPeer *, enet_uint8, ENetPacket *);
+        int         submit(ENetPeer *, enet_uint8, ENetPacket *, enet_uint32);
+        int         submit_broadcast(enet_uint8, ENetPacket *);
+        void        wake();
+        void        drain_submissions();
+        void        release_submission(ENetSubmission *);
+        int         set_event_ring(size_t);
+        int         service_events(enet_uint32);
+        size_t      receive_events(ENetEvent *, size_t);
+        void        acquire_peer(ENetPeer *);
+        void        index_peer(ENetPeer *);
+        void        release_peer(ENetPeer *);
+        void        schedule_peer(ENetPeer *);
+        enet_uint64 next_deadline();
         enet_uint64 random_seed(void);
 
         inline enet_uint32 get_peers_count() { return this->connectedPeers; }
@@ -1004,27 +1712,61 @@
 
         std::vector<ENetPeer> peers;     /**< array of peers allocated for this host */
         size_t                peerCount; /**< number of peers allocated for this host */
+        std::vector<ENetPeer *> freePeers;   /**< disconnected peers, the next one to be used at the back */
+        std::vector<ENetPeer *> activePeers; /**< peers that are not disconnected, in no particular order */
+        std::unordered_multimap<ENetPeerKey, ENetPeer *, ENetPeerKeyHash>
+            peerIndex; /**< peers that are neither disconnected nor connecting, by address, port and connect ID */
+        std::unordered_map<struct in6_addr, size_t, ENetAddressHostHash, ENetAddressHostEqual>
+            peerAddressCounts; /**< number of peers in peerIndex for each remote address */
         ENetSocket            socket;
         ENetAddress           address;           /**< Internet address of the host */
         enet_uint32           incomingBandwidth; /**< downstream bandwidth of the host */
         enet_uint32           outgoingBandwidth; /**< upstream bandwidth of the host */
-        enet_uint32           bandwidthThrottleEpoch = 0;
+        enet_uint64           bandwidthThrottleEpoch = 0;
         enet_uint32           mtu                    = ENET_HOST_DEFAULT_MTU;
         enet_uint32           randomSeed;
         int                   recalculateBandwidthLimits = 0;
+        int                   continueSending            = 0;
         size_t                channelLimit; /**< maximum number of channels allowed for connected peers */
-        enet_uint32           serviceTime;
-        std::list<ENetPeer *> dispatchQueue;
+        enet_uint64           serviceTime = 0; /**< microseconds, from update_time() */
+        ENetPeerRing          dispatchQueue; /**< peers with events or received packets to dispatch */
+        std::vector<ENetPeer *> sendQueue; /**< peers with queued acknowledgements or outgoing commands */
+        std::atomic<ENetSubmission *> submissions{nullptr}; /**< packets submitted by other threads, newest first */
+        std::unique_ptr<ENetSubmission[]> submissionNodes; /**< ENET_HOST_SUBMISSION_NODES nodes reused by submit() */
+        std::atomic<enet_uint64> freeSubmissions{0}; /**< free nodes: ABA tag in the high half, index + 1 of the top in the low half */
+        std::unique_ptr<ENetEventRing> eventRing;           /**< events handed to consumer threads, if enabled */
+        size_t                eventRingStalls = 0; /**< service_events calls that found the ring full */
+        ENetTimerWheel        timers; /**< deadlines of the active peers */
+        ENetPool              outgoingCommandPool{sizeof(ENetOutgoingCommand)};
+        ENetPool              incomingCommandPool{sizeof(ENetIncomingCommand)};
+        ENetPacketPool *      packetPool = nullptr; /**< size classes for the packets created by this host */
         size_t                packetSize;
         enet_uint16           headerFlags;
-        ENetProtocol          commands[ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS];
+        ENetProtocol *        commands     = nullptr; /**< commands of the datagram being assembled */
         size_t                commandCount = 0;
-        ENetBuffer            buffers[ENET_BUFFER_MAXIMUM];
-        size_t                bufferCount = 0;
+        ENetBuffer *          buffers      = nullptr; /**< buffers of the datagram being assembled */
+        size_t                bufferCount  = 0;
+        std::vector<ENetDatagram>      sendDatagrams;     /**< datagrams staged by the current send pass */
+        std::vector<ENetSocketMessage> sendMessages;      /**< one socket message per staged datagram */
+        size_t                sendDatagramCount = 0;     /**< number of datagrams staged in sendDatagrams */
+        std::vector<ENetBuffer>        sendSegmentBuffers; /**< buffers of the datagram trains built by a segmented flush */
+        enet_uint8            segmentedSends     = 0; /**< whether datagram trains to one peer are sent with UDP_SEGMENT */
+        enet_uint8            coalescedReceives  = 0; /**< whether datagram trains are received with UDP_GRO */
+        enet_uint8            zeroCopyReceives   = 0; /**< whether received packets point into receiveSlabs instead of copies */
         ENetChecksumCallback  checksum =
             nullptr; /**< callback the user can set to enable packet checksums for this host */
-        ENetCompressor        compressor;
-        enet_uint8            packetData[2][ENET_PROTOCOL_MAXIMUM_MTU];
+        ENetCompressor        compressor = {};
+        enet_uint8            capabilities =
+            ENET_PROTOCOL_CAPABILITIES_SUPPORTED; /**< ENetProtocolCapability constants offered to remote peers */
+        enet_uint8            packetData[ENET_PROTOCOL_MAXIMUM_MTU]; /**< scratch space for compressing and decompressing datagrams */
+        std::vector<enet_uint8>        receiveData;     /**< storage for the receive batch, one slot per datagram or train */
+        std::vector<ENetBuffer>        receiveBuffers;  /**< one buffer per datagram of the receive batch */
+        std::vector<ENetSocketMessage> receiveMessages; /**< datagrams fetched by the last batched receive */
+        size_t                receiveMessageIndex = 0;  /**< next datagram of receiveMessages to be handled */
+        size_t                receiveMessageCount = 0;  /**< number of datagrams held in receiveMessages */
+        size_t                receiveSegmentOffset = 0; /**< offset of the next datagram within a received train */
+        std::vector<ENetReceiveSlab *> receiveSlabs;    /**< with zeroCopyReceives, the storage of each receive buffer */
+        ENetReceiveSlab *     receivedSlab = nullptr;   /**< slab holding the datagram being handled, if any */
         ENetAddress           receivedAddress;
         enet_uint8 *          receivedData       = nullptr;
         size_t                receivedDataLength = 0;
@@ -1038,6 +1780,8 @@
                                                  0 as needed to prevent overflow */
         ENetInterceptCallback intercept =
             nullptr; /**< callback the user can set to intercept received raw UDP packets */
+        ENetTimeSourceCallback timeSource = nullptr; /**< clock read by update_time(), enet_time_get_us() if nullptr */
+        void *                timeSourceContext = nullptr;
         size_t connectedPeers        = 0;
         size_t bandwidthLimitedPeers = 0;
         size_t duplicatePeers =
@@ -1051,6 +1795,102 @@
               space a peer may use waiting for packets to be delivered */
     };
 
+    struct ENetShard;
+    struct ENetShardedHost;
+
+    /** Refers to a peer of a sharded host from any thread. */
+    struct ENetShardPeer
+    {
+        size_t      shard;
+        enet_uint16 peerID;
+        enet_uint32 connectID;
+    };
+
+    /** Called on the shard's service thread for every event of its host. */
+    typedef void (ENET_CALLBACK * ENetShardEventCallback) (ENetShard * shard, ENetEvent * event, void * context);
+
+    /** One host of a sharded host, serviced by its own thread. */
+    struct ENetShard
+    {
+        ENetShardedHost *         group;
+        size_t                    index;
+        std::unique_ptr<ENetHost> host;
+        std::thread               thread;
+    };
+
+    /**
+     * Several hosts bound to one port with SO_REUSEPORT, each with its own peers and service thread.
+     *
+     * The kernel spreads datagrams over the sockets by flow hash, so every connection stays with
+     * the shard that accepted it. Hosts are only touched by their own thread; other threads reach
+     * peers through find_peer, send and broadcast, which submit packets to the owning shard's host.
+     */
+    struct ENetShardedHost
+    {
+        ENetShardedHost(const ENetAddress *address, size_t shardCount, size_t peerCount, size_t channelLimit,
+                        enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth);
+        ENetShardedHost(const ENetShardedHost &) = delete;
+        ENetShardedHost &operator=(const ENetShardedHost &) = delete;
+        ~ENetShardedHost();
+
+        int  start(ENetShardEventCallback, void *, enet_uint32 serviceTimeout = ENET_HOST_SHARD_SERVICE_TIMEOUT);
+        void stop();
+        bool find_peer(const ENetAddress *, ENetShardPeer *);
+        int  send(const ENetShardPeer *, enet_uint8, const void *, size_t, enet_uint32);
+        int  broadcast(enet_uint8, const void *, size_t, enet_uint32);
+        void service_shard(ENetShard *);
+
+        std::vector<std::unique_ptr<ENetShard>> shards;
+        ENetAddress                             address; /**< address shared by all shards */
+        ENetShardEventCallback                  callback = nullptr;
+        void *                                  context  = nullptr;
+        enet_uint32                             serviceTimeout = ENET_HOST_SHARD_SERVICE_TIMEOUT;
+        std::atomic<bool>                       running{false};
+        std::mutex                              directoryMutex; /**< guards directory */
+        std::unordered_map<ENetPeerKey, ENetShardPeer, ENetPeerKeyHash>
+            directory; /**< connected peers of all shards by address and port */
+    };
+
+    /** Called by ENetReactor::service() for every event of a host that was ready. */
+    typedef void (ENET_CALLBACK * ENetReactorEventCallback) (ENetHost * host, ENetEvent * event, void * context);
+
+    /** A host registered with an ENetReactor. */
+    struct ENetReactorHost
+    {
+        ENetHost *  host;
+        enet_uint64 deadline = 0; /**< service time by which the host was due at the last wait */
+        enet_uint8  readable = 0; /**< the host's socket was reported readable by the last wait */
+        int         handle   = -1; /**< descriptor waited on for the host's datagrams, see ENetSocket::wait_handle() */
+    };
+
+    /**
+     * Services any number of hosts from one thread.
+     *
+     * The sockets of all hosts share one epoll set, or a poll() array where epoll is not available.
+     * A pass blocks until a socket is readable or the earliest retransmission, ping or queued
+     * work of any host comes due, and then services only the hosts that are ready, instead of
+     * spinning over service(..., 0) of every host. Hosts are not owned by the reactor.
+     */
+    struct ENetReactor
+    {
+        ENetReactor();
+        ENetReactor(const ENetReactor &) = delete;
+        ENetReactor &operator=(const ENetReactor &) = delete;
+        ~ENetReactor();
+
+        int add(ENetHost *);
+        int remove(ENetHost *);
+        int service(ENetReactorEventCallback, void *, enet_uint32);
+
+        std::vector<std::unique_ptr<ENetReactorHost>> hosts;
+    #ifdef ENET_HAS_EPOLL
+        int                      pollSet = -1;
+        std::vector<epoll_event> pollEvents; /**< one per host, filled by epoll_wait */
+    #else
+        std::vector<pollfd>      pollSockets; /**< one per host, in the order of hosts */
+    #endif
+    };
+
 // =======================================================================//
 // !
 // ! Public API
@@ -1090,6 +1930,9 @@
     /** Returns the monotonic time in milliseconds. Its initial value is unspecified unless otherwise set. */
     ENET_API enet_uint32 enet_time_get(void);
 
+    /** Returns the monotonic time in microseconds on the same base as enet_time_get(). */
+    ENET_API enet_uint64 enet_time_get_us(void);
+
     /** Attempts to parse the printable form of the IP address in the parameter hostName
         and sets the host field in the address parameter if successful.
         @param address destination to store the parsed IP address
@@ -1136,9 +1979,15 @@
 
     ENET_API ENetPacket * enet_packet_create(const void *, size_t, enet_uint32);
     ENET_API ENetPacket * enet_packet_create_offset(const void *, size_t, size_t, enet_uint32);
+    ENET_API ENetPacket * enet_packet_create_pooled(ENetPacketPool *, const void *, size_t, enet_uint32);
     ENET_API void         enet_packet_destroy(ENetPacket *);
     ENET_API enet_uint32  enet_crc32(const ENetBuffer *, size_t);
 
+    ENET_API void * enet_lz_create(const void *, size_t);
+    ENET_API void   enet_lz_destroy(void *);
+    ENET_API size_t enet_lz_compress(void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
+    ENET_API size_t enet_lz_decompress(void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
+
     extern size_t enet_protocol_command_size (enet_uint8);
 
 #if defined(ENET_IMPLEMENTATION) && !defined(ENET_IMPLEMENTATION_DONE)
@@ -1397,6 +2246,63 @@
         callbacks.free(memory);
     }
 
+// =======================================================================//
+// !
+// ! Pool
+// !
+// =======================================================================//
+
+    ENetPool::ENetPool(size_t blockSize, size_t slabBlocks)
+    {
+        const size_t alignment = alignof(std::max_align_t);
+
+        this->blockSize  = (std::max(blockSize, sizeof(void *)) + alignment - 1) & ~(alignment - 1);
+        this->slabBlocks = slabBlocks > 0 ? slabBlocks : ENET_POOL_DEFAULT_SLAB_BLOCKS;
+    }
+
+    ENetPool::~ENetPool()
+    {
+        for (auto slab : this->slabs)
+        {
+            enet_free(slab);
+        }
+    }
+
+    void *ENetPool::allocate()
+    {
+        void *block = this->freeBlocks;
+
+        if (block != nullptr)
+        {
+            this->freeBlocks = *(void **) block;
+            ++this->hits;
+
+            return block;
+        }
+
+        enet_uint8 *slab = (enet_uint8 *) enet_malloc(this->blockSize * this->slabBlocks);
+
+        if (slab == nullptr) {
+            return nullptr;
+        }
+
+        this->slabs.push_back(slab);
+        ++this->misses;
+
+        for (size_t i = this->slabBlocks - 1; i > 0; --i)
+        {
+            this->release(slab + i * this->blockSize);
+        }
+
+        return slab;
+    }
+
+    void ENetPool::release(void *block)
+    {
+        *(void **) block = this->freeBlocks;
+        this->freeBlocks = block;
+    }
+
 // =======================================================================//
 // !
 // ! List
@@ -1455,6 +2361,164 @@
         return size;
     }
 
+// =======================================================================//
+// !
+// ! Timer wheel
+// !
+// =======================================================================//
+
+    ENetTimerWheel::ENetTimerWheel()
+    {
+        for (auto &level : this->slots)
+        {
+            for (auto &slot : level)
+            {
+                enet_list_clear(&slot);
+            }
+        }
+
+        this->time = enet_time_get_us() / ENET_TIME_MILLISECOND;
+    }
+
+    void ENetTimerWheel::place(ENetTimer *timer)
+    {
+        enet_uint64 delta = timer->expires - this->tick;
+        size_t level = 0;
+
+        while (level < ENET_TIMER_WHEEL_LEVELS - 1 &&
+               delta >= (enet_uint64) 1 << ((level + 1) * ENET_TIMER_WHEEL_SLOT_BITS))
+        {
+            ++level;
+        }
+
+        enet_list_insert(enet_list_end(&this->slots[level][(timer->expires >> (level * ENET_TIMER_WHEEL_SLOT_BITS)) & (ENET_TIMER_WHEEL_SLOTS - 1)]), timer);
+    }
+
+    /** Schedules the timer to expire at the given service time, replacing any earlier deadline.
+     *  @remarks deadlines are rounded up to the next millisecond tick, and deadlines that already
+     *  passed expire with the current tick.
+     */
+    void ENetTimerWheel::schedule(ENetTimer *timer, enet_uint64 deadline)
+    {
+        deadline = (deadline + ENET_TIME_MILLISECOND - 1) / ENET_TIME_MILLISECOND;
+
+        enet_uint64 delta = ENET_TIME_LESS_EQUAL(deadline, this->time) ? 0 : ENET_TIME_DIFFERENCE(deadline, this->time);
+        enet_uint64 limit = ((enet_uint64) 1 << (ENET_TIMER_WHEEL_LEVELS * ENET_TIMER_WHEEL_SLOT_BITS)) - 1;
+
+        this->cancel(timer);
+
+        timer->expires = this->tick + std::min(delta, limit);
+        this->place(timer);
+
+        ++this->timerCount;
+    }
+
+    void ENetTimerWheel::cancel(ENetTimer *timer)
+    {
+        if (timer->node.next == nullptr) {
+            return;
+        }
+
+        enet_list_remove(&timer->node);
+        timer->node.next = nullptr;
+
+        --this->timerCount;
+    }
+
+    /** Advances the wheel up to the given service time.
+     *  @returns the next timer that expired, which is no longer scheduled, or nullptr once none are left
+     */
+    ENetTimer *ENetTimerWheel::expire(enet_uint64 time)
+    {
+        time /= ENET_TIME_MILLISECOND;
+
+        for (;;)
+        {
+            ENetList *slot = &this->slots[0][this->tick & (ENET_TIMER_WHEEL_SLOTS - 1)];
+
+            if (!enet_list_empty(slot))
+            {
+                ENetTimer *timer = (ENetTimer *) enet_list_front(slot);
+
+                this->cancel(timer);
+
+                return timer;
+            }
+
+            if (!ENET_TIME_GREATER(time, this->time))
+            {
+                /* the clock went back, so later deadlines are measured from the new time */
+                this->time = time;
+
+                return nullptr;
+            }
+
+            if (this->timerCount == 0)
+            {
+                this->tick += ENET_TIME_DIFFERENCE(time, this->time);
+                this->time  = time;
+
+                return nullptr;
+            }
+
+            ++this->tick;
+            ++this->time;
+
+            for (size_t level = 1; level < ENET_TIMER_WHEEL_LEVELS &&
+                 !(this->tick & (((enet_uint64) 1 << (level * ENET_TIMER_WHEEL_SLOT_BITS)) - 1)); ++level)
+            {
+                ENetList *cascade = &this->slots[level][(this->tick >> (level * ENET_TIMER_WHEEL_SLOT_BITS)) & (ENET_TIMER_WHEEL_SLOTS - 1)];
+
+                while (!enet_list_empty(cascade))
+                {
+                    this->place((ENetTimer *) enet_list_remove(enet_list_begin(cascade)));
+                }
+            }
+        }
+    }
+
+    /** Returns the service time by which expire() has work to do: the earliest deadline in the first
+     *  level, or the next cascade of a later level if that comes sooner.
+     *  @returns ~0 if no timer is scheduled
+     */
+    enet_uint64 ENetTimerWheel::next_deadline()
+    {
+        enet_uint64 deadline = ~(enet_uint64) 0;
+
+        if (this->timerCount == 0)
+        {
+            return deadline;
+        }
+
+        for (enet_uint64 offset = 0; offset < ENET_TIMER_WHEEL_SLOTS; ++offset)
+        {
+            if (!enet_list_empty(&this->slots[0][(this->tick + offset) & (ENET_TIMER_WHEEL_SLOTS - 1)]))
+            {
+                deadline = this->time + offset;
+                break;
+            }
+        }
+
+        for (size_t level = 1; level < ENET_TIMER_WHEEL_LEVELS; ++level)
+        {
+            size_t shift = level * ENET_TIMER_WHEEL_SLOT_BITS;
+
+            /* the current slot of a level was cascaded when the tick entered it, so its timers are a rotation away */
+            for (enet_uint64 offset = 1; offset <= ENET_TIMER_WHEEL_SLOTS; ++offset)
+            {
+                enet_uint64 slot = (this->tick >> shift) + offset;
+
+                if (!enet_list_empty(&this->slots[level][slot & (ENET_TIMER_WHEEL_SLOTS - 1)]))
+                {
+                    deadline = std::min(deadline, this->time + ((slot << shift) - this->tick));
+                    break;
+                }
+            }
+        }
+
+        return deadline * ENET_TIME_MILLISECOND;
+    }
+
 // =======================================================================//
 // !
 // ! Packet
@@ -1500,6 +2564,9 @@
         packet->dataLength   = dataLength;
         packet->freeCallback   = nullptr;
         packet->userData       = nullptr;
+        packet->pool           = nullptr;
+        packet->poolClass      = 0;
+        packet->slab           = nullptr;
 
         return packet;
     }
@@ -1535,6 +2602,9 @@
         packet->dataLength   = dataLength + dataOffset;
         packet->freeCallback   = nullptr;
         packet->userData       = nullptr;
+        packet->pool           = nullptr;
+        packet->poolClass      = 0;
+        packet->slab           = nullptr;
 
         return packet;
     }
@@ -1542,6 +2612,10 @@
     /**
      * Destroys the packet and deallocates its data.
      * @param packet packet to be destroyed
+     * @remarks packets taken from a host's pool may be destroyed on any thread, as they are parked
+     * on the pool's returned stack until the host's thread reclaims them. A host that clears
+     * ENetPacketPool::concurrentRelease returns them to their class directly instead, and its
+     * packets must then only be destroyed on the thread servicing it.
      */
     void enet_packet_destroy(ENetPacket *packet) {
         if (packet == nullptr)
@@ -1554,886 +2628,1132 @@
             (*packet->freeCallback)((void *)packet);
         }
 
+        if (packet->pool != nullptr)
+        {
+            packet->pool->release(packet);
+            return;
+        }
+
         enet_free(packet);
     }
 
-    static int initializedCRC32 = 0;
-    static enet_uint32 crcTable[256];
-
-    static enet_uint32 reflect_crc(int val, int bits) {
-        int result = 0, bit;
+    /**
+     * Creates a packet whose storage is taken from a packet pool.
+     * @param pool         pool of the host the packet is created for
+     * @param data         initial contents of the packet's data; the packet's data will remain
+     * uninitialized if data is nullptr.
+     * @param dataLength   size of the data allocated for this packet
+     * @param flags        flags for this packet as described for the ENetPacket structure.
+     * @returns the packet on success, nullptr on failure
+     * @remarks packets larger than the biggest size class fall back to enet_packet_create.
+     */
+    ENetPacket *enet_packet_create_pooled(ENetPacketPool *pool, const void *data, size_t dataLength, enet_uint32 flags) {
+        ENetPacket *packet;
 
-        for (bit = 0; bit < bits; bit++) {
-            if (val & 1) { result |= 1 << (bits - 1 - bit); }
-            val >>= 1;
+        if (pool == nullptr)
+        {
+            return enet_packet_create(data, dataLength, flags);
         }
 
-        return result;
-    }
-
-    static void initialize_crc32(void) {
-        for (auto byte = 0; byte < 256; ++byte)
+        packet = pool->allocate(flags & ENET_PACKET_FLAG_NO_ALLOCATE ? 0 : dataLength);
+        if (packet == nullptr)
         {
-            enet_uint32 crc = reflect_crc(byte, 8) << 24;
-
-            for (auto offset = 0; offset < 8; ++offset)
+            if (dataLength > ENET_PROTOCOL_MAXIMUM_MTU && !(flags & ENET_PACKET_FLAG_NO_ALLOCATE))
             {
-                if (crc & 0x80000000) {
-                    crc = (crc << 1) ^ 0x04c11db7;
-                } else {
-                    crc <<= 1;
-                }
+                ++pool->largeAllocations;
+                return enet_packet_create(data, dataLength, flags);
             }
 
-            crcTable[byte] = reflect_crc(crc, 32);
+            return nullptr;
+        }
+
+        if (flags & ENET_PACKET_FLAG_NO_ALLOCATE) {
+            packet->data = (enet_uint8 *)data;
+        }
+        else {
+            packet->data = (enet_uint8 *)packet + sizeof(ENetPacket);
+
+            if (data != nullptr)
+            {
+                memcpy(packet->data, data, dataLength);
+            }
         }
 
-        initializedCRC32 = 1;
+        packet->referenceCount = 0;
+        packet->flags        = flags;
+        packet->dataLength   = dataLength;
+        packet->freeCallback   = nullptr;
+        packet->userData       = nullptr;
+
+        return packet;
     }
 
-    enet_uint32 enet_crc32(const ENetBuffer *buffers, size_t bufferCount) {
-        enet_uint32 crc = 0xFFFFFFFF;
+    static ENetPool enet_packet_pool_class(int sizeClass)
+    {
+        const size_t blockSize = sizeof(ENetPacket) + ((size_t) ENET_PACKET_POOL_MINIMUM_CLASS_SIZE << sizeClass);
 
-        if (!initializedCRC32) { initialize_crc32(); }
+        return ENetPool(blockSize, std::max<size_t>(ENET_PACKET_POOL_SLAB_SIZE / blockSize, 8));
+    }
 
-        while (bufferCount-- > 0) {
-            const enet_uint8 *data = (const enet_uint8 *)buffers->data;
-            const enet_uint8 *dataEnd = &data[buffers->dataLength];
+    ENetPacketPool::ENetPacketPool()
+        : classes{{enet_packet_pool_class(0), enet_packet_pool_class(1), enet_packet_pool_class(2),
+                   enet_packet_pool_class(3), enet_packet_pool_class(4), enet_packet_pool_class(5),
+                   enet_packet_pool_class(6)}}
+    {
+        static_assert(((size_t) ENET_PACKET_POOL_MINIMUM_CLASS_SIZE << (ENET_PACKET_POOL_CLASS_COUNT - 1)) == ENET_PROTOCOL_MAXIMUM_MTU);
+    }
 
-            while (data < dataEnd) {
-                crc = (crc >> 8) ^ crcTable[(crc & 0xFF) ^ *data++];
-            }
+    ENetPacketPool::~ENetPacketPool()
+    {
+        this->reclaim();
 
-            ++buffers;
-        }
+        while (this->freeSlabs != nullptr)
+        {
+            ENetReceiveSlab *slab = this->freeSlabs;
 
-        return ENET_HOST_TO_NET_32(~crc);
+            this->freeSlabs = slab->next;
+            enet_free(slab);
+        }
     }
 
-// =======================================================================//
-// !
-// ! Protocol
-// !
-// =======================================================================//
+    /** Takes a packet able to hold dataLength bytes from the smallest fitting size class.
+     *  @retval nullptr if dataLength exceeds the largest class or memory is exhausted
+     */
+    ENetPacket *ENetPacketPool::allocate(size_t dataLength)
+    {
+        enet_uint8 sizeClass = 0;
+        ENetPacket *packet;
 
-    static size_t commandSizes[ENET_PROTOCOL_COMMAND_COUNT] = {
-        0,
-        sizeof(ENetProtocolAcknowledge),
-        sizeof(ENetProtocolConnect),
-        sizeof(ENetProtocolVerifyConnect),
-        sizeof(ENetProtocolDisconnect),
-        sizeof(ENetProtocolPing),
-        sizeof(ENetProtocolSendReliable),
-        sizeof(ENetProtocolSendUnreliable),
-        sizeof(ENetProtocolSendFragment),
-        sizeof(ENetProtocolSendUnsequenced),
-        sizeof(ENetProtocolBandwidthLimit),
-        sizeof(ENetProtocolThrottleConfigure),
-        sizeof(ENetProtocolSendFragment)
-    };
+        while (dataLength > ((size_t) ENET_PACKET_POOL_MINIMUM_CLASS_SIZE << sizeClass))
+        {
+            if (++sizeClass >= ENET_PACKET_POOL_CLASS_COUNT) {
+                return nullptr;
+            }
+        }
 
-    size_t enet_protocol_command_size(enet_uint8 commandNumber) {
-        return commandSizes[commandNumber & ENET_PROTOCOL_COMMAND_MASK];
+        if (this->classes[sizeClass].freeBlocks == nullptr && this->returned.load(std::memory_order_relaxed) != nullptr) {
+            this->reclaim();
+        }
+
+        packet = (ENetPacket *) this->classes[sizeClass].allocate();
+        if (packet == nullptr) {
+            return nullptr;
+        }
+
+        packet->pool      = this;
+        packet->poolClass = sizeClass;
+        packet->slab      = nullptr;
+        ++this->references;
+
+        return packet;
     }
 
-    static void enet_protocol_change_state([[maybe_unused]] ENetHost *host, ENetPeer *peer, ENetPeerState state)
+    /** Returns a packet to its class; with concurrentRelease, the default, it is parked on the
+     *  returned stack until the host's thread reclaims it. */
+    void ENetPacketPool::release(ENetPacket *packet)
     {
-        if (state == ENetPeerState::CONNECTED || state == ENetPeerState::DISCONNECT_LATER)
+        if (this->concurrentRelease)
         {
-            peer->on_connect();
+            ENetPacket *head = this->returned.load(std::memory_order_relaxed);
+
+            do {
+                *(ENetPacket **) packet = head;
+            } while (!this->returned.compare_exchange_weak(head, packet, std::memory_order_release,
+                                                           std::memory_order_relaxed));
         }
         else
         {
-            peer->on_disconnect();
+            if (packet->slab != nullptr) {
+                this->release_slab(packet->slab);
+            }
+
+            this->classes[packet->poolClass].release(packet);
         }
 
-        peer->state = state;
+        this->unreference();
     }
 
-    static void enet_protocol_dispatch_state(ENetHost *host, ENetPeer *peer, ENetPeerState state) {
-        enet_protocol_change_state(host, peer, state);
+    /** Moves the packets destroyed by other threads back into their classes. */
+    void ENetPacketPool::reclaim()
+    {
+        ENetPacket *packet = this->returned.exchange(nullptr, std::memory_order_acquire);
 
-        if (!peer->needsDispatch) {
-            host->dispatchQueue.push_back(peer);
-            peer->needsDispatch = 1;
+        while (packet != nullptr)
+        {
+            ENetPacket *next = *(ENetPacket **) packet;
+
+            if (packet->slab != nullptr) {
+                this->release_slab(packet->slab);
+            }
+
+            this->classes[packet->poolClass].release(packet);
+            packet = next;
         }
     }
 
-    static bool enet_protocol_dispatch_incoming_commands(ENetHost *host, ENetEvent &event)
+    /** Takes a receive slab of size bytes, reusing a free one when the size matches.
+     *  @retval nullptr if memory is exhausted
+     */
+    ENetReceiveSlab *ENetPacketPool::acquire_slab(size_t size)
     {
-        while (!host->dispatchQueue.empty())
-        {
-            ENetPeer *peer = host->dispatchQueue.front();
-            host->dispatchQueue.pop_front();
-            peer->needsDispatch = 0;
+        ENetReceiveSlab *slab;
 
-            switch (peer->state)
+        if (size != this->slabSize)
+        {
+            while (this->freeSlabs != nullptr)
             {
-            case ENetPeerState::CONNECTION_PENDING:
-            case ENetPeerState::CONNECTION_SUCCEEDED:
-                enet_protocol_change_state(host, peer, ENetPeerState::CONNECTED);
+                slab            = this->freeSlabs;
+                this->freeSlabs = slab->next;
+                enet_free(slab);
+            }
 
-                event.type = ENetEventType::CONNECT;
-                event.peer = peer;
-                event.data = peer->eventData;
+            this->slabSize = size;
+        }
 
-                return 1;
+        if (this->freeSlabs == nullptr && this->returned.load(std::memory_order_relaxed) != nullptr) {
+            this->reclaim();
+        }
 
-            case ENetPeerState::ZOMBIE:
-                host->recalculateBandwidthLimits = 1;
+        slab = this->freeSlabs;
+        if (slab != nullptr) {
+            this->freeSlabs = slab->next;
+        } else {
+            slab = (ENetReceiveSlab *) enet_malloc(sizeof(ENetReceiveSlab) + size);
+            if (slab == nullptr) {
+                return nullptr;
+            }
 
-                event.type = ENetEventType::DISCONNECT;
-                event.peer = peer;
-                event.data = peer->eventData;
+            slab->size = size;
+        }
 
-                peer->reset();
+        slab->references = 1;
+        return slab;
+    }
 
-                return 1;
+    /** Drops one reference to a receive slab, keeping it for reuse once nothing points into it;
+     *  host thread only, see ENetReceiveSlab. */
+    void ENetPacketPool::release_slab(ENetReceiveSlab *slab)
+    {
+        if (--slab->references > 0) {
+            return;
+        }
 
-            case ENetPeerState::CONNECTED:
-                if (enet_list_empty(&peer->dispatchedCommands))
-                {
-                    continue;
-                }
+        if (slab->size != this->slabSize) {
+            enet_free(slab);
+            return;
+        }
 
-                event.packet = peer->receive(&event.channelID);
-                if (event.packet == nullptr)
-                {
-                    continue;
-                }
+        slab->next      = this->freeSlabs;
+        this->freeSlabs = slab;
+    }
 
-                event.type = ENetEventType::RECEIVE;
-                event.peer = peer;
+    /** Drops one reference, destroying the pool and its slabs with the last one. */
+    void ENetPacketPool::unreference()
+    {
+        if (this->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
 
-                if (!enet_list_empty(&peer->dispatchedCommands))
-                {
-                    peer->needsDispatch = 1;
-                    host->dispatchQueue.push_back(peer);
-                }
+    /** Reflected CRC-32 tables for slicing by 8 bytes; crcTables[0] is the classic byte table. */
+    static constexpr std::array<std::array<enet_uint32, 256>, 8> enet_crc32_tables() {
+        std::array<std::array<enet_uint32, 256>, 8> tables = {};
 
-                return 1;
+        for (enet_uint32 byte = 0; byte < 256; ++byte)
+        {
+            enet_uint32 crc = byte;
 
-            default:
-                break;
+            for (auto bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
             }
+
+            tables[0][byte] = crc;
         }
 
-        return 0;
-    } /* enet_protocol_dispatch_incoming_commands */
+        for (enet_uint32 byte = 0; byte < 256; ++byte)
+        {
+            for (size_t slice = 1; slice < 8; ++slice)
+            {
+                tables[slice][byte] = (tables[slice - 1][byte] >> 8) ^ tables[0][tables[slice - 1][byte] & 0xFF];
+            }
+        }
 
-    static void enet_protocol_notify_connect(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
-        host->recalculateBandwidthLimits = 1;
+        return tables;
+    }
 
-        if (event != nullptr)
-        {
-            enet_protocol_change_state(host, peer, ENetPeerState::CONNECTED);
+    static constexpr auto crcTables = enet_crc32_tables();
 
-            peer->totalDataSent     = 0;
-            peer->totalDataReceived = 0;
-            peer->totalPacketsSent  = 0;
-            peer->totalPacketsLost  = 0;
+    static enet_uint32 enet_crc32_update_slice8(enet_uint32 crc, const enet_uint8 *data, size_t dataLength) {
+        for (; dataLength >= 8; data += 8, dataLength -= 8)
+        {
+            enet_uint32 low  = crc ^ ((enet_uint32)data[0] | (enet_uint32)data[1] << 8 | (enet_uint32)data[2] << 16 | (enet_uint32)data[3] << 24);
+            enet_uint32 high = (enet_uint32)data[4] | (enet_uint32)data[5] << 8 | (enet_uint32)data[6] << 16 | (enet_uint32)data[7] << 24;
 
-            event->type = ENetEventType::CONNECT;
-            event->peer = peer;
-            event->data = peer->eventData;
+            crc = crcTables[7][low & 0xFF] ^ crcTables[6][(low >> 8) & 0xFF] ^ crcTables[5][(low >> 16) & 0xFF] ^ crcTables[4][low >> 24] ^
+                  crcTables[3][high & 0xFF] ^ crcTables[2][(high >> 8) & 0xFF] ^ crcTables[1][(high >> 16) & 0xFF] ^ crcTables[0][high >> 24];
         }
-        else
-        {
-            enet_protocol_dispatch_state(host, peer,
-                                         peer->state == ENetPeerState::CONNECTING
-                                             ? ENetPeerState::CONNECTION_SUCCEEDED
-                                             : ENetPeerState::CONNECTION_PENDING);
+
+        while (dataLength-- > 0) {
+            crc = (crc >> 8) ^ crcTables[0][(crc & 0xFF) ^ *data++];
         }
+
+        return crc;
     }
 
-    static void enet_protocol_notify_disconnect(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
-        if (peer->state >= ENetPeerState::CONNECTION_PENDING)
-        {
-            host->recalculateBandwidthLimits = 1;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(ENET_NO_PCLMUL)
+    #define ENET_HAS_PCLMUL 1 /**< CRC-32 may be folded with carry-less multiplication */
+    #include <immintrin.h>
+
+    /**
+     * Folds the bulk of a buffer with PCLMULQDQ, four 128-bit lanes at a time, and reduces the
+     * remainder with a bit-reflected Barrett reduction. Unaligned or short heads and the tail
+     * that is not a multiple of 16 bytes are handled by the slice-by-8 loop.
+     */
+    __attribute__((target("pclmul,sse4.1")))
+    static enet_uint32 enet_crc32_update_pclmul(enet_uint32 crc, const enet_uint8 *data, size_t dataLength) {
+        if (dataLength < 64) {
+            return enet_crc32_update_slice8(crc, data, dataLength);
         }
 
-        if (peer->state != ENetPeerState::CONNECTING &&
-            peer->state < ENetPeerState::CONNECTION_SUCCEEDED)
+        const __m128i k1k2  = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+        const __m128i k3k4  = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+        const __m128i k5    = _mm_set_epi64x(0, 0x163cd6124);
+        const __m128i poly  = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+        const __m128i mask32 = _mm_set_epi32(0, 0, 0, -1);
+
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(data + 0x00));
+        __m128i x2 = _mm_loadu_si128((const __m128i *)(data + 0x10));
+        __m128i x3 = _mm_loadu_si128((const __m128i *)(data + 0x20));
+        __m128i x4 = _mm_loadu_si128((const __m128i *)(data + 0x30));
+
+        x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+        data += 64;
+        dataLength -= 64;
+
+        for (; dataLength >= 64; data += 64, dataLength -= 64)
         {
-            peer->reset();
+            x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x00), _mm_clmulepi64_si128(x1, k1k2, 0x11)),
+                               _mm_loadu_si128((const __m128i *)(data + 0x00)));
+            x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x00), _mm_clmulepi64_si128(x2, k1k2, 0x11)),
+                               _mm_loadu_si128((const __m128i *)(data + 0x10)));
+            x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x00), _mm_clmulepi64_si128(x3, k1k2, 0x11)),
+                               _mm_loadu_si128((const __m128i *)(data + 0x20)));
+            x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x00), _mm_clmulepi64_si128(x4, k1k2, 0x11)),
+                               _mm_loadu_si128((const __m128i *)(data + 0x30)));
         }
-        else if (event != nullptr)
+
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)), x2);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)), x3);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)), x4);
+
+        for (; dataLength >= 16; data += 16, dataLength -= 16)
         {
-            event->type = ENetEventType::DISCONNECT;
-            event->peer = peer;
-            event->data = 0;
+            x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), _mm_clmulepi64_si128(x1, k3k4, 0x11)),
+                               _mm_loadu_si128((const __m128i *)data));
+        }
 
-            peer->reset();
+        /* 128 bits to 64 bits, appending 32 zero bits */
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x10), _mm_srli_si128(x1, 8));
+
+        /* 64 bits to 32 bits */
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00), _mm_srli_si128(x1, 4));
+
+        /* Barrett reduction */
+        __m128i x2b = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+        x2b = _mm_clmulepi64_si128(_mm_and_si128(x2b, mask32), poly, 0x00);
+        crc = (enet_uint32)_mm_extract_epi32(_mm_xor_si128(x1, x2b), 1);
+
+        return enet_crc32_update_slice8(crc, data, dataLength);
+    }
+#endif
+
+    typedef enet_uint32 (*ENetCRC32Update)(enet_uint32, const enet_uint8 *, size_t);
+
+    static ENetCRC32Update enet_crc32_select(void) {
+#if defined(ENET_HAS_PCLMUL)
+        if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+            return enet_crc32_update_pclmul;
         }
-        else
-        {
-            peer->eventData = 0;
-            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+#endif
+
+        return enet_crc32_update_slice8;
+    }
+
+    enet_uint32 enet_crc32(const ENetBuffer *buffers, size_t bufferCount) {
+        static const ENetCRC32Update update = enet_crc32_select();
+        enet_uint32 crc = 0xFFFFFFFF;
+
+        while (bufferCount-- > 0) {
+            crc = update(crc, (const enet_uint8 *)buffers->data, buffers->dataLength);
+
+            ++buffers;
         }
+
+        return ENET_HOST_TO_NET_32(~crc);
     }
 
-    static void enet_protocol_notify_disconnect_timeout (ENetHost * host, ENetPeer * peer, ENetEvent * event) {
-        if (peer->state >= ENetPeerState::CONNECTION_PENDING)
+// =======================================================================//
+// !
+// ! LZ compressor
+// !
+// =======================================================================//
+
+    static inline enet_uint32 enet_lz_read32(const enet_uint8 *data) {
+        enet_uint32 value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    static inline enet_uint32 enet_lz_hash(enet_uint32 sequence) {
+        return (sequence * 2654435761U) >> (32 - ENET_LZ_HASH_LOG);
+    }
+
+    /**
+     * Creates a context for the built-in compressor.
+     * @param dictionary preset dictionary matches may refer to, may be nullptr
+     * @param dictionaryLength length of the dictionary; only its last ENET_LZ_DICTIONARY_MAXIMUM bytes are used
+     * @returns the context on success, nullptr on failure
+     */
+    void *enet_lz_create(const void *dictionary, size_t dictionaryLength) {
+        ENetLZ *lz = (ENetLZ *) enet_malloc(sizeof(ENetLZ));
+
+        if (lz == nullptr)
         {
-            host->recalculateBandwidthLimits = 1;
+            return nullptr;
         }
 
-        if (peer->state != ENetPeerState::CONNECTING &&
-            peer->state < ENetPeerState::CONNECTION_SUCCEEDED)
+        memset(lz->table, 0, sizeof(lz->table));
+        memset(lz->dictionaryTable, 0, sizeof(lz->dictionaryTable));
+        lz->base = 1;
+
+        if (dictionary == nullptr) {
+            dictionaryLength = 0;
+        } else if (dictionaryLength > ENET_LZ_DICTIONARY_MAXIMUM) {
+            dictionary        = (const enet_uint8 *) dictionary + dictionaryLength - ENET_LZ_DICTIONARY_MAXIMUM;
+            dictionaryLength  = ENET_LZ_DICTIONARY_MAXIMUM;
+        }
+
+        lz->dictionaryLength = dictionaryLength;
+        if (dictionaryLength > 0)
         {
-            peer->reset();
+            memcpy(lz->dictionary, dictionary, dictionaryLength);
         }
-        else if (event != nullptr)
+
+        for (size_t position = 0; position + ENET_LZ_MINIMUM_MATCH <= dictionaryLength; ++position)
         {
-            event->type = ENetEventType::DISCONNECT_TIMEOUT;
-            event->peer = peer;
-            event->data = 0;
+            ENetLZEntry *entry = &lz->dictionaryTable[enet_lz_hash(enet_lz_read32(&lz->dictionary[position]))];
 
-            peer->reset();
-        }
-        else {
-            peer->eventData = 0;
-            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+            entry->data     = &lz->dictionary[position];
+            entry->position = (enet_uint32) position;
+            entry->limit    = (enet_uint32) dictionaryLength;
         }
+
+        return lz;
     }
 
-    static void enet_protocol_remove_sent_unreliable_commands(ENetPeer *peer) {
-        ENetOutgoingCommand *outgoingCommand;
+    void enet_lz_destroy(void *context) {
+        enet_free(context);
+    }
 
-        while (!peer->sentUnreliableCommands.empty())
-        {
-            outgoingCommand = peer->sentUnreliableCommands.front();
-            enet_list_remove(&outgoingCommand->outgoingCommandList);
+    static enet_uint8 *enet_lz_write_length(enet_uint8 *out, size_t length) {
+        for (; length >= 255; length -= 255) {
+            *out++ = 255;
+        }
 
-            if (outgoingCommand->packet != nullptr)
-            {
-                --outgoingCommand->packet->referenceCount;
+        *out++ = (enet_uint8) length;
+        return out;
+    }
 
-                if (outgoingCommand->packet->referenceCount == 0) {
-                    outgoingCommand->packet->flags |= ENET_PACKET_FLAG_SENT;
-                    enet_packet_destroy(outgoingCommand->packet);
-                }
-            }
+    /** Emits the literals from the anchor buffer and offset up to literalLength bytes, then a match unless matchLength is 0. */
+    static enet_uint8 *enet_lz_write_sequence(enet_uint8 *out, enet_uint8 *outEnd, const ENetBuffer *anchorBuffer,
+                                              size_t anchorOffset, size_t literalLength, size_t offset, size_t matchLength) {
+        size_t required = 1 + literalLength + literalLength / 255 + 1 + (matchLength > 0 ? 2 + matchLength / 255 + 1 : 0);
+        size_t matchCode = matchLength > 0 ? matchLength - ENET_LZ_MINIMUM_MATCH : 0;
+        enet_uint8 *token;
 
-            enet_free(outgoingCommand);
+        if ((size_t) (outEnd - out) < required) {
+            return nullptr;
         }
-    }
 
-    static ENetProtocolCommand enet_protocol_remove_sent_reliable_command(ENetPeer *peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID) {
-        ENetOutgoingCommand *outgoingCommand = nullptr;
-        ENetListIterator     currentCommand;
-        ENetProtocolCommand commandNumber;
-        int                  wasSent = 1;
+        token  = out++;
+        *token = (enet_uint8) ((literalLength >= 15 ? 15 : literalLength) << 4 | (matchCode >= 15 ? 15 : matchCode));
+
+        if (literalLength >= 15) {
+            out = enet_lz_write_length(out, literalLength - 15);
+        }
 
-        for (currentCommand = enet_list_begin(&peer->sentReliableCommands);
-             currentCommand != enet_list_end(&peer->sentReliableCommands);
-             currentCommand = enet_list_next(currentCommand))
+        while (literalLength > 0)
         {
-            outgoingCommand = (ENetOutgoingCommand *)currentCommand;
+            size_t chunk = std::min(literalLength, anchorBuffer->dataLength - anchorOffset);
 
-            if (outgoingCommand->reliableSequenceNumber == reliableSequenceNumber &&
-                outgoingCommand->command.header.channelID == channelID)
+            if (chunk > 0)
             {
-                break;
+                memcpy(out, (const enet_uint8 *) anchorBuffer->data + anchorOffset, chunk);
+                out           += chunk;
+                literalLength -= chunk;
             }
+
+            ++anchorBuffer;
+            anchorOffset = 0;
         }
 
-        if (currentCommand == enet_list_end(&peer->sentReliableCommands))
+        if (matchLength > 0)
         {
-            for (currentCommand = enet_list_begin(&peer->outgoingReliableCommands);
-                currentCommand != enet_list_end(&peer->outgoingReliableCommands);
-                currentCommand = enet_list_next(currentCommand)
-            ) {
-                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+            *out++ = (enet_uint8) (offset & 0xFF);
+            *out++ = (enet_uint8) (offset >> 8);
 
-                if (outgoingCommand->sendAttempts < 1) { return ENET_PROTOCOL_COMMAND_NONE; }
-                if (outgoingCommand->reliableSequenceNumber == reliableSequenceNumber && outgoingCommand->command.header.channelID == channelID) {
-                    break;
-                }
+            if (matchCode >= 15) {
+                out = enet_lz_write_length(out, matchCode - 15);
             }
+        }
 
-            if (currentCommand == enet_list_end(&peer->outgoingReliableCommands)) {
-                return ENET_PROTOCOL_COMMAND_NONE;
-            }
+        return out;
+    }
 
-            wasSent = 0;
+    /**
+     * Compresses a datagram in the LZ4 block format, reading the buffers in place.
+     *
+     * Matches never cross a buffer boundary on either side, so every candidate can be compared
+     * through the pointer it was recorded with; literal runs may span any number of buffers.
+     */
+    size_t enet_lz_compress(void *context, const ENetBuffer *inBuffers, size_t inBufferCount, size_t inLimit,
+                            enet_uint8 *outData, size_t outLimit) {
+        ENetLZ *           lz           = (ENetLZ *) context;
+        enet_uint8 *       out          = outData;
+        enet_uint8 *       outEnd       = outData + outLimit;
+        const ENetBuffer * anchorBuffer = inBuffers;
+        size_t             anchorOffset = 0;
+        enet_uint32        anchor, position, base;
+
+        if (lz->base > 0xFFFFFFFFU - inLimit - ENET_LZ_MAXIMUM_OFFSET)
+        {
+            memset(lz->table, 0, sizeof(lz->table));
+            lz->base = 1;
         }
 
-        if (outgoingCommand == nullptr)
+        base     = lz->base;
+        anchor   = base;
+        position = base;
+
+        for (const ENetBuffer *buffer = inBuffers; buffer < &inBuffers[inBufferCount]; ++buffer)
         {
-            return ENET_PROTOCOL_COMMAND_NONE;
-        }
+            const enet_uint8 *data   = (const enet_uint8 *) buffer->data;
+            const enet_uint8 *cursor = data;
+            const enet_uint8 *end    = data + buffer->dataLength;
+            enet_uint32       limit  = position + (enet_uint32) buffer->dataLength;
+            size_t            misses = 0;
 
-        if (channelID < peer->channelCount) {
-            ENetChannel *channel       = &peer->channels[channelID];
-            enet_uint16 reliableWindow = reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
-            if (channel->reliableWindows[reliableWindow] > 0) {
-                --channel->reliableWindows[reliableWindow];
-                if (!channel->reliableWindows[reliableWindow]) {
-                    channel->usedReliableWindows &= ~(1 << reliableWindow);
+            while (end - cursor >= ENET_LZ_MINIMUM_MATCH)
+            {
+                enet_uint32  current   = position + (enet_uint32) (cursor - data);
+                enet_uint32  sequence  = enet_lz_read32(cursor);
+                enet_uint32  hash      = enet_lz_hash(sequence);
+                ENetLZEntry  candidate = lz->table[hash];
+                size_t       length, maximum;
+
+                lz->table[hash] = {cursor, current, limit};
+
+                if (candidate.position < base || current - candidate.position > ENET_LZ_MAXIMUM_OFFSET)
+                {
+                    candidate = lz->dictionaryTable[hash];
+                    if (candidate.data == nullptr || current - (base - (enet_uint32) lz->dictionaryLength + candidate.position) > ENET_LZ_MAXIMUM_OFFSET)
+                    {
+                        cursor += 1 + (misses++ >> 5);
+                        continue;
+                    }
+
+                    candidate.position += base - (enet_uint32) lz->dictionaryLength;
+                    candidate.limit    += base - (enet_uint32) lz->dictionaryLength;
                 }
-            }
-        }
 
-        commandNumber = (ENetProtocolCommand) (outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK);
-        enet_list_remove(&outgoingCommand->outgoingCommandList);
+                if (enet_lz_read32(candidate.data) != sequence)
+                {
+                    cursor += 1 + (misses++ >> 5);
+                    continue;
+                }
 
-        if (outgoingCommand->packet != nullptr)
-        {
-            if (wasSent) {
-                peer->reliableDataInTransit -= outgoingCommand->fragmentLength;
-            }
+                maximum = std::min((size_t) (end - cursor), (size_t) (candidate.limit - candidate.position));
+                for (length = ENET_LZ_MINIMUM_MATCH; length < maximum && candidate.data[length] == cursor[length]; ++length)
+                    ;
 
-            --outgoingCommand->packet->referenceCount;
+                out = enet_lz_write_sequence(out, outEnd, anchorBuffer, anchorOffset, current - anchor,
+                                             current - candidate.position, length);
+                if (out == nullptr)
+                {
+                    lz->base = base + (enet_uint32) inLimit + 1;
+                    return 0;
+                }
 
-            if (outgoingCommand->packet->referenceCount == 0) {
-                outgoingCommand->packet->flags |= ENET_PACKET_FLAG_SENT;
-                enet_packet_destroy(outgoingCommand->packet);
+                cursor      += length;
+                anchor       = current + (enet_uint32) length;
+                anchorBuffer = buffer;
+                anchorOffset = cursor - data;
+                misses       = 0;
             }
+
+            position = limit;
         }
 
-        enet_free(outgoingCommand);
+        out = enet_lz_write_sequence(out, outEnd, anchorBuffer, anchorOffset, position - anchor, 0, 0);
+        lz->base = position + 1;
 
-        if (enet_list_empty(&peer->sentReliableCommands)) {
-            return commandNumber;
-        }
+        return out != nullptr ? (size_t) (out - outData) : 0;
+    }
 
-        outgoingCommand = (ENetOutgoingCommand *) enet_list_front(&peer->sentReliableCommands);
-        peer->nextTimeout = outgoingCommand->sentTime + outgoingCommand->roundTripTimeout;
+    static int enet_lz_read_length(const enet_uint8 **in, const enet_uint8 *inEnd, size_t *length) {
+        enet_uint8 byte;
 
-        return commandNumber;
-    } /* enet_protocol_remove_sent_reliable_command */
+        do {
+            if (*in >= inEnd) {
+                return -1;
+            }
 
-    static ENetPeer *enet_protocol_handle_connect([[maybe_unused]] ENetHost *host,
-            [[maybe_unused]] ENetProtocolHeader *header,
-            ENetProtocol *command)
-    {
-        enet_uint8 incomingSessionID, outgoingSessionID;
-        enet_uint32 mtu, windowSize;
-        size_t channelCount, duplicatePeers = 0;
-        ENetPeer *   peer = nullptr;
-        ENetProtocol verifyCommand;
+            byte     = *(*in)++;
+            *length += byte;
+        } while (byte == 255);
 
-        channelCount = ENET_NET_TO_HOST_32(command->connect.channelCount);
+        return 0;
+    }
 
-        if (channelCount < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT || channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
-            return nullptr;
-        }
+    /** Decompresses an LZ4 block whose matches may refer back into the preset dictionary. */
+    size_t enet_lz_decompress(void *context, const enet_uint8 *inData, size_t inLimit, enet_uint8 *outData, size_t outLimit) {
+        ENetLZ *          lz     = (ENetLZ *) context;
+        const enet_uint8 *in     = inData;
+        const enet_uint8 *inEnd  = inData + inLimit;
+        enet_uint8 *      out    = outData;
+        enet_uint8 *      outEnd = outData + outLimit;
 
-        for (auto &currentPeer : host->peers)
+        while (in < inEnd)
         {
-            if (currentPeer.state == ENetPeerState::DISCONNECTED)
-            {
-                if (peer == nullptr)
-                {
-                    peer = &currentPeer;
-                }
-            }
-            else if (currentPeer.state != ENetPeerState::CONNECTING &&
-                     in6_equal(currentPeer.address.host, host->receivedAddress.host))
-            {
-                if (currentPeer.address.port == host->receivedAddress.port &&
-                    currentPeer.connectID == command->connect.connectID)
-                {
-                    return nullptr;
-                }
+            enet_uint8 token         = *in++;
+            size_t     literalLength = token >> 4;
+            size_t     matchLength   = token & 15;
+            size_t     offset;
 
-                ++duplicatePeers;
+            if (literalLength == 15 && enet_lz_read_length(&in, inEnd, &literalLength) < 0) {
+                return 0;
             }
-        }
 
-        if (peer == nullptr || duplicatePeers >= host->duplicatePeers)
-        {
-            return nullptr;
-        }
+            if ((size_t) (inEnd - in) < literalLength || (size_t) (outEnd - out) < literalLength) {
+                return 0;
+            }
 
-        if (channelCount > host->channelLimit) {
-            channelCount = host->channelLimit;
-        }
-        peer->channels = (ENetChannel *) enet_malloc(channelCount * sizeof(ENetChannel));
-        if (peer->channels == nullptr)
-        {
-            return nullptr;
-        }
-        peer->channelCount               = channelCount;
-        peer->state                      = ENetPeerState::ACKNOWLEDGING_CONNECT;
-        peer->connectID                  = command->connect.connectID;
-        peer->address                    = host->receivedAddress;
-        peer->outgoingPeerID             = ENET_NET_TO_HOST_16(command->connect.outgoingPeerID);
-        peer->incomingBandwidth          = ENET_NET_TO_HOST_32(command->connect.incomingBandwidth);
-        peer->outgoingBandwidth          = ENET_NET_TO_HOST_32(command->connect.outgoingBandwidth);
-        peer->packetThrottleInterval     = ENET_NET_TO_HOST_32(command->connect.packetThrottleInterval);
-        peer->packetThrottleAcceleration = ENET_NET_TO_HOST_32(command->connect.packetThrottleAcceleration);
-        peer->packetThrottleDeceleration = ENET_NET_TO_HOST_32(command->connect.packetThrottleDeceleration);
-        peer->eventData                  = ENET_NET_TO_HOST_32(command->connect.data);
+            memcpy(out, in, literalLength);
+            in  += literalLength;
+            out += literalLength;
 
-        incomingSessionID = command->connect.incomingSessionID == 0xFF ? peer->outgoingSessionID : command->connect.incomingSessionID;
-        incomingSessionID = (incomingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
-        if (incomingSessionID == peer->outgoingSessionID) {
-            incomingSessionID = (incomingSessionID + 1)
-              & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
-        }
-        peer->outgoingSessionID = incomingSessionID;
+            if (in >= inEnd) {
+                break;
+            }
 
-        outgoingSessionID = command->connect.outgoingSessionID == 0xFF ? peer->incomingSessionID : command->connect.outgoingSessionID;
-        outgoingSessionID = (outgoingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
-        if (outgoingSessionID == peer->incomingSessionID) {
-            outgoingSessionID = (outgoingSessionID + 1)
-              & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
-        }
-        peer->incomingSessionID = outgoingSessionID;
+            if (inEnd - in < 2) {
+                return 0;
+            }
 
-        for (auto channel = peer->channels; channel < &peer->channels[channelCount]; ++channel)
-        {
-            channel->outgoingReliableSequenceNumber   = 0;
-            channel->outgoingUnreliableSequenceNumber = 0;
-            channel->incomingReliableSequenceNumber   = 0;
-            channel->incomingUnreliableSequenceNumber = 0;
+            offset = in[0] | (size_t) in[1] << 8;
+            in += 2;
 
-            enet_list_clear(&channel->incomingReliableCommands);
-            enet_list_clear(&channel->incomingUnreliableCommands);
+            if (matchLength == 15 && enet_lz_read_length(&in, inEnd, &matchLength) < 0) {
+                return 0;
+            }
 
-            channel->usedReliableWindows = 0;
-            channel->reliableWindows     = {0};
-        }
+            matchLength += ENET_LZ_MINIMUM_MATCH;
 
-        mtu = ENET_NET_TO_HOST_32(command->connect.mtu);
+            if (offset == 0 || offset > (size_t) (out - outData) + lz->dictionaryLength || (size_t) (outEnd - out) < matchLength) {
+                return 0;
+            }
 
-        if (mtu < ENET_PROTOCOL_MINIMUM_MTU) {
-            mtu = ENET_PROTOCOL_MINIMUM_MTU;
-        } else if (mtu > ENET_PROTOCOL_MAXIMUM_MTU) {
-            mtu = ENET_PROTOCOL_MAXIMUM_MTU;
-        }
+            if (offset > (size_t) (out - outData))
+            {
+                size_t            before = offset - (out - outData);
+                const enet_uint8 *match  = &lz->dictionary[lz->dictionaryLength - before];
+                size_t            chunk  = std::min(before, matchLength);
 
-        peer->mtu = mtu;
+                memcpy(out, match, chunk);
+                out         += chunk;
+                matchLength -= chunk;
+            }
 
-        if (host->outgoingBandwidth == 0 && peer->incomingBandwidth == 0) {
-            peer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
-        } else if (host->outgoingBandwidth == 0 || peer->incomingBandwidth == 0) {
-            peer->windowSize =
-                (std::max(host->outgoingBandwidth, peer->incomingBandwidth) /
-                 ENET_PEER_WINDOW_SIZE_SCALE) *
-                ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
-        } else {
-            peer->windowSize =
-                (std::min(host->outgoingBandwidth, peer->incomingBandwidth) /
-                 ENET_PEER_WINDOW_SIZE_SCALE) *
-                ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+            for (const enet_uint8 *match = out - offset; matchLength > 0; --matchLength) {
+                *out++ = *match++;
+            }
         }
 
-        if (peer->windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
-            peer->windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
-        } else if (peer->windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
-            peer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
-        }
+        return out - outData;
+    }
 
-        if (host->incomingBandwidth == 0) {
-            windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
-        } else {
-            windowSize = (host->incomingBandwidth / ENET_PEER_WINDOW_SIZE_SCALE) * ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
-        }
+// =======================================================================//
+// !
+// ! Protocol
+// !
+// =======================================================================//
 
-        if (windowSize > ENET_NET_TO_HOST_32(command->connect.windowSize)) {
-            windowSize = ENET_NET_TO_HOST_32(command->connect.windowSize);
-        }
+    static size_t commandSizes[ENET_PROTOCOL_COMMAND_COUNT] = {
+        0,
+        sizeof(ENetProtocolAcknowledge),
+        sizeof(ENetProtocolConnect),
+        sizeof(ENetProtocolVerifyConnect),
+        sizeof(ENetProtocolDisconnect),
+        sizeof(ENetProtocolPing),
+        sizeof(ENetProtocolSendReliable),
+        sizeof(ENetProtocolSendUnreliable),
+        sizeof(ENetProtocolSendFragment),
+        sizeof(ENetProtocolSendUnsequenced),
+        sizeof(ENetProtocolBandwidthLimit),
+        sizeof(ENetProtocolThrottleConfigure),
+        sizeof(ENetProtocolSendFragment),
+        sizeof(ENetProtocolAcknowledgeRange)
+    };
 
-        if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
-            windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
-        } else if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
-            windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    size_t enet_protocol_command_size(enet_uint8 commandNumber) {
+        return commandSizes[commandNumber & ENET_PROTOCOL_COMMAND_MASK];
+    }
+
+    /** Packs a session ID, or 0xFF for none, with the capabilities offered in a CONNECT command. */
+    static enet_uint8 enet_protocol_encode_session(enet_uint8 sessionID, enet_uint8 capabilities)
+    {
+        if (capabilities == 0) {
+            return sessionID;
         }
 
-        verifyCommand.header.command                            = ENET_PROTOCOL_COMMAND_VERIFY_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
-        verifyCommand.header.channelID                          = 0xFF;
-        verifyCommand.verifyConnect.outgoingPeerID              = ENET_HOST_TO_NET_16(peer->incomingPeerID);
-        verifyCommand.verifyConnect.incomingSessionID           = incomingSessionID;
-        verifyCommand.verifyConnect.outgoingSessionID           = outgoingSessionID;
-        verifyCommand.verifyConnect.mtu                         = ENET_HOST_TO_NET_32(peer->mtu);
-        verifyCommand.verifyConnect.windowSize                  = ENET_HOST_TO_NET_32(windowSize);
-        verifyCommand.verifyConnect.channelCount                = ENET_HOST_TO_NET_32(channelCount);
-        verifyCommand.verifyConnect.incomingBandwidth           = ENET_HOST_TO_NET_32(host->incomingBandwidth);
-        verifyCommand.verifyConnect.outgoingBandwidth           = ENET_HOST_TO_NET_32(host->outgoingBandwidth);
-        verifyCommand.verifyConnect.packetThrottleInterval      = ENET_HOST_TO_NET_32(peer->packetThrottleInterval);
-        verifyCommand.verifyConnect.packetThrottleAcceleration  = ENET_HOST_TO_NET_32(peer->packetThrottleAcceleration);
-        verifyCommand.verifyConnect.packetThrottleDeceleration  = ENET_HOST_TO_NET_32(peer->packetThrottleDeceleration);
-        verifyCommand.verifyConnect.connectID = peer->connectID;
+        return (sessionID == 0xFF ? ENET_PROTOCOL_SESSION_ID_UNSET : sessionID & ENET_PROTOCOL_SESSION_ID_MASK) |
+               ((capabilities & ENET_PROTOCOL_CAPABILITY_MASK) << ENET_PROTOCOL_CAPABILITY_SHIFT);
+    }
 
-        peer->queue_outgoing_command(&verifyCommand, nullptr, 0, 0);
-        return peer;
-    } /* enet_protocol_handle_connect */
+    /** Splits a session byte of CONNECT or VERIFY_CONNECT.
+     *  @param sessionID receives the session ID, or 0xFF if none was set
+     *  @retval the capabilities carried alongside it
+     */
+    static enet_uint8 enet_protocol_decode_session(enet_uint8 data, enet_uint8 *sessionID)
+    {
+        if (data == 0xFF) {
+            *sessionID = 0xFF;
+            return 0;
+        }
 
-    static int enet_protocol_handle_send_reliable(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
-        size_t dataLength;
+        *sessionID = (data & ENET_PROTOCOL_SESSION_ID_UNSET) ? 0xFF : data & ENET_PROTOCOL_SESSION_ID_MASK;
+        return (data >> ENET_PROTOCOL_CAPABILITY_SHIFT) & ENET_PROTOCOL_CAPABILITY_MASK;
+    }
 
-        if (command->header.channelID >= peer->channelCount ||
-            (peer->state != ENetPeerState::CONNECTED &&
-             peer->state != ENetPeerState::DISCONNECT_LATER))
+    static void enet_protocol_change_state(ENetHost *host, ENetPeer *peer, ENetPeerState state)
+    {
+        if (peer->state == ENetPeerState::CONNECTING && state != ENetPeerState::CONNECTING)
         {
-            return -1;
+            host->index_peer(peer);
         }
 
-        dataLength    = ENET_NET_TO_HOST_16(command->sendReliable.dataLength);
-        *currentData += dataLength;
-
-        if (dataLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
-            return -1;
+        if (state == ENetPeerState::CONNECTED || state == ENetPeerState::DISCONNECT_LATER)
+        {
+            peer->on_connect();
         }
-
-        if (peer->queue_incoming_command(
-                command, (const enet_uint8 *)command + sizeof(ENetProtocolSendReliable), dataLength,
-                ENET_PACKET_FLAG_RELIABLE, 0) == nullptr)
+        else
         {
-            return -1;
+            peer->on_disconnect();
         }
 
-        return 0;
+        peer->state = state;
     }
 
-    static int enet_protocol_handle_send_unsequenced(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
-        enet_uint32 unsequencedGroup, index;
-        size_t dataLength;
+    static void enet_protocol_dispatch_state(ENetHost *host, ENetPeer *peer, ENetPeerState state) {
+        enet_protocol_change_state(host, peer, state);
 
-        if (command->header.channelID >= peer->channelCount ||
-            (peer->state != ENetPeerState::CONNECTED &&
-             peer->state != ENetPeerState::DISCONNECT_LATER))
-        {
-            return -1;
+        if (!peer->needsDispatch) {
+            host->dispatchQueue.push_back(peer);
+            peer->needsDispatch = 1;
         }
+    }
 
-        dataLength    = ENET_NET_TO_HOST_16(command->sendUnsequenced.dataLength);
-        *currentData += dataLength;
-        if (dataLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
-            return -1;
-        }
+    static bool enet_protocol_dispatch_incoming_commands(ENetHost *host, ENetEvent &event)
+    {
+        while (!host->dispatchQueue.empty())
+        {
+            ENetPeer *peer = host->dispatchQueue.front();
+            host->dispatchQueue.pop_front();
+            peer->needsDispatch = 0;
 
-        unsequencedGroup = ENET_NET_TO_HOST_16(command->sendUnsequenced.unsequencedGroup);
-        index = unsequencedGroup % ENET_PEER_UNSEQUENCED_WINDOW_SIZE;
+            switch (peer->state)
+            {
+            case ENetPeerState::CONNECTION_PENDING:
+            case ENetPeerState::CONNECTION_SUCCEEDED:
+                enet_protocol_change_state(host, peer, ENetPeerState::CONNECTED);
 
-        if (unsequencedGroup < peer->incomingUnsequencedGroup) {
-            unsequencedGroup += 0x10000;
-        }
+                event.type = ENetEventType::CONNECT;
+                event.peer = peer;
+                event.data = peer->eventData;
 
-        if (unsequencedGroup >= (enet_uint32) peer->incomingUnsequencedGroup + ENET_PEER_FREE_UNSEQUENCED_WINDOWS * ENET_PEER_UNSEQUENCED_WINDOW_SIZE) {
-            return 0;
-        }
+                return 1;
 
-        unsequencedGroup &= 0xFFFF;
+            case ENetPeerState::ZOMBIE:
+                host->recalculateBandwidthLimits = 1;
 
-        if (unsequencedGroup - index != peer->incomingUnsequencedGroup) {
-            peer->incomingUnsequencedGroup = unsequencedGroup - index;
-            peer->unsequencedWindow        = {0};
-        } else if (peer->unsequencedWindow[index / 32] & (1 << (index % 32))) {
-            return 0;
-        }
+                event.type = ENetEventType::DISCONNECT;
+                event.peer = peer;
+                event.data = peer->eventData;
 
-        if (peer->queue_incoming_command(
-                command, (const enet_uint8 *)command + sizeof(ENetProtocolSendUnsequenced),
-                dataLength, ENET_PACKET_FLAG_UNSEQUENCED, 0) == nullptr)
-        {
-            return -1;
-        }
+                peer->reset();
 
-        peer->unsequencedWindow[index / 32] |= 1 << (index % 32);
+                return 1;
 
-        return 0;
-    } /* enet_protocol_handle_send_unsequenced */
+            case ENetPeerState::CONNECTED:
+                if (enet_list_empty(&peer->dispatchedCommands))
+                {
+                    continue;
+                }
 
-    static int enet_protocol_handle_send_unreliable(ENetHost *host, ENetPeer *peer, const ENetProtocol *command,
-      enet_uint8 **currentData) {
-        size_t dataLength;
+                event.packet = peer->receive(&event.channelID);
+                if (event.packet == nullptr)
+                {
+                    continue;
+                }
 
-        if (command->header.channelID >= peer->channelCount ||
-            (peer->state != ENetPeerState::CONNECTED &&
-             peer->state != ENetPeerState::DISCONNECT_LATER))
-        {
-            return -1;
-        }
+                event.type = ENetEventType::RECEIVE;
+                event.peer = peer;
 
-        dataLength    = ENET_NET_TO_HOST_16(command->sendUnreliable.dataLength);
-        *currentData += dataLength;
-        if (dataLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
-            return -1;
-        }
+                if (!enet_list_empty(&peer->dispatchedCommands))
+                {
+                    peer->needsDispatch = 1;
+                    host->dispatchQueue.push_back(peer);
+                }
 
-        if (peer->queue_incoming_command(
-                command, (const enet_uint8 *)command + sizeof(ENetProtocolSendUnreliable),
-                dataLength, 0, 0) == nullptr)
-        {
-            return -1;
+                return 1;
+
+            default:
+                break;
+            }
         }
 
         return 0;
-    }
+    } /* enet_protocol_dispatch_incoming_commands */
 
-    static int enet_protocol_handle_send_fragment(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
-        enet_uint32 fragmentNumber, fragmentCount, fragmentOffset, fragmentLength, startSequenceNumber, totalLength;
-        ENetChannel *channel;
-        enet_uint16 startWindow, currentWindow;
-        ENetListIterator currentCommand;
-        ENetIncomingCommand *startCommand = nullptr;
+    /** Fills events with up to maximum dispatched events.
+     *
+     *  Unlike enet_protocol_dispatch_incoming_commands, a connected peer stays at the front of
+     *  the dispatch queue until its received packets are drained or events is full, so busy peers
+     *  are not popped and pushed back once per packet.
+     *
+     *  @returns the number of events stored
+     */
+    static size_t enet_protocol_dispatch_incoming_events(ENetHost *host, ENetEvent *events, size_t maximum)
+    {
+        size_t count = 0;
 
-        if (command->header.channelID >= peer->channelCount ||
-            (peer->state != ENetPeerState::CONNECTED &&
-             peer->state != ENetPeerState::DISCONNECT_LATER))
+        while (count < maximum && !host->dispatchQueue.empty())
         {
-            return -1;
-        }
-
-        fragmentLength = ENET_NET_TO_HOST_16(command->sendFragment.dataLength);
-        *currentData  += fragmentLength;
-        if (fragmentLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
-            return -1;
-        }
-
-        channel = &peer->channels[command->header.channelID];
-        startSequenceNumber = ENET_NET_TO_HOST_16(command->sendFragment.startSequenceNumber);
-        startWindow         = startSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
-        currentWindow       = channel->incomingReliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
-
-        if (startSequenceNumber < channel->incomingReliableSequenceNumber) {
-            startWindow += ENET_PEER_RELIABLE_WINDOWS;
-        }
-
-        if (startWindow < currentWindow || startWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1) {
-            return 0;
-        }
-
-        fragmentNumber = ENET_NET_TO_HOST_32(command->sendFragment.fragmentNumber);
-        fragmentCount  = ENET_NET_TO_HOST_32(command->sendFragment.fragmentCount);
-        fragmentOffset = ENET_NET_TO_HOST_32(command->sendFragment.fragmentOffset);
-        totalLength    = ENET_NET_TO_HOST_32(command->sendFragment.totalLength);
+            ENetPeer *peer = host->dispatchQueue.front();
 
-        if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT ||
-            fragmentNumber >= fragmentCount ||
-            totalLength > host->maximumPacketSize ||
-            fragmentOffset >= totalLength ||
-            fragmentLength > totalLength - fragmentOffset
-        ) {
-            return -1;
-        }
+            if (peer->state != ENetPeerState::CONNECTED)
+            {
+                ENetEvent *event = &events[count];
 
-        for (currentCommand = enet_list_previous(enet_list_end(&channel->incomingReliableCommands));
-            currentCommand != enet_list_end(&channel->incomingReliableCommands);
-            currentCommand = enet_list_previous(currentCommand)
-        ) {
-            ENetIncomingCommand *incomingCommand = (ENetIncomingCommand *) currentCommand;
+                event->type   = ENetEventType::NONE;
+                event->peer   = nullptr;
+                event->packet = nullptr;
 
-            if (startSequenceNumber >= channel->incomingReliableSequenceNumber) {
-                if (incomingCommand->reliableSequenceNumber < channel->incomingReliableSequenceNumber) {
-                    continue;
+                if (enet_protocol_dispatch_incoming_commands(host, *event))
+                {
+                    ++count;
                 }
-            } else if (incomingCommand->reliableSequenceNumber >= channel->incomingReliableSequenceNumber) {
-                break;
+
+                continue;
             }
 
-            if (incomingCommand->reliableSequenceNumber <= startSequenceNumber) {
-                if (incomingCommand->reliableSequenceNumber < startSequenceNumber) {
-                    break;
-                }
+            while (count < maximum && !enet_list_empty(&peer->dispatchedCommands))
+            {
+                ENetEvent *event = &events[count];
 
-                if ((incomingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK) !=
-                    ENET_PROTOCOL_COMMAND_SEND_FRAGMENT ||
-                    totalLength != incomingCommand->packet->dataLength ||
-                    fragmentCount != incomingCommand->fragmentCount
-                ) {
-                    return -1;
+                event->packet = peer->receive(&event->channelID);
+                if (event->packet == nullptr)
+                {
+                    continue;
                 }
 
-                startCommand = incomingCommand;
-                break;
+                event->type = ENetEventType::RECEIVE;
+                event->peer = peer;
+                event->data = 0;
+                ++count;
             }
-        }
 
-        if (startCommand == nullptr)
-        {
-            ENetProtocol hostCommand = *command;
-            hostCommand.header.reliableSequenceNumber = startSequenceNumber;
-            startCommand = peer->queue_incoming_command(&hostCommand, nullptr, totalLength,
-                                                        ENET_PACKET_FLAG_RELIABLE, fragmentCount);
-            if (startCommand == nullptr)
+            if (enet_list_empty(&peer->dispatchedCommands))
             {
-                return -1;
+                host->dispatchQueue.pop_front();
+                peer->needsDispatch = 0;
             }
         }
 
-        if ((startCommand->fragments[fragmentNumber / 32] & (1 << (fragmentNumber % 32))) == 0) {
-            --startCommand->fragmentsRemaining;
-            startCommand->fragments[fragmentNumber / 32] |= (1 << (fragmentNumber % 32));
-
-            if (fragmentOffset + fragmentLength > startCommand->packet->dataLength) {
-                fragmentLength = startCommand->packet->dataLength - fragmentOffset;
-            }
-
-            memcpy(startCommand->packet->data + fragmentOffset, (enet_uint8 *) command + sizeof(ENetProtocolSendFragment), fragmentLength);
+        return count;
+    } /* enet_protocol_dispatch_incoming_events */
 
-            if (startCommand->fragmentsRemaining <= 0) {
-                peer->dispatch_incoming_reliable_commands(channel);
-            }
-        }
+    static void enet_protocol_notify_connect(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
+        host->recalculateBandwidthLimits = 1;
 
-        return 0;
-    } /* enet_protocol_handle_send_fragment */
+        if (event != nullptr)
+        {
+            enet_protocol_change_state(host, peer, ENetPeerState::CONNECTED);
 
-    static int enet_protocol_handle_send_unreliable_fragment(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
-        enet_uint32 fragmentNumber, fragmentCount, fragmentOffset, fragmentLength, reliableSequenceNumber, startSequenceNumber, totalLength;
-        enet_uint16 reliableWindow, currentWindow;
-        ENetChannel *channel;
-        ENetListIterator currentCommand;
-        ENetIncomingCommand *startCommand = nullptr;
+            peer->totalDataSent     = 0;
+            peer->totalDataReceived = 0;
+            peer->totalPacketsSent  = 0;
+            peer->totalPacketsLost  = 0;
 
-        if (command->header.channelID >= peer->channelCount ||
-            (peer->state != ENetPeerState::CONNECTED &&
-             peer->state != ENetPeerState::DISCONNECT_LATER))
+            event->type = ENetEventType::CONNECT;
+            event->peer = peer;
+            event->data = peer->eventData;
+        }
+        else
         {
-            return -1;
+            enet_protocol_dispatch_state(host, peer,
+                                         peer->state == ENetPeerState::CONNECTING
+                                             ? ENetPeerState::CONNECTION_SUCCEEDED
+                                             : ENetPeerState::CONNECTION_PENDING);
         }
+    }
 
-        fragmentLength = ENET_NET_TO_HOST_16(command->sendFragment.dataLength);
-        *currentData  += fragmentLength;
-        if (fragmentLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
-            return -1;
+    static void enet_protocol_notify_disconnect(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
+        if (peer->state >= ENetPeerState::CONNECTION_PENDING)
+        {
+            host->recalculateBandwidthLimits = 1;
         }
 
-        channel = &peer->channels[command->header.channelID];
-        reliableSequenceNumber = command->header.reliableSequenceNumber;
-        startSequenceNumber    = ENET_NET_TO_HOST_16(command->sendFragment.startSequenceNumber);
+        if (peer->state != ENetPeerState::CONNECTING &&
+            peer->state < ENetPeerState::CONNECTION_SUCCEEDED)
+        {
+            peer->reset();
+        }
+        else if (event != nullptr)
+        {
+            event->type = ENetEventType::DISCONNECT;
+            event->peer = peer;
+            event->data = 0;
 
-        reliableWindow = reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
-        currentWindow  = channel->incomingReliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+            peer->reset();
+        }
+        else
+        {
+            peer->eventData = 0;
+            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+        }
+    }
 
-        if (reliableSequenceNumber < channel->incomingReliableSequenceNumber) {
-            reliableWindow += ENET_PEER_RELIABLE_WINDOWS;
+    static void enet_protocol_notify_disconnect_timeout (ENetHost * host, ENetPeer * peer, ENetEvent * event) {
+        if (peer->state >= ENetPeerState::CONNECTION_PENDING)
+        {
+            host->recalculateBandwidthLimits = 1;
         }
 
-        if (reliableWindow < currentWindow || reliableWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1) {
-            return 0;
+        if (peer->state != ENetPeerState::CONNECTING &&
+            peer->state < ENetPeerState::CONNECTION_SUCCEEDED)
+        {
+            peer->reset();
         }
+        else if (event != nullptr)
+        {
+            event->type = ENetEventType::DISCONNECT_TIMEOUT;
+            event->peer = peer;
+            event->data = 0;
 
-        if (reliableSequenceNumber == channel->incomingReliableSequenceNumber && startSequenceNumber <= channel->incomingUnreliableSequenceNumber) {
-            return 0;
+            peer->reset();
+        }
+        else {
+            peer->eventData = 0;
+            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
         }
+    }
 
-        fragmentNumber = ENET_NET_TO_HOST_32(command->sendFragment.fragmentNumber);
-        fragmentCount  = ENET_NET_TO_HOST_32(command->sendFragment.fragmentCount);
-        fragmentOffset = ENET_NET_TO_HOST_32(command->sendFragment.fragmentOffset);
-        totalLength    = ENET_NET_TO_HOST_32(command->sendFragment.totalLength);
+    static void enet_protocol_remove_sent_unreliable_commands(ENetPeer *peer) {
+        ENetOutgoingCommand *outgoingCommand;
 
-        if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT ||
-            fragmentNumber >= fragmentCount ||
-            totalLength > host->maximumPacketSize ||
-            fragmentOffset >= totalLength ||
-            fragmentLength > totalLength - fragmentOffset
-        ) {
-            return -1;
-        }
+        while (!peer->sentUnreliableCommands.empty())
+        {
+            outgoingCommand = peer->sentUnreliableCommands.front();
+            peer->sentUnreliableCommands.pop_front();
 
-        for (currentCommand = enet_list_previous(enet_list_end(&channel->incomingUnreliableCommands));
-            currentCommand != enet_list_end(&channel->incomingUnreliableCommands);
-            currentCommand = enet_list_previous(currentCommand)
-        ) {
-            ENetIncomingCommand *incomingCommand = (ENetIncomingCommand *) currentCommand;
+            if (outgoingCommand->packet != nullptr)
+            {
+                --outgoingCommand->packet->referenceCount;
 
-            if (reliableSequenceNumber >= channel->incomingReliableSequenceNumber) {
-                if (incomingCommand->reliableSequenceNumber < channel->incomingReliableSequenceNumber) {
-                    continue;
+                if (outgoingCommand->packet->referenceCount == 0) {
+                    outgoingCommand->packet->flags |= ENET_PACKET_FLAG_SENT;
+                    enet_packet_destroy(outgoingCommand->packet);
                 }
-            } else if (incomingCommand->reliableSequenceNumber >= channel->incomingReliableSequenceNumber) {
-                break;
             }
 
-            if (incomingCommand->reliableSequenceNumber < reliableSequenceNumber) {
-                break;
-            }
+            peer->host->outgoingCommandPool.release(outgoingCommand);
+        }
+    }
 
-            if (incomingCommand->reliableSequenceNumber > reliableSequenceNumber) {
-                continue;
-            }
+    static ENetSequenceIndex<ENetOutgoingCommand> *enet_protocol_sent_command_index(ENetPeer *peer, enet_uint8 channelID) {
+        if (channelID < peer->channelCount) {
+            return &peer->channels[channelID].sentReliableCommands;
+        }
 
-            if (incomingCommand->unreliableSequenceNumber <= startSequenceNumber) {
-                if (incomingCommand->unreliableSequenceNumber < startSequenceNumber) {
-                    break;
-                }
+        return channelID == 0xFF ? &peer->sentControlCommands : nullptr;
+    }
 
-                if ((incomingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK) !=
-                    ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT ||
-                    totalLength != incomingCommand->packet->dataLength ||
-                    fragmentCount != incomingCommand->fragmentCount
-                ) {
-                    return -1;
-                }
+    static ENetProtocolCommand enet_protocol_remove_sent_reliable_command(ENetPeer *peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID) {
+        ENetSequenceIndex<ENetOutgoingCommand> *index = enet_protocol_sent_command_index(peer, channelID);
+        ENetOutgoingCommand  *outgoingCommand;
+        ENetProtocolCommand   commandNumber;
 
-                startCommand = incomingCommand;
-                break;
-            }
+        outgoingCommand = index != nullptr ? index->find(reliableSequenceNumber) : nullptr;
+        if (outgoingCommand == nullptr)
+        {
+            return ENET_PROTOCOL_COMMAND_NONE;
         }
 
-        if (startCommand == nullptr)
-        {
-            startCommand = peer->queue_incoming_command(
-                command, nullptr, totalLength, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT, fragmentCount);
-            if (startCommand == nullptr)
-            {
-                return -1;
+        index->erase(outgoingCommand);
+
+        if (channelID < peer->channelCount) {
+            ENetChannel *channel       = &peer->channels[channelID];
+            enet_uint16 reliableWindow = reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+            if (channel->reliableWindows[reliableWindow] > 0) {
+                --channel->reliableWindows[reliableWindow];
+                if (!channel->reliableWindows[reliableWindow]) {
+                    channel->usedReliableWindows &= ~(1 << reliableWindow);
+                }
             }
         }
 
-        if ((startCommand->fragments[fragmentNumber / 32] & (1 << (fragmentNumber % 32))) == 0) {
-            --startCommand->fragmentsRemaining;
-            startCommand->fragments[fragmentNumber / 32] |= (1 << (fragmentNumber % 32));
+        commandNumber = (ENetProtocolCommand) (outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK);
+        enet_list_remove(&outgoingCommand->outgoingCommandList);
 
-            if (fragmentOffset + fragmentLength > startCommand->packet->dataLength) {
-                fragmentLength = startCommand->packet->dataLength - fragmentOffset;
+        if (outgoingCommand->packet != nullptr)
+        {
+            if (outgoingCommand->inTransit) {
+                peer->reliableDataInTransit -= outgoingCommand->fragmentLength;
             }
 
-            memcpy(startCommand->packet->data + fragmentOffset, (enet_uint8 *) command + sizeof(ENetProtocolSendFragment), fragmentLength);
+            --outgoingCommand->packet->referenceCount;
 
-            if (startCommand->fragmentsRemaining <= 0) {
-                peer->dispatch_incoming_unreliable_commands(channel);
+            if (outgoingCommand->packet->referenceCount == 0) {
+                outgoingCommand->packet->flags |= ENET_PACKET_FLAG_SENT;
+                enet_packet_destroy(outgoingCommand->packet);
             }
         }
 
-        return 0;
-    } /* enet_protocol_handle_send_unreliable_fragment */
+        peer->host->outgoingCommandPool.release(outgoingCommand);
 
-    static int enet_protocol_handle_ping([[maybe_unused]] ENetHost *host, ENetPeer *peer, [[maybe_unused]] const ENetProtocol *command)
+        if (!enet_list_empty(&peer->sentReliableCommands))
+        {
+            outgoingCommand = (ENetOutgoingCommand *) enet_list_front(&peer->sentReliableCommands);
+            peer->nextTimeout = outgoingCommand->sentTime + outgoingCommand->roundTripTimeout;
+        }
+
+        peer->host->schedule_peer(peer);
+
+        return commandNumber;
+    } /* enet_protocol_remove_sent_reliable_command */
+
+    static ENetPeer *enet_protocol_handle_connect([[maybe_unused]] ENetHost *host,
+            [[maybe_unused]] ENetProtocolHeader *header,
+            ENetProtocol *command)
     {
-        if (peer->state != ENetPeerState::CONNECTED &&
-            peer->state != ENetPeerState::DISCONNECT_LATER)
+        enet_uint8 incomingSessionID, outgoingSessionID, capabilities;
+        enet_uint32 mtu, windowSize;
+        size_t channelCount;
+        ENetPeer *   peer = nullptr;
+        ENetProtocol verifyCommand;
+        ENetPeerKey  key;
+
+        channelCount = ENET_NET_TO_HOST_32(command->connect.channelCount);
+
+        if (channelCount < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT || channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
+            return nullptr;
+        }
+
+        key.host      = host->receivedAddress.host;
+        key.port      = host->receivedAddress.port;
+        key.connectID = command->connect.connectID;
+
+        if (host->peerIndex.find(key) != host->peerIndex.end()) {
+            return nullptr;
+        }
+
+        auto duplicatePeers = host->peerAddressCounts.find(host->receivedAddress.host);
+
+        if (host->freePeers.empty() ||
+            (duplicatePeers != host->peerAddressCounts.end() && duplicatePeers->second >= host->duplicatePeers))
         {
-            return -1;
+            return nullptr;
         }
 
-        return 0;
-    }
+        peer = host->freePeers.back();
 
-    static int enet_protocol_handle_bandwidth_limit(ENetHost *host, ENetPeer *peer, const ENetProtocol *command) {
-        if (peer->state != ENetPeerState::CONNECTED &&
-            peer->state != ENetPeerState::DISCONNECT_LATER)
+        if (channelCount > host->channelLimit) {
+            channelCount = host->channelLimit;
+        }
+        peer->channels = (ENetChannel *) enet_malloc(channelCount * sizeof(ENetChannel));
+        if (peer->channels == nullptr)
         {
-            return -1;
+            return nullptr;
         }
+        host->acquire_peer(peer);
+        peer->channelCount               = channelCount;
+        peer->state                      = ENetPeerState::ACKNOWLEDGING_CONNECT;
+        peer->connectID                  = command->connect.connectID;
+        peer->address                    = host->receivedAddress;
+        host->index_peer(peer);
+        peer->outgoingPeerID             = ENET_NET_TO_HOST_16(command->connect.outgoingPeerID);
+        peer->incomingBandwidth          = ENET_NET_TO_HOST_32(command->connect.incomingBandwidth);
+        peer->outgoingBandwidth          = ENET_NET_TO_HOST_32(command->connect.outgoingBandwidth);
+        peer->packetThrottleInterval     = ENET_NET_TO_HOST_32(command->connect.packetThrottleInterval);
+        peer->packetThrottleAcceleration = ENET_NET_TO_HOST_32(command->connect.packetThrottleAcceleration);
+        peer->packetThrottleDeceleration = ENET_NET_TO_HOST_32(command->connect.packetThrottleDeceleration);
+        peer->eventData                  = ENET_NET_TO_HOST_32(command->connect.data);
 
-        if (peer->incomingBandwidth != 0) {
-            --host->bandwidthLimitedPeers;
+        capabilities      = enet_protocol_decode_session(command->connect.incomingSessionID, &incomingSessionID);
+        incomingSessionID = incomingSessionID == 0xFF ? peer->outgoingSessionID : incomingSessionID;
+        incomingSessionID = (incomingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
+        if (incomingSessionID == peer->outgoingSessionID) {
+            incomingSessionID = (incomingSessionID + 1)
+              & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
         }
+        peer->outgoingSessionID = incomingSessionID;
 
-        peer->incomingBandwidth = ENET_NET_TO_HOST_32(command->bandwidthLimit.incomingBandwidth);
-        peer->outgoingBandwidth = ENET_NET_TO_HOST_32(command->bandwidthLimit.outgoingBandwidth);
+        outgoingSessionID = command->connect.outgoingSessionID == 0xFF ? peer->incomingSessionID : command->connect.outgoingSessionID;
+        outgoingSessionID = (outgoingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
+        if (outgoingSessionID == peer->incomingSessionID) {
+            outgoingSessionID = (outgoingSessionID + 1)
+              & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
+        }
+        peer->incomingSessionID = outgoingSessionID;
+        peer->capabilities      = capabilities & host->capabilities;
 
-        if (peer->incomingBandwidth != 0) {
-            ++host->bandwidthLimitedPeers;
+        for (auto channel = peer->channels; channel < &peer->channels[channelCount]; ++channel)
+        {
+            channel->outgoingReliableSequenceNumber   = 0;
+            channel->outgoingUnreliableSequenceNumber = 0;
+            channel->incomingReliableSequenceNumber   = 0;
+            channel->incomingUnreliableSequenceNumber = 0;
+
+            enet_list_clear(&channel->incomingUnreliableCommands);
+
+            channel->usedReliableWindows      = 0;
+            channel->reliableWindows          = {0};
+            channel->sentReliableCommands     = {};
+            channel->incomingReliableCommands = {};
         }
 
-        if (peer->incomingBandwidth == 0 && host->outgoingBandwidth == 0) {
+        mtu = ENET_NET_TO_HOST_32(command->connect.mtu);
+
+        if (mtu < ENET_PROTOCOL_MINIMUM_MTU) {
+            mtu = ENET_PROTOCOL_MINIMUM_MTU;
+        } else if (mtu > ENET_PROTOCOL_MAXIMUM_MTU) {
+            mtu = ENET_PROTOCOL_MAXIMUM_MTU;
+        }
+
+        peer->mtu = mtu;
+
+        if (host->outgoingBandwidth == 0 && peer->incomingBandwidth == 0) {
             peer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
-        } else if (peer->incomingBandwidth == 0 || host->outgoingBandwidth == 0) {
+        } else if (host->outgoingBandwidth == 0 || peer->incomingBandwidth == 0) {
             peer->windowSize =
-                (std::max(peer->incomingBandwidth, host->outgoingBandwidth) /
+                (std::max(host->outgoingBandwidth, peer->incomingBandwidth) /
                  ENET_PEER_WINDOW_SIZE_SCALE) *
                 ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
         } else {
             peer->windowSize =
-                (std::min(peer->incomingBandwidth, host->outgoingBandwidth) /
+                (std::min(host->outgoingBandwidth, peer->incomingBandwidth) /
                  ENET_PEER_WINDOW_SIZE_SCALE) *
                 ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
         }
@@ -2444,2312 +3764,5224 @@
             peer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
         }
 
-        return 0;
-    } /* enet_protocol_handle_bandwidth_limit */
+        if (host->incomingBandwidth == 0) {
+            windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+        } else {
+            windowSize = (host->incomingBandwidth / ENET_PEER_WINDOW_SIZE_SCALE) * ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        }
 
-    static int enet_protocol_handle_throttle_configure(ENetHost *host, ENetPeer *peer, const ENetProtocol *command) {
-        if (peer->state != ENetPeerState::CONNECTED &&
-            peer->state != ENetPeerState::DISCONNECT_LATER)
-        {
-            return -1;
+        if (windowSize > ENET_NET_TO_HOST_32(command->connect.windowSize)) {
+            windowSize = ENET_NET_TO_HOST_32(command->connect.windowSize);
         }
 
-        peer->packetThrottleInterval     = ENET_NET_TO_HOST_32(command->throttleConfigure.packetThrottleInterval);
-        peer->packetThrottleAcceleration = ENET_NET_TO_HOST_32(command->throttleConfigure.packetThrottleAcceleration);
-        peer->packetThrottleDeceleration = ENET_NET_TO_HOST_32(command->throttleConfigure.packetThrottleDeceleration);
+        if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
+            windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        } else if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
+            windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+        }
 
-        return 0;
-    }
+        verifyCommand.header.command                            = ENET_PROTOCOL_COMMAND_VERIFY_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+        verifyCommand.header.channelID                          = 0xFF;
+        verifyCommand.verifyConnect.outgoingPeerID              = ENET_HOST_TO_NET_16(peer->incomingPeerID);
+        verifyCommand.verifyConnect.incomingSessionID           = incomingSessionID | (peer->capabilities << ENET_PROTOCOL_CAPABILITY_SHIFT);
+        verifyCommand.verifyConnect.outgoingSessionID           = outgoingSessionID;
+        verifyCommand.verifyConnect.mtu                         = ENET_HOST_TO_NET_32(peer->mtu);
+        verifyCommand.verifyConnect.windowSize                  = ENET_HOST_TO_NET_32(windowSize);
+        verifyCommand.verifyConnect.channelCount                = ENET_HOST_TO_NET_32(channelCount);
+        verifyCommand.verifyConnect.incomingBandwidth           = ENET_HOST_TO_NET_32(host->incomingBandwidth);
+        verifyCommand.verifyConnect.outgoingBandwidth           = ENET_HOST_TO_NET_32(host->outgoingBandwidth);
+        verifyCommand.verifyConnect.packetThrottleInterval      = ENET_HOST_TO_NET_32(peer->packetThrottleInterval);
+        verifyCommand.verifyConnect.packetThrottleAcceleration  = ENET_HOST_TO_NET_32(peer->packetThrottleAcceleration);
+        verifyCommand.verifyConnect.packetThrottleDeceleration  = ENET_HOST_TO_NET_32(peer->packetThrottleDeceleration);
+        verifyCommand.verifyConnect.connectID = peer->connectID;
 
-    static int enet_protocol_handle_disconnect(ENetHost *host, ENetPeer *peer, const ENetProtocol *command) {
-        if (peer->state == ENetPeerState::DISCONNECTED || peer->state == ENetPeerState::ZOMBIE ||
-            peer->state == ENetPeerState::ACKNOWLEDGING_DISCONNECT)
+        peer->queue_outgoing_command(&verifyCommand, nullptr, 0, 0);
+        return peer;
+    } /* enet_protocol_handle_connect */
+
+    static int enet_protocol_handle_send_reliable(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
+        size_t dataLength;
+
+        if (command->header.channelID >= peer->channelCount ||
+            (peer->state != ENetPeerState::CONNECTED &&
+             peer->state != ENetPeerState::DISCONNECT_LATER))
         {
-            return 0;
+            return -1;
         }
 
-        peer->reset_queues();
+        dataLength    = ENET_NET_TO_HOST_16(command->sendReliable.dataLength);
+        *currentData += dataLength;
 
-        if (peer->state == ENetPeerState::CONNECTION_SUCCEEDED ||
-            peer->state == ENetPeerState::DISCONNECTING || peer->state == ENetPeerState::CONNECTING)
-        {
-            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+        if (dataLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
+            return -1;
         }
-        else if (peer->state != ENetPeerState::CONNECTED &&
-                 peer->state != ENetPeerState::DISCONNECT_LATER)
+
+        if (peer->queue_incoming_command(
+                command, (const enet_uint8 *)command + sizeof(ENetProtocolSendReliable), dataLength,
+                ENET_PACKET_FLAG_RELIABLE, 0) == nullptr)
         {
-            if (peer->state == ENetPeerState::CONNECTION_PENDING)
-            {
-                host->recalculateBandwidthLimits = 1;
-            }
-            peer->reset();
+            return -1;
         }
-        else if (command->header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) {
-            enet_protocol_change_state(host, peer, ENetPeerState::ACKNOWLEDGING_DISCONNECT);
+
+        return 0;
+    }
+
+    static int enet_protocol_handle_send_unsequenced(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
+        enet_uint32 unsequencedGroup, index;
+        size_t dataLength;
+
+        if (command->header.channelID >= peer->channelCount ||
+            (peer->state != ENetPeerState::CONNECTED &&
+             peer->state != ENetPeerState::DISCONNECT_LATER))
+        {
+            return -1;
         }
-        else {
-            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+
+        dataLength    = ENET_NET_TO_HOST_16(command->sendUnsequenced.dataLength);
+        *currentData += dataLength;
+        if (dataLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
+            return -1;
         }
 
-        if (peer->state != ENetPeerState::DISCONNECTED)
+        unsequencedGroup = ENET_NET_TO_HOST_16(command->sendUnsequenced.unsequencedGroup);
+        index = unsequencedGroup % ENET_PEER_UNSEQUENCED_WINDOW_SIZE;
+
+        if (unsequencedGroup < peer->incomingUnsequencedGroup) {
+            unsequencedGroup += 0x10000;
+        }
+
+        if (unsequencedGroup >= (enet_uint32) peer->incomingUnsequencedGroup + ENET_PEER_FREE_UNSEQUENCED_WINDOWS * ENET_PEER_UNSEQUENCED_WINDOW_SIZE) {
+            return 0;
+        }
+
+        unsequencedGroup &= 0xFFFF;
+
+        if (unsequencedGroup - index != peer->incomingUnsequencedGroup) {
+            peer->incomingUnsequencedGroup = unsequencedGroup - index;
+            peer->unsequencedWindow        = {0};
+        } else if (peer->unsequencedWindow[index / 32] & (1 << (index % 32))) {
+            return 0;
+        }
+
+        if (peer->queue_incoming_command(
+                command, (const enet_uint8 *)command + sizeof(ENetProtocolSendUnsequenced),
+                dataLength, ENET_PACKET_FLAG_UNSEQUENCED, 0) == nullptr)
         {
-            peer->eventData = ENET_NET_TO_HOST_32(command->disconnect.data);
+            return -1;
         }
 
+        peer->unsequencedWindow[index / 32] |= 1 << (index % 32);
+
         return 0;
-    }
+    } /* enet_protocol_handle_send_unsequenced */
 
-    static int enet_protocol_handle_acknowledge(ENetHost *host, ENetEvent *event, ENetPeer *peer, const ENetProtocol *command) {
-        enet_uint32 roundTripTime, receivedSentTime, receivedReliableSequenceNumber;
-        ENetProtocolCommand commandNumber;
+    static int enet_protocol_handle_send_unreliable(ENetHost *host, ENetPeer *peer, const ENetProtocol *command,
+      enet_uint8 **currentData) {
+        size_t dataLength;
 
-        if (peer->state == ENetPeerState::DISCONNECTED || peer->state == ENetPeerState::ZOMBIE)
+        if (command->header.channelID >= peer->channelCount ||
+            (peer->state != ENetPeerState::CONNECTED &&
+             peer->state != ENetPeerState::DISCONNECT_LATER))
         {
-            return 0;
+            return -1;
         }
 
-        receivedSentTime  = ENET_NET_TO_HOST_16(command->acknowledge.receivedSentTime);
-        receivedSentTime |= host->serviceTime & 0xFFFF0000;
-        if ((receivedSentTime & 0x8000) > (host->serviceTime & 0x8000)) {
-            receivedSentTime -= 0x10000;
+        dataLength    = ENET_NET_TO_HOST_16(command->sendUnreliable.dataLength);
+        *currentData += dataLength;
+        if (dataLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
+            return -1;
         }
 
-        if (ENET_TIME_LESS(host->serviceTime, receivedSentTime)) {
-            return 0;
+        if (peer->queue_incoming_command(
+                command, (const enet_uint8 *)command + sizeof(ENetProtocolSendUnreliable),
+                dataLength, 0, 0) == nullptr)
+        {
+            return -1;
         }
 
-        peer->lastReceiveTime = host->serviceTime;
-        peer->earliestTimeout = 0;
-        roundTripTime         = ENET_TIME_DIFFERENCE(host->serviceTime, receivedSentTime);
+        return 0;
+    }
 
-        peer->throttle(roundTripTime);
-        peer->roundTripTimeVariance -= peer->roundTripTimeVariance / 4;
+    static int enet_protocol_handle_send_fragment(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
+        enet_uint32 fragmentNumber, fragmentCount, fragmentOffset, fragmentLength, startSequenceNumber, totalLength;
+        ENetChannel *channel;
+        enet_uint16 startWindow, currentWindow;
+        ENetIncomingCommand *startCommand;
 
-        if (roundTripTime >= peer->roundTripTime) {
-            peer->roundTripTime         += (roundTripTime - peer->roundTripTime) / 8;
-            peer->roundTripTimeVariance += (roundTripTime - peer->roundTripTime) / 4;
-        } else {
-            peer->roundTripTime         -= (peer->roundTripTime - roundTripTime) / 8;
-            peer->roundTripTimeVariance += (peer->roundTripTime - roundTripTime) / 4;
+        if (command->header.channelID >= peer->channelCount ||
+            (peer->state != ENetPeerState::CONNECTED &&
+             peer->state != ENetPeerState::DISCONNECT_LATER))
+        {
+            return -1;
         }
 
-        if (peer->roundTripTime < peer->lowestRoundTripTime) {
-            peer->lowestRoundTripTime = peer->roundTripTime;
+        fragmentLength = ENET_NET_TO_HOST_16(command->sendFragment.dataLength);
+        *currentData  += fragmentLength;
+        if (fragmentLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
+            return -1;
         }
 
-        if (peer->roundTripTimeVariance > peer->highestRoundTripTimeVariance) {
-            peer->highestRoundTripTimeVariance = peer->roundTripTimeVariance;
+        channel = &peer->channels[command->header.channelID];
+        startSequenceNumber = ENET_NET_TO_HOST_16(command->sendFragment.startSequenceNumber);
+        startWindow         = startSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+        currentWindow       = channel->incomingReliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+
+        if (startSequenceNumber < channel->incomingReliableSequenceNumber) {
+            startWindow += ENET_PEER_RELIABLE_WINDOWS;
         }
 
-        if (peer->packetThrottleEpoch == 0 ||
-            ENET_TIME_DIFFERENCE(host->serviceTime, peer->packetThrottleEpoch) >= peer->packetThrottleInterval
+        if (startWindow < currentWindow || startWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1) {
+            return 0;
+        }
+
+        fragmentNumber = ENET_NET_TO_HOST_32(command->sendFragment.fragmentNumber);
+        fragmentCount  = ENET_NET_TO_HOST_32(command->sendFragment.fragmentCount);
+        fragmentOffset = ENET_NET_TO_HOST_32(command->sendFragment.fragmentOffset);
+        totalLength    = ENET_NET_TO_HOST_32(command->sendFragment.totalLength);
+
+        if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT ||
+            fragmentNumber >= fragmentCount ||
+            totalLength > host->maximumPacketSize ||
+            fragmentOffset >= totalLength ||
+            fragmentLength > totalLength - fragmentOffset
         ) {
-            peer->lastRoundTripTime            = peer->lowestRoundTripTime;
-            peer->lastRoundTripTimeVariance    = peer->highestRoundTripTimeVariance;
-            peer->lowestRoundTripTime          = peer->roundTripTime;
-            peer->highestRoundTripTimeVariance = peer->roundTripTimeVariance;
-            peer->packetThrottleEpoch          = host->serviceTime;
+            return -1;
         }
 
-        receivedReliableSequenceNumber = ENET_NET_TO_HOST_16(command->acknowledge.receivedReliableSequenceNumber);
-        commandNumber = enet_protocol_remove_sent_reliable_command(peer, receivedReliableSequenceNumber, command->header.channelID);
+        startCommand = channel->incomingReliableCommands.find(startSequenceNumber);
+        if (startCommand != nullptr &&
+            ((startCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_FRAGMENT ||
+             totalLength != startCommand->packet->dataLength ||
+             fragmentCount != startCommand->fragmentCount)
+        ) {
+            return -1;
+        }
 
-        switch (peer->state)
+        if (startCommand == nullptr)
         {
-        case ENetPeerState::ACKNOWLEDGING_CONNECT:
-            if (commandNumber != ENET_PROTOCOL_COMMAND_VERIFY_CONNECT)
+            ENetProtocol hostCommand = *command;
+            hostCommand.header.reliableSequenceNumber = startSequenceNumber;
+            startCommand = peer->queue_incoming_command(&hostCommand, nullptr, totalLength,
+                                                        ENET_PACKET_FLAG_RELIABLE, fragmentCount);
+            if (startCommand == nullptr)
             {
                 return -1;
             }
+        }
 
-            enet_protocol_notify_connect(host, peer, event);
-            break;
+        if ((startCommand->fragments[fragmentNumber / 32] & (1 << (fragmentNumber % 32))) == 0) {
+            --startCommand->fragmentsRemaining;
+            startCommand->fragments[fragmentNumber / 32] |= (1 << (fragmentNumber % 32));
 
-        case ENetPeerState::DISCONNECTING:
-            if (commandNumber != ENET_PROTOCOL_COMMAND_DISCONNECT)
-            {
-                return -1;
+            if (fragmentOffset + fragmentLength > startCommand->packet->dataLength) {
+                fragmentLength = startCommand->packet->dataLength - fragmentOffset;
             }
 
-            enet_protocol_notify_disconnect(host, peer, event);
-            break;
+            memcpy(startCommand->packet->data + fragmentOffset, (enet_uint8 *) command + sizeof(ENetProtocolSendFragment), fragmentLength);
 
-        case ENetPeerState::DISCONNECT_LATER:
-            if (enet_list_empty(&peer->outgoingReliableCommands) &&
-                enet_list_empty(&peer->outgoingUnreliableCommands) &&
-                enet_list_empty(&peer->sentReliableCommands))
-            {
-                peer->disconnect(peer->eventData);
+            if (startCommand->fragmentsRemaining <= 0) {
+                peer->dispatch_incoming_reliable_commands(channel);
             }
-            break;
-
-        default:
-            break;
         }
 
         return 0;
-    } /* enet_protocol_handle_acknowledge */
+    } /* enet_protocol_handle_send_fragment */
 
-    static int enet_protocol_handle_verify_connect(ENetHost *host, ENetEvent *event, ENetPeer *peer, const ENetProtocol *command) {
-        enet_uint32 mtu, windowSize;
-        size_t channelCount;
+    static int enet_protocol_handle_send_unreliable_fragment(ENetHost *host, ENetPeer *peer, const ENetProtocol *command, enet_uint8 **currentData) {
+        enet_uint32 fragmentNumber, fragmentCount, fragmentOffset, fragmentLength, reliableSequenceNumber, startSequenceNumber, totalLength;
+        enet_uint16 reliableWindow, currentWindow;
+        ENetChannel *channel;
+        ENetListIterator currentCommand;
+        ENetIncomingCommand *startCommand = nullptr;
 
-        if (peer->state != ENetPeerState::CONNECTING)
+        if (command->header.channelID >= peer->channelCount ||
+            (peer->state != ENetPeerState::CONNECTED &&
+             peer->state != ENetPeerState::DISCONNECT_LATER))
         {
-            return 0;
-        }
-
-        channelCount = ENET_NET_TO_HOST_32(command->verifyConnect.channelCount);
-
-        if (channelCount < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT || channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT ||
-            ENET_NET_TO_HOST_32(command->verifyConnect.packetThrottleInterval) != peer->packetThrottleInterval ||
-            ENET_NET_TO_HOST_32(command->verifyConnect.packetThrottleAcceleration) != peer->packetThrottleAcceleration ||
-            ENET_NET_TO_HOST_32(command->verifyConnect.packetThrottleDeceleration) != peer->packetThrottleDeceleration ||
-            command->verifyConnect.connectID != peer->connectID
-        ) {
-            peer->eventData = 0;
-            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
             return -1;
         }
 
-        enet_protocol_remove_sent_reliable_command(peer, 1, 0xFF);
-
-        if (channelCount < peer->channelCount) {
-            peer->channelCount = channelCount;
+        fragmentLength = ENET_NET_TO_HOST_16(command->sendFragment.dataLength);
+        *currentData  += fragmentLength;
+        if (fragmentLength > host->maximumPacketSize || *currentData < host->receivedData || *currentData > &host->receivedData[host->receivedDataLength]) {
+            return -1;
         }
 
-        peer->outgoingPeerID    = ENET_NET_TO_HOST_16(command->verifyConnect.outgoingPeerID);
-        peer->incomingSessionID = command->verifyConnect.incomingSessionID;
-        peer->outgoingSessionID = command->verifyConnect.outgoingSessionID;
+        channel = &peer->channels[command->header.channelID];
+        reliableSequenceNumber = command->header.reliableSequenceNumber;
+        startSequenceNumber    = ENET_NET_TO_HOST_16(command->sendFragment.startSequenceNumber);
 
-        mtu = ENET_NET_TO_HOST_32(command->verifyConnect.mtu);
+        reliableWindow = reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+        currentWindow  = channel->incomingReliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
 
-        if (mtu < ENET_PROTOCOL_MINIMUM_MTU) {
-            mtu = ENET_PROTOCOL_MINIMUM_MTU;
-        } else if (mtu > ENET_PROTOCOL_MAXIMUM_MTU) {
-            mtu = ENET_PROTOCOL_MAXIMUM_MTU;
+        if (reliableSequenceNumber < channel->incomingReliableSequenceNumber) {
+            reliableWindow += ENET_PEER_RELIABLE_WINDOWS;
         }
 
-        if (mtu < peer->mtu) {
-            peer->mtu = mtu;
+        if (reliableWindow < currentWindow || reliableWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1) {
+            return 0;
         }
 
-        windowSize = ENET_NET_TO_HOST_32(command->verifyConnect.windowSize);
-        if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
-            windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        if (reliableSequenceNumber == channel->incomingReliableSequenceNumber && startSequenceNumber <= channel->incomingUnreliableSequenceNumber) {
+            return 0;
         }
 
-        if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
-            windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+        fragmentNumber = ENET_NET_TO_HOST_32(command->sendFragment.fragmentNumber);
+        fragmentCount  = ENET_NET_TO_HOST_32(command->sendFragment.fragmentCount);
+        fragmentOffset = ENET_NET_TO_HOST_32(command->sendFragment.fragmentOffset);
+        totalLength    = ENET_NET_TO_HOST_32(command->sendFragment.totalLength);
+
+        if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT ||
+            fragmentNumber >= fragmentCount ||
+            totalLength > host->maximumPacketSize ||
+            fragmentOffset >= totalLength ||
+            fragmentLength > totalLength - fragmentOffset
+        ) {
+            return -1;
         }
 
-        if (windowSize < peer->windowSize) {
-            peer->windowSize = windowSize;
-        }
-
-        peer->incomingBandwidth = ENET_NET_TO_HOST_32(command->verifyConnect.incomingBandwidth);
-        peer->outgoingBandwidth = ENET_NET_TO_HOST_32(command->verifyConnect.outgoingBandwidth);
+        for (currentCommand = enet_list_previous(enet_list_end(&channel->incomingUnreliableCommands));
+            currentCommand != enet_list_end(&channel->incomingUnreliableCommands);
+            currentCommand = enet_list_previous(currentCommand)
+        ) {
+            ENetIncomingCommand *incomingCommand = (ENetIncomingCommand *) currentCommand;
 
-        enet_protocol_notify_connect(host, peer, event);
-        return 0;
-    } /* enet_protocol_handle_verify_connect */
+            if (reliableSequenceNumber >= channel->incomingReliableSequenceNumber) {
+                if (incomingCommand->reliableSequenceNumber < channel->incomingReliableSequenceNumber) {
+                    continue;
+                }
+            } else if (incomingCommand->reliableSequenceNumber >= channel->incomingReliableSequenceNumber) {
+                break;
+            }
 
-    static int enet_protocol_handle_incoming_commands(ENetHost *host, ENetEvent *event) {
-        ENetProtocolHeader *header;
-        ENetProtocol *command;
-        ENetPeer *peer;
-        enet_uint8 *currentData;
-        size_t headerSize;
-        enet_uint16 peerID, flags;
-        enet_uint8 sessionID;
+            if (incomingCommand->reliableSequenceNumber < reliableSequenceNumber) {
+                break;
+            }
 
-        if (host->receivedDataLength < (size_t) &((ENetProtocolHeader *) 0)->sentTime) {
-            return 0;
-        }
+            if (incomingCommand->reliableSequenceNumber > reliableSequenceNumber) {
+                continue;
+            }
 
-        header = (ENetProtocolHeader *) host->receivedData;
+            if (incomingCommand->unreliableSequenceNumber <= startSequenceNumber) {
+                if (incomingCommand->unreliableSequenceNumber < startSequenceNumber) {
+                    break;
+                }
 
-        peerID    = ENET_NET_TO_HOST_16(header->peerID);
-        sessionID = (peerID & ENET_PROTOCOL_HEADER_SESSION_MASK) >> ENET_PROTOCOL_HEADER_SESSION_SHIFT;
-        flags     = peerID & ENET_PROTOCOL_HEADER_FLAG_MASK;
-        peerID   &= ~(ENET_PROTOCOL_HEADER_FLAG_MASK | ENET_PROTOCOL_HEADER_SESSION_MASK);
+                if ((incomingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK) !=
+                    ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT ||
+                    totalLength != incomingCommand->packet->dataLength ||
+                    fragmentCount != incomingCommand->fragmentCount
+                ) {
+                    return -1;
+                }
 
-        headerSize = (flags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME ? sizeof(ENetProtocolHeader) : (size_t) &((ENetProtocolHeader *) 0)->sentTime);
-        if (host->checksum != nullptr)
-        {
-            headerSize += sizeof(enet_uint32);
+                startCommand = incomingCommand;
+                break;
+            }
         }
 
-        if (peerID == ENET_PROTOCOL_MAXIMUM_PEER_ID) {
-            peer = nullptr;
-        } else if (peerID >= host->peerCount) {
-            return 0;
-        } else {
-            peer = &host->peers[peerID];
-
-            if (peer->state == ENetPeerState::DISCONNECTED ||
-                peer->state == ENetPeerState::ZOMBIE ||
-                ((!in6_equal(host->receivedAddress.host , peer->address.host) ||
-                host->receivedAddress.port != peer->address.port) &&
-                1 /* no broadcast in ipv6  !in6_equal(peer->address.host , ENET_HOST_BROADCAST)*/) ||
-                (peer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID &&
-                sessionID != peer->incomingSessionID)
-            )
+        if (startCommand == nullptr)
+        {
+            startCommand = peer->queue_incoming_command(
+                command, nullptr, totalLength, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT, fragmentCount);
+            if (startCommand == nullptr)
             {
-                return 0;
+                return -1;
             }
         }
 
-        if (flags & ENET_PROTOCOL_HEADER_FLAG_COMPRESSED) {
-            size_t originalSize;
-            if (host->compressor.context == nullptr || host->compressor.decompress == nullptr)
-            {
-                return 0;
+        if ((startCommand->fragments[fragmentNumber / 32] & (1 << (fragmentNumber % 32))) == 0) {
+            --startCommand->fragmentsRemaining;
+            startCommand->fragments[fragmentNumber / 32] |= (1 << (fragmentNumber % 32));
+
+            if (fragmentOffset + fragmentLength > startCommand->packet->dataLength) {
+                fragmentLength = startCommand->packet->dataLength - fragmentOffset;
             }
 
-            originalSize = host->compressor.decompress(host->compressor.context,
-                host->receivedData + headerSize,
-                host->receivedDataLength - headerSize,
-                host->packetData[1] + headerSize,
-                sizeof(host->packetData[1]) - headerSize
-            );
+            memcpy(startCommand->packet->data + fragmentOffset, (enet_uint8 *) command + sizeof(ENetProtocolSendFragment), fragmentLength);
 
-            if (originalSize <= 0 || originalSize > sizeof(host->packetData[1]) - headerSize) {
-                return 0;
+            if (startCommand->fragmentsRemaining <= 0) {
+                peer->dispatch_incoming_unreliable_commands(channel);
             }
+        }
 
-            memcpy(host->packetData[1], header, headerSize);
-            host->receivedData       = host->packetData[1];
-            host->receivedDataLength = headerSize + originalSize;
+        return 0;
+    } /* enet_protocol_handle_send_unreliable_fragment */
+
+    static int enet_protocol_handle_ping([[maybe_unused]] ENetHost *host, ENetPeer *peer, [[maybe_unused]] const ENetProtocol *command)
+    {
+        if (peer->state != ENetPeerState::CONNECTED &&
+            peer->state != ENetPeerState::DISCONNECT_LATER)
+        {
+            return -1;
         }
 
-        if (host->checksum != nullptr)
+        return 0;
+    }
+
+    static int enet_protocol_handle_bandwidth_limit(ENetHost *host, ENetPeer *peer, const ENetProtocol *command) {
+        if (peer->state != ENetPeerState::CONNECTED &&
+            peer->state != ENetPeerState::DISCONNECT_LATER)
         {
-            enet_uint32 *checksum = (enet_uint32 *) &host->receivedData[headerSize - sizeof(enet_uint32)];
-            enet_uint32 desiredChecksum = *checksum;
-            ENetBuffer buffer;
+            return -1;
+        }
 
-            *checksum = peer != nullptr ? peer->connectID : 0;
+        if (peer->incomingBandwidth != 0) {
+            --host->bandwidthLimitedPeers;
+        }
 
-            buffer.data       = host->receivedData;
-            buffer.dataLength = host->receivedDataLength;
+        peer->incomingBandwidth = ENET_NET_TO_HOST_32(command->bandwidthLimit.incomingBandwidth);
+        peer->outgoingBandwidth = ENET_NET_TO_HOST_32(command->bandwidthLimit.outgoingBandwidth);
 
-            if (host->checksum(&buffer, 1) != desiredChecksum) {
-                return 0;
-            }
+        if (peer->incomingBandwidth != 0) {
+            ++host->bandwidthLimitedPeers;
         }
 
-        if (peer != nullptr)
+        if (peer->incomingBandwidth == 0 && host->outgoingBandwidth == 0) {
+            peer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+        } else if (peer->incomingBandwidth == 0 || host->outgoingBandwidth == 0) {
+            peer->windowSize =
+                (std::max(peer->incomingBandwidth, host->outgoingBandwidth) /
+                 ENET_PEER_WINDOW_SIZE_SCALE) *
+                ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        } else {
+            peer->windowSize =
+                (std::min(peer->incomingBandwidth, host->outgoingBandwidth) /
+                 ENET_PEER_WINDOW_SIZE_SCALE) *
+                ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        }
+
+        if (peer->windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
+            peer->windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        } else if (peer->windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
+            peer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+        }
+
+        return 0;
+    } /* enet_protocol_handle_bandwidth_limit */
+
+    static int enet_protocol_handle_throttle_configure(ENetHost *host, ENetPeer *peer, const ENetProtocol *command) {
+        if (peer->state != ENetPeerState::CONNECTED &&
+            peer->state != ENetPeerState::DISCONNECT_LATER)
         {
-            peer->address.host       = host->receivedAddress.host;
-            peer->address.port       = host->receivedAddress.port;
-            peer->incomingDataTotal += host->receivedDataLength;
-            peer->totalDataReceived += host->receivedDataLength;
+            return -1;
         }
 
-        currentData = host->receivedData + headerSize;
+        peer->packetThrottleInterval     = ENET_NET_TO_HOST_32(command->throttleConfigure.packetThrottleInterval);
+        peer->packetThrottleAcceleration = ENET_NET_TO_HOST_32(command->throttleConfigure.packetThrottleAcceleration);
+        peer->packetThrottleDeceleration = ENET_NET_TO_HOST_32(command->throttleConfigure.packetThrottleDeceleration);
 
-        auto commandError = [](ENetEvent *event) -> uint8_t {
-            if (event != nullptr && event->type != ENetEventType::NONE)
-            {
-                return 1;
-            }
+        return 0;
+    }
 
+    static int enet_protocol_handle_disconnect(ENetHost *host, ENetPeer *peer, const ENetProtocol *command) {
+        if (peer->state == ENetPeerState::DISCONNECTED || peer->state == ENetPeerState::ZOMBIE ||
+            peer->state == ENetPeerState::ACKNOWLEDGING_DISCONNECT)
+        {
             return 0;
-        };
+        }
 
-        while (currentData < &host->receivedData[host->receivedDataLength])
+        peer->reset_queues();
+
+        if (peer->state == ENetPeerState::CONNECTION_SUCCEEDED ||
+            peer->state == ENetPeerState::DISCONNECTING || peer->state == ENetPeerState::CONNECTING)
         {
-            enet_uint8 commandNumber;
-            size_t commandSize;
+            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+        }
+        else if (peer->state != ENetPeerState::CONNECTED &&
+                 peer->state != ENetPeerState::DISCONNECT_LATER)
+        {
+            if (peer->state == ENetPeerState::CONNECTION_PENDING)
+            {
+                host->recalculateBandwidthLimits = 1;
+            }
+            peer->reset();
+        }
+        else if (command->header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) {
+            enet_protocol_change_state(host, peer, ENetPeerState::ACKNOWLEDGING_DISCONNECT);
+        }
+        else {
+            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+        }
 
-            command = (ENetProtocol *) currentData;
+        if (peer->state != ENetPeerState::DISCONNECTED)
+        {
+            peer->eventData = ENET_NET_TO_HOST_32(command->disconnect.data);
+        }
 
-            if (currentData + sizeof(ENetProtocolCommandHeader) > &host->receivedData[host->receivedDataLength]) {
-                break;
-            }
+        return 0;
+    }
 
-            commandNumber = command->header.command & ENET_PROTOCOL_COMMAND_MASK;
-            if (commandNumber >= ENET_PROTOCOL_COMMAND_COUNT) {
-                break;
-            }
+    /** Returns the number of trailing zero bits of a non-zero mask. */
+    static inline int enet_count_trailing_zeros(enet_uint32 mask) {
+    #ifdef _MSC_VER
+        unsigned long index;
 
-            commandSize = commandSizes[commandNumber];
-            if (commandSize == 0 || currentData + commandSize > &host->receivedData[host->receivedDataLength]) {
-                break;
-            }
+        _BitScanForward(&index, mask);
+        return (int) index;
+    #else
+        return __builtin_ctz(mask);
+    #endif
+    }
 
-            currentData += commandSize;
+    /** Returns the time at which the acknowledged commands were last sent, or 0 if none of them went
+     *  out in the millisecond echoed by the acknowledgement, as when it answers an earlier transmission.
+     *  @remarks the echo only has the millisecond resolution of the datagram header, but it tells which
+     *  transmission arrived, and the commands themselves still hold its exact service time.
+     */
+    static enet_uint64 enet_protocol_acknowledged_sent_time(ENetPeer *peer, const ENetProtocol *command) {
+        ENetSequenceIndex<ENetOutgoingCommand> *index = enet_protocol_sent_command_index(peer, command->header.channelID);
+        enet_uint16 receivedSentTime               = ENET_NET_TO_HOST_16(command->acknowledge.receivedSentTime);
+        enet_uint16 receivedReliableSequenceNumber = ENET_NET_TO_HOST_16(command->acknowledge.receivedReliableSequenceNumber);
+        enet_uint16 reliableSequenceNumber         = receivedReliableSequenceNumber;
+        enet_uint32 receivedMask                   = 0;
+        enet_uint64 sentTime                       = 0;
+
+        if (index == nullptr) {
+            return 0;
+        }
 
-            if (peer == nullptr && (commandNumber != ENET_PROTOCOL_COMMAND_CONNECT ||
-                                    currentData < &host->receivedData[host->receivedDataLength]))
+        if ((command->header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE) {
+            receivedMask = ENET_NET_TO_HOST_32(command->acknowledgeRange.receivedMask);
+        }
+
+        for (;;)
+        {
+            ENetOutgoingCommand *outgoingCommand = index->find(reliableSequenceNumber);
+
+            if (outgoingCommand != nullptr &&
+                (enet_uint16) (outgoingCommand->sentTime / ENET_TIME_MILLISECOND) == receivedSentTime)
             {
-                break;
+                sentTime = std::max(sentTime, outgoingCommand->sentTime);
             }
 
-            command->header.reliableSequenceNumber = ENET_NET_TO_HOST_16(command->header.reliableSequenceNumber);
+            if (receivedMask == 0) {
+                return sentTime;
+            }
 
-            switch (commandNumber) {
-                case ENET_PROTOCOL_COMMAND_ACKNOWLEDGE:
-                    if (enet_protocol_handle_acknowledge(host, event, peer, command)) {
-                        return commandError(event);
-                    }
-                    break;
+            reliableSequenceNumber = (enet_uint16) (receivedReliableSequenceNumber + 1 + enet_count_trailing_zeros(receivedMask));
+            receivedMask          &= receivedMask - 1;
+        }
+    }
 
-                case ENET_PROTOCOL_COMMAND_CONNECT:
-                    if (peer != nullptr)
-                    {
-                        return commandError(event);
-                    }
-                    peer = enet_protocol_handle_connect(host, header, command);
-                    if (peer == nullptr)
-                    {
-                        return commandError(event);
-                    }
-                    break;
+    static int enet_protocol_handle_acknowledge(ENetHost *host, ENetEvent *event, ENetPeer *peer, const ENetProtocol *command) {
+        enet_uint32 roundTripTime, serviceTime, receivedSentTime, receivedReliableSequenceNumber;
+        enet_uint64 sentTime;
+        ENetProtocolCommand commandNumber;
 
-                case ENET_PROTOCOL_COMMAND_VERIFY_CONNECT:
-                    if (enet_protocol_handle_verify_connect(host, event, peer, command)) {
-                        return commandError(event);
-                    }
-                    break;
+        if (peer->state == ENetPeerState::DISCONNECTED || peer->state == ENetPeerState::ZOMBIE)
+        {
+            return 0;
+        }
 
-                case ENET_PROTOCOL_COMMAND_DISCONNECT:
-                    if (enet_protocol_handle_disconnect(host, peer, command)) {
-                        return commandError(event);
-                    }
-                    break;
+        serviceTime       = (enet_uint32) (host->serviceTime / ENET_TIME_MILLISECOND);
+        receivedSentTime  = ENET_NET_TO_HOST_16(command->acknowledge.receivedSentTime);
+        receivedSentTime |= serviceTime & 0xFFFF0000;
+        if ((receivedSentTime & 0x8000) > (serviceTime & 0x8000)) {
+            receivedSentTime -= 0x10000;
+        }
 
-                case ENET_PROTOCOL_COMMAND_PING:
-                    if (enet_protocol_handle_ping(host, peer, command)) {
-                        return commandError(event);
-                    }
-                    break;
+        if (ENET_TIME_LESS(serviceTime, receivedSentTime)) {
+            return 0;
+        }
 
-                case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
-                    if (enet_protocol_handle_send_reliable(host, peer, command, &currentData)) {
-                        return commandError(event);
-                    }
-                    break;
+        peer->lastReceiveTime = host->serviceTime;
+        peer->earliestTimeout = 0;
 
-                case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE:
-                    if (enet_protocol_handle_send_unreliable(host, peer, command, &currentData)) {
-                        return commandError(event);
-                    }
-                    break;
+        sentTime      = enet_protocol_acknowledged_sent_time(peer, command);
+        roundTripTime = sentTime != 0 && sentTime <= host->serviceTime
+                            ? (enet_uint32) (host->serviceTime - sentTime)
+                            : ENET_TIME_DIFFERENCE(serviceTime, receivedSentTime) * ENET_TIME_MILLISECOND;
 
-                case ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED:
-                    if (enet_protocol_handle_send_unsequenced(host, peer, command, &currentData)) {
-                        return commandError(event);
-                    }
-                    break;
+        peer->throttle(roundTripTime);
+        peer->roundTripTimeVariance -= peer->roundTripTimeVariance / 4;
 
-                case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
-                    if (enet_protocol_handle_send_fragment(host, peer, command, &currentData)) {
-                        return commandError(event);
-                    }
-                    break;
+        if (roundTripTime >= peer->roundTripTime) {
+            peer->roundTripTime         += (roundTripTime - peer->roundTripTime) / 8;
+            peer->roundTripTimeVariance += (roundTripTime - peer->roundTripTime) / 4;
+        } else {
+            peer->roundTripTime         -= (peer->roundTripTime - roundTripTime) / 8;
+            peer->roundTripTimeVariance += (peer->roundTripTime - roundTripTime) / 4;
+        }
 
-                case ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT:
-                    if (enet_protocol_handle_bandwidth_limit(host, peer, command)) {
-                        return commandError(event);
-                    }
-                    break;
+        if (peer->roundTripTime < peer->lowestRoundTripTime) {
+            peer->lowestRoundTripTime = peer->roundTripTime;
+        }
 
-                case ENET_PROTOCOL_COMMAND_THROTTLE_CONFIGURE:
-                    if (enet_protocol_handle_throttle_configure(host, peer, command)) {
-                        return commandError(event);
-                    }
-                    break;
+        if (peer->roundTripTimeVariance > peer->highestRoundTripTimeVariance) {
+            peer->highestRoundTripTimeVariance = peer->roundTripTimeVariance;
+        }
 
-                case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT:
-                    if (enet_protocol_handle_send_unreliable_fragment(host, peer, command, &currentData)) {
-                        return commandError(event);
-                    }
-                    break;
+        if (peer->packetThrottleEpoch == 0 ||
+            ENET_TIME_DIFFERENCE(host->serviceTime, peer->packetThrottleEpoch) >=
+                (enet_uint64) peer->packetThrottleInterval * ENET_TIME_MILLISECOND
+        ) {
+            peer->lastRoundTripTime            = peer->lowestRoundTripTime;
+            peer->lastRoundTripTimeVariance    = peer->highestRoundTripTimeVariance;
+            peer->lowestRoundTripTime          = peer->roundTripTime;
+            peer->highestRoundTripTimeVariance = peer->roundTripTimeVariance;
+            peer->packetThrottleEpoch          = host->serviceTime;
+        }
 
-                default:
-                    return commandError(event);
-            }
+        receivedReliableSequenceNumber = ENET_NET_TO_HOST_16(command->acknowledge.receivedReliableSequenceNumber);
+        commandNumber = enet_protocol_remove_sent_reliable_command(peer, receivedReliableSequenceNumber, command->header.channelID);
 
-            if (peer != nullptr &&
-                (command->header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) != 0)
+        if ((command->header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE)
+        {
+            /* a range settles the handshake if any of its sequence numbers retired the command the state waits on */
+            for (enet_uint32 receivedMask = ENET_NET_TO_HOST_32(command->acknowledgeRange.receivedMask); receivedMask != 0;
+                 receivedMask &= receivedMask - 1)
             {
-                enet_uint16 sentTime;
-
-                if (!(flags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME)) {
-                    break;
-                }
-
-                sentTime = ENET_NET_TO_HOST_16(header->sentTime);
-
-                switch (peer->state)
-                {
-                case ENetPeerState::DISCONNECTING:
-                case ENetPeerState::ACKNOWLEDGING_CONNECT:
-                case ENetPeerState::DISCONNECTED:
-                case ENetPeerState::ZOMBIE:
-                    break;
-
-                case ENetPeerState::ACKNOWLEDGING_DISCONNECT:
-                    if ((command->header.command & ENET_PROTOCOL_COMMAND_MASK) ==
-                        ENET_PROTOCOL_COMMAND_DISCONNECT)
-                    {
-                        peer->queue_acknowledgement(command, sentTime);
-                    }
-                    break;
+                ENetProtocolCommand retiredNumber = enet_protocol_remove_sent_reliable_command(peer,
+                    (enet_uint16) (receivedReliableSequenceNumber + 1 + enet_count_trailing_zeros(receivedMask)), command->header.channelID);
 
-                default:
-                    peer->queue_acknowledgement(command, sentTime);
-                    break;
+                if (retiredNumber == ENET_PROTOCOL_COMMAND_VERIFY_CONNECT || retiredNumber == ENET_PROTOCOL_COMMAND_DISCONNECT) {
+                    commandNumber = retiredNumber;
                 }
             }
         }
 
-        return commandError(event);
-
-    } /* enet_protocol_handle_incoming_commands */
-
-    static int enet_protocol_receive_incoming_commands(ENetHost *host, ENetEvent *event) {
-
-        for (auto packets = 0; packets < 256; ++packets)
+        switch (peer->state)
         {
-            int receivedLength;
-            ENetBuffer buffer;
-
-            buffer.data       = host->packetData[0];
-            // buffer.dataLength = sizeof (host->packetData[0]);
-            buffer.dataLength = host->mtu;
-
-            receivedLength = host->socket.receive(&host->receivedAddress, &buffer, 1);
-
-            if (receivedLength == -2)
-                continue;
-
-            if (receivedLength < 0) {
+        case ENetPeerState::ACKNOWLEDGING_CONNECT:
+            if (commandNumber != ENET_PROTOCOL_COMMAND_VERIFY_CONNECT)
+            {
                 return -1;
             }
 
-            if (receivedLength == 0) {
-                return 0;
-            }
+            enet_protocol_notify_connect(host, peer, event);
+            break;
 
-            host->receivedData       = host->packetData[0];
-            host->receivedDataLength = receivedLength;
+        case ENetPeerState::DISCONNECTING:
+            if (commandNumber != ENET_PROTOCOL_COMMAND_DISCONNECT)
+            {
+                return -1;
+            }
 
-            host->totalReceivedData += receivedLength;
-            host->totalReceivedPackets++;
+            enet_protocol_notify_disconnect(host, peer, event);
+            break;
 
-            if (host->intercept != nullptr)
+        case ENetPeerState::DISCONNECT_LATER:
+            if (enet_list_empty(&peer->outgoingReliableCommands) &&
+                enet_list_empty(&peer->outgoingUnreliableCommands) &&
+                enet_list_empty(&peer->sentReliableCommands))
             {
-                switch (host->intercept(host, (void *)event)) {
-                    case 1:
-                        if (event != nullptr && event->type != ENetEventType::NONE)
-                        {
-                            return 1;
-                        }
+                peer->disconnect(peer->eventData);
+            }
+            break;
 
-                        continue;
+        default:
+            break;
+        }
 
-                    case -1:
-                        return -1;
+        return 0;
+    } /* enet_protocol_handle_acknowledge */
 
-                    default:
-                        break;
-                }
-            }
+    static int enet_protocol_handle_verify_connect(ENetHost *host, ENetEvent *event, ENetPeer *peer, const ENetProtocol *command) {
+        enet_uint32 mtu, windowSize;
+        size_t channelCount;
 
-            switch (enet_protocol_handle_incoming_commands(host, event)) {
-                case 1:
-                    return 1;
+        if (peer->state != ENetPeerState::CONNECTING)
+        {
+            return 0;
+        }
 
-                case -1:
-                    return -1;
+        channelCount = ENET_NET_TO_HOST_32(command->verifyConnect.channelCount);
 
-                default:
-                    break;
-            }
+        if (channelCount < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT || channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT ||
+            ENET_NET_TO_HOST_32(command->verifyConnect.packetThrottleInterval) != peer->packetThrottleInterval ||
+            ENET_NET_TO_HOST_32(command->verifyConnect.packetThrottleAcceleration) != peer->packetThrottleAcceleration ||
+            ENET_NET_TO_HOST_32(command->verifyConnect.packetThrottleDeceleration) != peer->packetThrottleDeceleration ||
+            command->verifyConnect.connectID != peer->connectID
+        ) {
+            peer->eventData = 0;
+            enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+            return -1;
         }
 
-        return -1;
-    } /* enet_protocol_receive_incoming_commands */
+        enet_protocol_remove_sent_reliable_command(peer, 1, 0xFF);
 
-    static void enet_protocol_send_acknowledgements(ENetHost *host, ENetPeer *peer) {
-        ENetProtocol *command = &host->commands[host->commandCount];
-        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
-        [[maybe_unused]] ENetAcknowledgement* acknowledgement;
-        enet_uint16          reliableSequenceNumber;
+        if (channelCount < peer->channelCount) {
+            peer->channelCount = channelCount;
+        }
 
-        for (auto acknowledgement = std::begin(peer->acknowledgements);
-             acknowledgement != std::end(peer->acknowledgements);
-             acknowledgement = peer->acknowledgements.erase(acknowledgement))
-        {
-            if (command >= &host->commands[sizeof(host->commands) / sizeof(ENetProtocol)] ||
-                buffer >= &host->buffers[sizeof(host->buffers) / sizeof(ENetBuffer)] ||
-                peer->mtu - host->packetSize < sizeof(ENetProtocolAcknowledge)
-            ) {
-                break;
-            }
+        peer->outgoingPeerID    = ENET_NET_TO_HOST_16(command->verifyConnect.outgoingPeerID);
+        peer->capabilities      = enet_protocol_decode_session(command->verifyConnect.incomingSessionID, &peer->incomingSessionID) & host->capabilities;
+        peer->outgoingSessionID = command->verifyConnect.outgoingSessionID & ENET_PROTOCOL_SESSION_ID_MASK;
 
-            buffer->data       = command;
-            buffer->dataLength = sizeof(ENetProtocolAcknowledge);
-            host->packetSize += buffer->dataLength;
+        mtu = ENET_NET_TO_HOST_32(command->verifyConnect.mtu);
 
-            reliableSequenceNumber =
-                ENET_HOST_TO_NET_16(acknowledgement->command.header.reliableSequenceNumber);
+        if (mtu < ENET_PROTOCOL_MINIMUM_MTU) {
+            mtu = ENET_PROTOCOL_MINIMUM_MTU;
+        } else if (mtu > ENET_PROTOCOL_MAXIMUM_MTU) {
+            mtu = ENET_PROTOCOL_MAXIMUM_MTU;
+        }
 
-            command->header.command   = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
-            command->header.channelID              = acknowledgement->command.header.channelID;
-            command->header.reliableSequenceNumber = reliableSequenceNumber;
-            command->acknowledge.receivedReliableSequenceNumber = reliableSequenceNumber;
-            command->acknowledge.receivedSentTime = ENET_HOST_TO_NET_16(acknowledgement->sentTime);
+        if (mtu < peer->mtu) {
+            peer->mtu = mtu;
+        }
 
-            if ((acknowledgement->command.header.command & ENET_PROTOCOL_COMMAND_MASK) ==
-                ENET_PROTOCOL_COMMAND_DISCONNECT)
-            {
-                enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
-            }
+        windowSize = ENET_NET_TO_HOST_32(command->verifyConnect.windowSize);
+        if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
+            windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        }
 
-            ++command;
-            ++buffer;
+        if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
+            windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
         }
 
-        host->commandCount = command - host->commands;
-        host->bufferCount  = buffer - host->buffers;
-    } /* enet_protocol_send_acknowledgements */
+        if (windowSize < peer->windowSize) {
+            peer->windowSize = windowSize;
+        }
 
-    static void enet_protocol_send_unreliable_outgoing_commands(ENetHost *host, ENetPeer *peer) {
-        ENetProtocol *command = &host->commands[host->commandCount];
-        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
-        ENetOutgoingCommand *outgoingCommand;
-        ENetListIterator currentCommand;
-
-        currentCommand = enet_list_begin(&peer->outgoingUnreliableCommands);
-        while (currentCommand != enet_list_end(&peer->outgoingUnreliableCommands)) {
-            size_t commandSize;
+        peer->incomingBandwidth = ENET_NET_TO_HOST_32(command->verifyConnect.incomingBandwidth);
+        peer->outgoingBandwidth = ENET_NET_TO_HOST_32(command->verifyConnect.outgoingBandwidth);
 
-            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-            commandSize     = commandSizes[outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK];
+        enet_protocol_notify_connect(host, peer, event);
+        return 0;
+    } /* enet_protocol_handle_verify_connect */
 
-            if (command >= &host->commands[sizeof(host->commands) / sizeof(ENetProtocol)] ||
-                buffer + 1 >= &host->buffers[sizeof(host->buffers) / sizeof(ENetBuffer)] ||
-                peer->mtu - host->packetSize < commandSize ||
-                (outgoingCommand->packet != nullptr &&
-                 peer->mtu - host->packetSize < commandSize + outgoingCommand->fragmentLength))
-            {
-                break;
-            }
+    static int enet_protocol_handle_incoming_commands(ENetHost *host, ENetEvent *event) {
+        ENetProtocolHeader *header;
+        ENetProtocol *command;
+        ENetPeer *peer;
+        enet_uint8 *currentData;
+        size_t headerSize;
+        enet_uint16 peerID, flags;
+        enet_uint8 sessionID;
 
-            currentCommand = enet_list_next(currentCommand);
+        if (host->receivedDataLength < (size_t) &((ENetProtocolHeader *) 0)->sentTime) {
+            return 0;
+        }
 
-            if (outgoingCommand->packet != nullptr && outgoingCommand->fragmentOffset == 0)
-            {
-                peer->packetThrottleCounter += ENET_PEER_PACKET_THROTTLE_COUNTER;
-                peer->packetThrottleCounter %= ENET_PEER_PACKET_THROTTLE_SCALE;
+        header = (ENetProtocolHeader *) host->receivedData;
 
-                if (peer->packetThrottleCounter > peer->packetThrottle) {
-                    enet_uint16 reliableSequenceNumber = outgoingCommand->reliableSequenceNumber;
-                    enet_uint16 unreliableSequenceNumber = outgoingCommand->unreliableSequenceNumber;
-                    for (;;) {
-                        --outgoingCommand->packet->referenceCount;
+        peerID    = ENET_NET_TO_HOST_16(header->peerID);
+        sessionID = (peerID & ENET_PROTOCOL_HEADER_SESSION_MASK) >> ENET_PROTOCOL_HEADER_SESSION_SHIFT;
+        flags     = peerID & ENET_PROTOCOL_HEADER_FLAG_MASK;
+        peerID   &= ~(ENET_PROTOCOL_HEADER_FLAG_MASK | ENET_PROTOCOL_HEADER_SESSION_MASK);
 
-                        if (outgoingCommand->packet->referenceCount == 0) {
-                            enet_packet_destroy(outgoingCommand->packet);
-                        }
+        headerSize = (flags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME ? sizeof(ENetProtocolHeader) : (size_t) &((ENetProtocolHeader *) 0)->sentTime);
+        if (host->checksum != nullptr)
+        {
+            headerSize += sizeof(enet_uint32);
+        }
 
-                        enet_list_remove(&outgoingCommand->outgoingCommandList);
-                        enet_free(outgoingCommand);
+        if (peerID == ENET_PROTOCOL_MAXIMUM_PEER_ID) {
+            peer = nullptr;
+        } else if (peerID >= host->peerCount) {
+            return 0;
+        } else {
+            peer = &host->peers[peerID];
 
-                        if (currentCommand == enet_list_end(&peer->outgoingUnreliableCommands)) {
-                            break;
-                        }
+            if (peer->state == ENetPeerState::DISCONNECTED ||
+                peer->state == ENetPeerState::ZOMBIE ||
+                ((!in6_equal(host->receivedAddress.host , peer->address.host) ||
+                host->receivedAddress.port != peer->address.port) &&
+                1 /* no broadcast in ipv6  !in6_equal(peer->address.host , ENET_HOST_BROADCAST)*/) ||
+                (peer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID &&
+                sessionID != peer->incomingSessionID)
+            )
+            {
+                return 0;
+            }
+        }
 
-                        outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-                        if (outgoingCommand->reliableSequenceNumber != reliableSequenceNumber || outgoingCommand->unreliableSequenceNumber != unreliableSequenceNumber) {
-                            break;
-                        }
+        if (flags & ENET_PROTOCOL_HEADER_FLAG_COMPRESSED) {
+            size_t originalSize;
+            if (host->compressor.context == nullptr || host->compressor.decompress == nullptr)
+            {
+                return 0;
+            }
 
-                        currentCommand = enet_list_next(currentCommand);
-                    }
+            originalSize = host->compressor.decompress(host->compressor.context,
+                host->receivedData + headerSize,
+                host->receivedDataLength - headerSize,
+                host->packetData + headerSize,
+                sizeof(host->packetData) - headerSize
+            );
 
-                    continue;
-                }
+            if (originalSize <= 0 || originalSize > sizeof(host->packetData) - headerSize) {
+                return 0;
             }
 
-            buffer->data       = command;
-            buffer->dataLength = commandSize;
-            host->packetSize += buffer->dataLength;
-            *command = outgoingCommand->command;
-            enet_list_remove(&outgoingCommand->outgoingCommandList);
+            memcpy(host->packetData, header, headerSize);
+            host->receivedData       = host->packetData;
+            host->receivedDataLength = headerSize + originalSize;
+        }
 
-            if (outgoingCommand->packet != nullptr)
-            {
-                ++buffer;
+        if (host->checksum != nullptr)
+        {
+            enet_uint32 *checksum = (enet_uint32 *) &host->receivedData[headerSize - sizeof(enet_uint32)];
+            enet_uint32 desiredChecksum = *checksum;
+            ENetBuffer buffer;
 
-                buffer->data       = outgoingCommand->packet->data + outgoingCommand->fragmentOffset;
-                buffer->dataLength = outgoingCommand->fragmentLength;
+            *checksum = peer != nullptr ? peer->connectID : 0;
 
-                host->packetSize += buffer->dataLength;
+            buffer.data       = host->receivedData;
+            buffer.dataLength = host->receivedDataLength;
 
-                peer->sentUnreliableCommands.insert(peer->sentUnreliableCommands.end(),
-                                                    outgoingCommand);
-            }
-            else
-            {
-                enet_free(outgoingCommand);
+            if (host->checksum(&buffer, 1) != desiredChecksum) {
+                return 0;
             }
-
-            ++command;
-            ++buffer;
         }
 
-        host->commandCount = command - host->commands;
-        host->bufferCount  = buffer - host->buffers;
-
-        if (peer->state == ENetPeerState::DISCONNECT_LATER &&
-            enet_list_empty(&peer->outgoingReliableCommands) &&
-            enet_list_empty(&peer->outgoingUnreliableCommands) &&
-            enet_list_empty(&peer->sentReliableCommands))
+        if (peer != nullptr)
         {
-            peer->disconnect(peer->eventData);
+            peer->address.host       = host->receivedAddress.host;
+            peer->address.port       = host->receivedAddress.port;
+            peer->incomingDataTotal += host->receivedDataLength;
+            peer->totalDataReceived += host->receivedDataLength;
         }
-    } /* enet_protocol_send_unreliable_outgoing_commands */
 
-    static int enet_protocol_check_timeouts(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
-        ENetOutgoingCommand *outgoingCommand;
-        ENetListIterator currentCommand, insertPosition;
+        currentData = host->receivedData + headerSize;
 
-        currentCommand = enet_list_begin(&peer->sentReliableCommands);
-        insertPosition = enet_list_begin(&peer->outgoingReliableCommands);
+        auto commandError = [](ENetEvent *event) -> uint8_t {
+            if (event != nullptr && event->type != ENetEventType::NONE)
+            {
+                return 1;
+            }
 
-        while (currentCommand != enet_list_end(&peer->sentReliableCommands)) {
-            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+            return 0;
+        };
 
-            currentCommand = enet_list_next(currentCommand);
+        while (currentData < &host->receivedData[host->receivedDataLength])
+        {
+            enet_uint8 commandNumber;
+            size_t commandSize;
 
-            if (ENET_TIME_DIFFERENCE(host->serviceTime, outgoingCommand->sentTime) < outgoingCommand->roundTripTimeout) {
-                continue;
+            command = (ENetProtocol *) currentData;
+
+            if (currentData + sizeof(ENetProtocolCommandHeader) > &host->receivedData[host->receivedDataLength]) {
+                break;
             }
 
-            if (peer->earliestTimeout == 0 || ENET_TIME_LESS(outgoingCommand->sentTime, peer->earliestTimeout)) {
-                peer->earliestTimeout = outgoingCommand->sentTime;
+            commandNumber = command->header.command & ENET_PROTOCOL_COMMAND_MASK;
+            if (commandNumber >= ENET_PROTOCOL_COMMAND_COUNT) {
+                break;
             }
 
-            if (peer->earliestTimeout != 0 &&
-                (ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= peer->timeoutMaximum ||
-                (outgoingCommand->roundTripTimeout >= outgoingCommand->roundTripTimeoutLimit &&
-                ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= peer->timeoutMinimum))
-            ) {
-                enet_protocol_notify_disconnect_timeout(host, peer, event);
-                return 1;
+            commandSize = commandSizes[commandNumber];
+            if (commandSize == 0 || currentData + commandSize > &host->receivedData[host->receivedDataLength]) {
+                break;
             }
 
-            if (outgoingCommand->packet != nullptr)
+            currentData += commandSize;
+
+            if (peer == nullptr && (commandNumber != ENET_PROTOCOL_COMMAND_CONNECT ||
+                                    currentData < &host->receivedData[host->receivedDataLength]))
             {
-                peer->reliableDataInTransit -= outgoingCommand->fragmentLength;
+                break;
             }
 
-            ++peer->packetsLost;
-            ++peer->totalPacketsLost;
+            command->header.reliableSequenceNumber = ENET_NET_TO_HOST_16(command->header.reliableSequenceNumber);
 
-            /* Replaced exponential backoff time with something more linear */
-            /* Source: http://lists.cubik.org/pipermail/enet-discuss/2014-May/002308.html */
-            outgoingCommand->roundTripTimeout = peer->roundTripTime + 4 * peer->roundTripTimeVariance;
-            outgoingCommand->roundTripTimeoutLimit = peer->timeoutLimit * outgoingCommand->roundTripTimeout;
+            switch (commandNumber) {
+                case ENET_PROTOCOL_COMMAND_ACKNOWLEDGE:
+                case ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE:
+                    if (enet_protocol_handle_acknowledge(host, event, peer, command)) {
+                        return commandError(event);
+                    }
+                    break;
 
-            enet_list_insert(insertPosition, enet_list_remove(&outgoingCommand->outgoingCommandList));
+                case ENET_PROTOCOL_COMMAND_CONNECT:
+                    if (peer != nullptr)
+                    {
+                        return commandError(event);
+                    }
+                    peer = enet_protocol_handle_connect(host, header, command);
+                    if (peer == nullptr)
+                    {
+                        return commandError(event);
+                    }
+                    break;
 
-            if (currentCommand == enet_list_begin(&peer->sentReliableCommands) && !enet_list_empty(&peer->sentReliableCommands)) {
-                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-                peer->nextTimeout = outgoingCommand->sentTime + outgoingCommand->roundTripTimeout;
-            }
-        }
+                case ENET_PROTOCOL_COMMAND_VERIFY_CONNECT:
+                    if (enet_protocol_handle_verify_connect(host, event, peer, command)) {
+                        return commandError(event);
+                    }
+                    break;
 
-        return 0;
-    } /* enet_protocol_check_timeouts */
+                case ENET_PROTOCOL_COMMAND_DISCONNECT:
+                    if (enet_protocol_handle_disconnect(host, peer, command)) {
+                        return commandError(event);
+                    }
+                    break;
 
-    static int enet_protocol_send_reliable_outgoing_commands(ENetHost *host, ENetPeer *peer) {
-        ENetProtocol *command = &host->commands[host->commandCount];
-        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
-        ENetOutgoingCommand *outgoingCommand;
-        ENetListIterator currentCommand;
-        ENetChannel *channel;
-        enet_uint16 reliableWindow;
-        size_t commandSize;
-        int windowExceeded = 0, windowWrap = 0, canPing = 1;
+                case ENET_PROTOCOL_COMMAND_PING:
+                    if (enet_protocol_handle_ping(host, peer, command)) {
+                        return commandError(event);
+                    }
+                    break;
 
-        currentCommand = enet_list_begin(&peer->outgoingReliableCommands);
+                case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+                    if (enet_protocol_handle_send_reliable(host, peer, command, &currentData)) {
+                        return commandError(event);
+                    }
+                    break;
 
-        while (currentCommand != enet_list_end(&peer->outgoingReliableCommands)) {
-            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+                case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE:
+                    if (enet_protocol_handle_send_unreliable(host, peer, command, &currentData)) {
+                        return commandError(event);
+                    }
+                    break;
 
-            channel = outgoingCommand->command.header.channelID < peer->channelCount
-                          ? &peer->channels[outgoingCommand->command.header.channelID]
-                          : nullptr;
-            reliableWindow = outgoingCommand->reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
-            if (channel != nullptr)
-            {
-                if (!windowWrap &&
-                    outgoingCommand->sendAttempts < 1 &&
-                    !(outgoingCommand->reliableSequenceNumber % ENET_PEER_RELIABLE_WINDOW_SIZE) &&
-                    (channel->reliableWindows[(reliableWindow + ENET_PEER_RELIABLE_WINDOWS - 1)
-                    % ENET_PEER_RELIABLE_WINDOWS] >= ENET_PEER_RELIABLE_WINDOW_SIZE ||
-                    channel->usedReliableWindows & ((((1 << ENET_PEER_FREE_RELIABLE_WINDOWS) - 1) << reliableWindow)
-                    | (((1 << ENET_PEER_FREE_RELIABLE_WINDOWS) - 1) >> (ENET_PEER_RELIABLE_WINDOWS - reliableWindow))))
-                ) {
-                    windowWrap = 1;
-                }
+                case ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED:
+                    if (enet_protocol_handle_send_unsequenced(host, peer, command, &currentData)) {
+                        return commandError(event);
+                    }
+                    break;
 
-                if (windowWrap) {
-                    currentCommand = enet_list_next(currentCommand);
-                    continue;
-                }
+                case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
+                    if (enet_protocol_handle_send_fragment(host, peer, command, &currentData)) {
+                        return commandError(event);
+                    }
+                    break;
+
+                case ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT:
+                    if (enet_protocol_handle_bandwidth_limit(host, peer, command)) {
+                        return commandError(event);
+                    }
+                    break;
+
+                case ENET_PROTOCOL_COMMAND_THROTTLE_CONFIGURE:
+                    if (enet_protocol_handle_throttle_configure(host, peer, command)) {
+                        return commandError(event);
+                    }
+                    break;
+
+                case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT:
+                    if (enet_protocol_handle_send_unreliable_fragment(host, peer, command, &currentData)) {
+                        return commandError(event);
+                    }
+                    break;
+
+                default:
+                    return commandError(event);
             }
 
-            if (outgoingCommand->packet != nullptr)
+            if (peer != nullptr &&
+                (command->header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) != 0)
             {
-                if (!windowExceeded) {
-                    enet_uint32 windowSize = (peer->packetThrottle * peer->windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
+                enet_uint16 sentTime;
 
-                    if (peer->reliableDataInTransit +
-                            outgoingCommand->fragmentLength >
-                        std::max(windowSize, peer->mtu))
+                if (!(flags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME)) {
+                    break;
+                }
+
+                sentTime = ENET_NET_TO_HOST_16(header->sentTime);
+
+                switch (peer->state)
+                {
+                case ENetPeerState::DISCONNECTING:
+                case ENetPeerState::ACKNOWLEDGING_CONNECT:
+                case ENetPeerState::DISCONNECTED:
+                case ENetPeerState::ZOMBIE:
+                    break;
+
+                case ENetPeerState::ACKNOWLEDGING_DISCONNECT:
+                    if ((command->header.command & ENET_PROTOCOL_COMMAND_MASK) ==
+                        ENET_PROTOCOL_COMMAND_DISCONNECT)
                     {
-                        windowExceeded = 1;
+                        peer->queue_acknowledgement(command, sentTime);
                     }
-                }
-                if (windowExceeded) {
-                    currentCommand = enet_list_next(currentCommand);
+                    break;
 
-                    continue;
+                default:
+                    peer->queue_acknowledgement(command, sentTime);
+                    break;
                 }
             }
+        }
 
-            canPing = 0;
+        return commandError(event);
 
-            commandSize = commandSizes[outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK];
-            if (command >= &host->commands[sizeof(host->commands) / sizeof(ENetProtocol)] ||
-                buffer + 1 >= &host->buffers[sizeof(host->buffers) / sizeof(ENetBuffer)] ||
-                peer->mtu - host->packetSize < commandSize ||
-                (outgoingCommand->packet != nullptr &&
-                 (enet_uint16)(peer->mtu - host->packetSize) <
-                     (enet_uint16)(commandSize + outgoingCommand->fragmentLength)))
-            {
-                break;
-            }
+    } /* enet_protocol_handle_incoming_commands */
 
-            currentCommand = enet_list_next(currentCommand);
+    static int enet_protocol_receive_incoming_commands(ENetHost *host, ENetEvent *event) {
 
-            if (channel != nullptr && outgoingCommand->sendAttempts < 1)
+        for (auto packets = 0; packets < 256; ++packets)
+        {
+            ENetSocketMessage *message;
+            size_t segmentOffset, segmentLength;
+
+            if (host->receiveMessageIndex >= host->receiveMessageCount)
             {
-                channel->usedReliableWindows |= 1 << reliableWindow;
-                ++channel->reliableWindows[reliableWindow];
+                if (host->zeroCopyReceives && host->renew_receive_slabs() < 0) {
+                    return -1;
+                }
+
+                int receivedCount = host->socket.receive_many(host->receiveMessages.data(),
+                    std::min(host->receiveMessages.size(), (size_t) (256 - packets)));
+
+                host->receiveMessageIndex  = 0;
+                host->receiveMessageCount  = 0;
+                host->receiveSegmentOffset = 0;
+
+                if (receivedCount < 0) {
+                    return -1;
+                }
+
+                if (receivedCount == 0) {
+                    return 0;
+                }
+
+                host->receiveMessageCount = receivedCount;
             }
 
-            ++outgoingCommand->sendAttempts;
+            /* datagrams left in the batch when an event is returned are handled on the next call */
+            message       = &host->receiveMessages[host->receiveMessageIndex];
+            segmentOffset = host->receiveSegmentOffset;
+            segmentLength = message->dataLength - segmentOffset;
 
-            if (outgoingCommand->roundTripTimeout == 0) {
-                outgoingCommand->roundTripTimeout      = peer->roundTripTime + 4 * peer->roundTripTimeVariance;
-                outgoingCommand->roundTripTimeoutLimit = peer->timeoutLimit * outgoingCommand->roundTripTimeout;
+            if (message->segmentSize > 0 && segmentLength > message->segmentSize) {
+                segmentLength = message->segmentSize;
             }
 
-            if (enet_list_empty(&peer->sentReliableCommands)) {
-                peer->nextTimeout = host->serviceTime + outgoingCommand->roundTripTimeout;
+            if (segmentOffset + segmentLength < message->dataLength) {
+                host->receiveSegmentOffset += segmentLength;
+            } else {
+                host->receiveSegmentOffset = 0;
+                ++host->receiveMessageIndex;
             }
 
-            enet_list_insert(enet_list_end(&peer->sentReliableCommands), enet_list_remove(&outgoingCommand->outgoingCommandList));
+            if (segmentLength == 0) {
+                continue;
+            }
 
-            outgoingCommand->sentTime = host->serviceTime;
+            host->receivedAddress    = message->address;
+            host->receivedData       = (enet_uint8 *) message->buffers->data + segmentOffset;
+            host->receivedDataLength = segmentLength;
+            host->receivedSlab       = host->zeroCopyReceives ? host->receiveSlabs[message - host->receiveMessages.data()] : nullptr;
 
-            buffer->data       = command;
-            buffer->dataLength = commandSize;
+            host->totalReceivedData += segmentLength;
+            host->totalReceivedPackets++;
 
-            host->packetSize  += buffer->dataLength;
-            host->headerFlags |= ENET_PROTOCOL_HEADER_FLAG_SENT_TIME;
+            if (host->intercept != nullptr)
+            {
+                switch (host->intercept(host, (void *)event)) {
+                    case 1:
+                        if (event != nullptr && event->type != ENetEventType::NONE)
+                        {
+                            return 1;
+                        }
 
-            *command = outgoingCommand->command;
+                        continue;
 
-            if (outgoingCommand->packet != nullptr)
-            {
-                ++buffer;
-                buffer->data       = outgoingCommand->packet->data + outgoingCommand->fragmentOffset;
-                buffer->dataLength = outgoingCommand->fragmentLength;
-                host->packetSize += outgoingCommand->fragmentLength;
-                peer->reliableDataInTransit += outgoingCommand->fragmentLength;
+                    case -1:
+                        return -1;
+
+                    default:
+                        break;
+                }
             }
 
-            ++peer->packetsSent;
-            ++peer->totalPacketsSent;
+            switch (enet_protocol_handle_incoming_commands(host, event)) {
+                case 1:
+                    return 1;
 
-            ++command;
-            ++buffer;
+                case -1:
+                    return -1;
+
+                default:
+                    break;
+            }
         }
 
-        host->commandCount = command - host->commands;
-        host->bufferCount  = buffer - host->buffers;
+        return 0;
+    } /* enet_protocol_receive_incoming_commands */
 
-        return canPing;
-    } /* enet_protocol_send_reliable_outgoing_commands */
+    static void enet_protocol_send_acknowledgements(ENetHost *host, ENetPeer *peer) {
+        ENetProtocol *command = &host->commands[host->commandCount];
+        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
+        ENetAcknowledgement *acknowledgement;
+        enet_uint16          reliableSequenceNumber, sentTime;
+        enet_uint32          receivedMask;
+        enet_uint8           channelID;
+        bool                 disconnected;
+        size_t commandSize = (peer->capabilities & ENET_PROTOCOL_CAPABILITY_ACKNOWLEDGE_RANGE)
+                               ? sizeof(ENetProtocolAcknowledgeRange) : sizeof(ENetProtocolAcknowledge);
+
+        while (!peer->acknowledgements.empty())
+        {
+            if (command >= &host->commands[ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS] ||
+                buffer >= &host->buffers[ENET_BUFFER_MAXIMUM] ||
+                peer->mtu - host->packetSize < commandSize
+            ) {
+                /* entries already folded into a range are not acknowledgements of their own */
+                for (size_t i = peer->acknowledgements.deferred; i < peer->acknowledgements.size(); ++i)
+                {
+                    if ((peer->acknowledgements[i].command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_NONE) {
+                        ++peer->deferredAcknowledgements;
+                    }
+                }
 
-    static int enet_protocol_send_outgoing_commands(ENetHost *host, ENetEvent *event, int checkForTimeouts) {
-        enet_uint8 headerData[sizeof(ENetProtocolHeader) + sizeof(enet_uint32)];
-        ENetProtocolHeader *header = (ENetProtocolHeader *) headerData;
-        int sentLength;
-        size_t shouldCompress = 0;
-        uint8_t continueSending = 1;
+                peer->acknowledgements.deferred = peer->acknowledgements.size();
+                break;
+            }
 
-        while (continueSending) {
-            for (continueSending = 0; auto &currentPeer : host->peers)
+            acknowledgement = &peer->acknowledgements.front();
+            if ((acknowledgement->command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_NONE)
             {
-                if (currentPeer.state == ENetPeerState::DISCONNECTED ||
-                    currentPeer.state == ENetPeerState::ZOMBIE)
-                {
-                    continue;
-                }
+                /* already folded into an earlier range */
+                peer->acknowledgements.pop_front();
+                continue;
+            }
 
-                host->headerFlags  = 0;
-                host->commandCount = 0;
-                host->bufferCount  = 1;
-                host->packetSize   = sizeof(ENetProtocolHeader);
+            reliableSequenceNumber = acknowledgement->command.header.reliableSequenceNumber;
+            channelID              = acknowledgement->command.header.channelID;
+            sentTime               = acknowledgement->sentTime;
+            disconnected           = (acknowledgement->command.header.command & ENET_PROTOCOL_COMMAND_MASK) ==
+                                     ENET_PROTOCOL_COMMAND_DISCONNECT;
+            receivedMask           = 0;
+            peer->acknowledgements.pop_front();
+
+            /* fold the queued acknowledgements for the next 32 sequence numbers of the same channel into
+             * one range, marking them as consumed in place; the newest sent time stands in for all of them.
+             * They queue mostly in sequence order, so the scan stops at the first one of the channel past
+             * the range and never looks further than ENET_PEER_ACKNOWLEDGEMENT_FOLD_SCAN entries */
+            if (peer->capabilities & ENET_PROTOCOL_CAPABILITY_ACKNOWLEDGE_RANGE)
+            {
+                size_t scan = std::min(peer->acknowledgements.size(), (size_t) ENET_PEER_ACKNOWLEDGEMENT_FOLD_SCAN);
 
-                if (!currentPeer.acknowledgements.empty())
+                for (size_t i = 0; i < scan; ++i)
                 {
-                    enet_protocol_send_acknowledgements(host, &currentPeer);
-                }
+                    acknowledgement = &peer->acknowledgements[i];
 
-                if (checkForTimeouts != 0 && !enet_list_empty(&currentPeer.sentReliableCommands) &&
-                    ENET_TIME_GREATER_EQUAL(host->serviceTime, currentPeer.nextTimeout) &&
-                    enet_protocol_check_timeouts(host, &currentPeer, event) == 1)
-                {
-                    if (event != nullptr && event->type != ENetEventType::NONE)
+                    if (acknowledgement->command.header.channelID != channelID ||
+                        (acknowledgement->command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_NONE)
                     {
-                        return 1;
+                        continue;
                     }
-                    else
+
+                    enet_uint16 offset = acknowledgement->command.header.reliableSequenceNumber - reliableSequenceNumber - 1;
+                    if (offset >= 32)
                     {
+                        if (offset < 0x8000) {
+                            break;
+                        }
+
                         continue;
                     }
-                }
-
-                if ((enet_list_empty(&currentPeer.outgoingReliableCommands) ||
-                     enet_protocol_send_reliable_outgoing_commands(host, &currentPeer)) &&
-                    enet_list_empty(&currentPeer.sentReliableCommands) &&
-                    ENET_TIME_DIFFERENCE(host->serviceTime, currentPeer.lastReceiveTime) >=
-                        currentPeer.pingInterval &&
-                    currentPeer.mtu - host->packetSize >= sizeof(ENetProtocolPing))
-                {
-                    currentPeer.ping();
-                    enet_protocol_send_reliable_outgoing_commands(host, &currentPeer);
-                }
 
-                if (!enet_list_empty(&currentPeer.outgoingUnreliableCommands))
-                {
-                    enet_protocol_send_unreliable_outgoing_commands(host, &currentPeer);
+                    receivedMask |= 1u << offset;
+                    sentTime      = acknowledgement->sentTime;
+                    disconnected |= (acknowledgement->command.header.command & ENET_PROTOCOL_COMMAND_MASK) ==
+                                    ENET_PROTOCOL_COMMAND_DISCONNECT;
+                    acknowledgement->command.header.command = ENET_PROTOCOL_COMMAND_NONE;
                 }
+            }
 
-                if (host->commandCount == 0) {
-                    continue;
-                }
+            buffer->data = command;
 
-                if (currentPeer.packetLossEpoch == 0)
-                {
-                    currentPeer.packetLossEpoch = host->serviceTime;
-                }
-                else if (ENET_TIME_DIFFERENCE(host->serviceTime, currentPeer.packetLossEpoch) >=
-                             ENET_PEER_PACKET_LOSS_INTERVAL &&
-                         currentPeer.packetsSent > 0)
-                {
-                    enet_uint32 packetLoss = currentPeer.packetsLost * ENET_PEER_PACKET_LOSS_SCALE /
-                                             currentPeer.packetsSent;
+            command->header.channelID              = channelID;
+            command->header.reliableSequenceNumber = ENET_HOST_TO_NET_16(reliableSequenceNumber);
+            command->acknowledge.receivedReliableSequenceNumber = ENET_HOST_TO_NET_16(reliableSequenceNumber);
+            command->acknowledge.receivedSentTime = ENET_HOST_TO_NET_16(sentTime);
 
-#ifdef ENET_DEBUG
-                    printf("peer %u: %f%%+-%f%% packet loss, %u+-%u ms round trip time, %f%% "
-                           "throttle, %u/%u outgoing, %u/%u incoming\n",
-                           currentPeer.incomingPeerID,
-                           currentPeer.packetLoss / (float)ENET_PEER_PACKET_LOSS_SCALE,
-                           currentPeer.packetLossVariance / (float)ENET_PEER_PACKET_LOSS_SCALE,
-                           currentPeer.roundTripTime, currentPeer.roundTripTimeVariance,
-                           currentPeer.packetThrottle / (float)ENET_PEER_PACKET_THROTTLE_SCALE,
-                           enet_list_size(&currentPeer.outgoingReliableCommands),
-                           enet_list_size(&currentPeer.outgoingUnreliableCommands),
-                           currentPeer.channels != nullptr
-                               ? enet_list_size(&currentPeer.channels->incomingReliableCommands)
-                               : 0,
-                           currentPeer.channels != nullptr
-                               ? enet_list_size(&currentPeer.channels->incomingUnreliableCommands)
-                               : 0);
-#endif
+            if (receivedMask != 0) {
+                command->header.command                = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE;
+                command->acknowledgeRange.receivedMask = ENET_HOST_TO_NET_32(receivedMask);
+                buffer->dataLength = sizeof(ENetProtocolAcknowledgeRange);
+            } else {
+                command->header.command = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
+                buffer->dataLength      = sizeof(ENetProtocolAcknowledge);
+            }
 
-                    currentPeer.packetLossVariance -= currentPeer.packetLossVariance / 4;
+            host->packetSize += buffer->dataLength;
 
-                    if (packetLoss >= currentPeer.packetLoss)
-                    {
-                        currentPeer.packetLoss += (packetLoss - currentPeer.packetLoss) / 8;
-                        currentPeer.packetLossVariance += (packetLoss - currentPeer.packetLoss) / 4;
-                    }
-                    else
-                    {
-                        currentPeer.packetLoss -= (currentPeer.packetLoss - packetLoss) / 8;
-                        currentPeer.packetLossVariance += (currentPeer.packetLoss - packetLoss) / 4;
-                    }
-
-                    currentPeer.packetLossEpoch = host->serviceTime;
-                    currentPeer.packetsSent     = 0;
-                    currentPeer.packetsLost     = 0;
-                }
-
-                host->buffers->data = headerData;
-                if (host->headerFlags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME) {
-                    header->sentTime = ENET_HOST_TO_NET_16(host->serviceTime & 0xFFFF);
-                    host->buffers->dataLength = sizeof(ENetProtocolHeader);
-                } else {
-                    host->buffers->dataLength = (size_t) &((ENetProtocolHeader *) 0)->sentTime;
-                }
+            if (disconnected)
+            {
+                enet_protocol_dispatch_state(host, peer, ENetPeerState::ZOMBIE);
+            }
 
-                shouldCompress = 0;
-                if (host->compressor.context != nullptr && host->compressor.compress != nullptr)
-                {
-                    size_t originalSize = host->packetSize - sizeof(ENetProtocolHeader),
-                      compressedSize    = host->compressor.compress(host->compressor.context, &host->buffers[1], host->bufferCount - 1, originalSize, host->packetData[1], originalSize);
-                    if (compressedSize > 0 && compressedSize < originalSize) {
-                        host->headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
-                        shouldCompress     = compressedSize;
-                        #ifdef ENET_DEBUG_COMPRESS
-                        printf("peer %u: compressed %u->%u (%u%%)\n", currentPeer.incomingPeerID,
-                               originalSize, compressedSize, (compressedSize * 100) / originalSize);
-#endif
-                    }
-                }
+            ++command;
+            ++buffer;
+        }
 
-                if (currentPeer.outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID)
-                {
-                    host->headerFlags |= currentPeer.outgoingSessionID
-                                         << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
-                }
-                header->peerID =
-                    ENET_HOST_TO_NET_16(currentPeer.outgoingPeerID | host->headerFlags);
-                if (host->checksum != nullptr)
-                {
-                    enet_uint32 *checksum = (enet_uint32 *) &headerData[host->buffers->dataLength];
-                    *checksum = currentPeer.outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID
-                                    ? currentPeer.connectID
-                                    : 0;
-                    host->buffers->dataLength += sizeof(enet_uint32);
-                    *checksum = host->checksum(host->buffers, host->bufferCount);
-                }
+        host->commandCount = command - host->commands;
+        host->bufferCount  = buffer - host->buffers;
+    } /* enet_protocol_send_acknowledgements */
 
-                if (shouldCompress > 0) {
-                    host->buffers[1].data       = host->packetData[1];
-                    host->buffers[1].dataLength = shouldCompress;
-                    host->bufferCount = 2;
-                }
+    static void enet_protocol_send_unreliable_outgoing_commands(ENetHost *host, ENetPeer *peer) {
+        ENetProtocol *command = &host->commands[host->commandCount];
+        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
+        ENetOutgoingCommand *outgoingCommand;
+        ENetListIterator currentCommand;
 
-                currentPeer.lastSendTime = host->serviceTime;
-                sentLength =
-                    host->socket.send(&currentPeer.address, host->buffers, host->bufferCount);
-                enet_protocol_remove_sent_unreliable_commands(&currentPeer);
+        currentCommand = enet_list_begin(&peer->outgoingUnreliableCommands);
+        while (currentCommand != enet_list_end(&peer->outgoingUnreliableCommands)) {
+            size_t commandSize;
 
-                if (sentLength < 0) {
-                    return -1;
-                }
+            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+            commandSize     = commandSizes[outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK];
 
-                host->totalSentData += sentLength;
-                currentPeer.totalDataSent += sentLength;
-                host->totalSentPackets++;
+            if (command >= &host->commands[ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS] ||
+                buffer + 1 >= &host->buffers[ENET_BUFFER_MAXIMUM] ||
+                peer->mtu - host->packetSize < commandSize ||
+                (outgoingCommand->packet != nullptr &&
+                 peer->mtu - host->packetSize < commandSize + outgoingCommand->fragmentLength))
+            {
+                host->continueSending = host->segmentedSends;
+                break;
             }
-        }
 
-        return 0;
-    } /* enet_protocol_send_outgoing_commands */
+            currentCommand = enet_list_next(currentCommand);
 
-    /** Sends any queued packets on the host specified to its designated peers.
-     *
-     *  @param host   host to flush
-     *  @remarks this function need only be used in circumstances where one wishes to send queued packets earlier than in a call to enet_host_service().
-     *  @ingroup host
-     */
-    void ENetHost::flush()
-    {
-        this->serviceTime = enet_time_get();
-        enet_protocol_send_outgoing_commands(this, nullptr, 0);
-    }
+            if (outgoingCommand->packet != nullptr && outgoingCommand->fragmentOffset == 0)
+            {
+                peer->packetThrottleCounter += ENET_PEER_PACKET_THROTTLE_COUNTER;
+                peer->packetThrottleCounter %= ENET_PEER_PACKET_THROTTLE_SCALE;
 
-    /** Checks for any queued events on the host and dispatches one if available.
-     *
-     *  @param host    host to check for events
-     *  @param event   an event structure where event details will be placed if available
-     *  @retval > 0 if an event was dispatched
-     *  @retval 0 if no events are available
-     *  @retval < 0 on failure
-     *  @ingroup host
-     */
-    bool ENetHost::check_events(ENetEvent &event)
-    {
-        event.type   = ENetEventType::NONE;
-        event.peer   = nullptr;
-        event.packet = nullptr;
+                if (peer->packetThrottleCounter > peer->packetThrottle) {
+                    enet_uint16 reliableSequenceNumber = outgoingCommand->reliableSequenceNumber;
+                    enet_uint16 unreliableSequenceNumber = outgoingCommand->unreliableSequenceNumber;
+                    for (;;) {
+                        --outgoingCommand->packet->referenceCount;
 
-        return enet_protocol_dispatch_incoming_commands(this, event);
-    }
+                        if (outgoingCommand->packet->referenceCount == 0) {
+                            enet_packet_destroy(outgoingCommand->packet);
+                        }
 
-    /** Waits for events on the host specified and shuttles packets between
-     *  the host and its peers.
-     *
-     *  @param host    host to service
-     *  @param event   an event structure where event details will be placed if one occurs
-     *                 if event == nullptr then no events will be delivered
-     *  @param timeout number of milliseconds that ENet should wait for events
-     *  @retval > 0 if an event occurred within the specified time limit
-     *  @retval 0 if no event occurred
-     *  @retval < 0 on failure
-     *  @remarks enet_host_service should be called fairly regularly for adequate performance
-     *  @ingroup host
-     */
-    int ENetHost::service(ENetEvent *event, enet_uint32 timeout)
-    {
-        enet_uint32 waitCondition;
+                        enet_list_remove(&outgoingCommand->outgoingCommandList);
+                        host->outgoingCommandPool.release(outgoingCommand);
 
-        if (event != nullptr && this->check_events(*event))
-        {
-            return 1;
-        }
+                        if (currentCommand == enet_list_end(&peer->outgoingUnreliableCommands)) {
+                            break;
+                        }
 
-        this->serviceTime = enet_time_get();
-        timeout += this->serviceTime;
+                        outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+                        if (outgoingCommand->reliableSequenceNumber != reliableSequenceNumber || outgoingCommand->unreliableSequenceNumber != unreliableSequenceNumber) {
+                            break;
+                        }
 
-        do {
-            if (ENET_TIME_DIFFERENCE(this->serviceTime, this->bandwidthThrottleEpoch) >=
-                ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL)
-            {
-                this->bandwidth_throttle();
+                        currentCommand = enet_list_next(currentCommand);
+                    }
+
+                    continue;
+                }
             }
 
-            switch (enet_protocol_send_outgoing_commands(this, event, 1))
+            buffer->data       = command;
+            buffer->dataLength = commandSize;
+            host->packetSize += buffer->dataLength;
+            *command = outgoingCommand->command;
+            enet_list_remove(&outgoingCommand->outgoingCommandList);
+
+            if (outgoingCommand->packet != nullptr)
             {
-            case 1:
-                return 1;
+                ++buffer;
 
-            case -1:
-#ifdef ENET_DEBUG
-                perror("Error sending outgoing packets");
-#endif
+                buffer->data       = outgoingCommand->packet->data + outgoingCommand->fragmentOffset;
+                buffer->dataLength = outgoingCommand->fragmentLength;
 
-                return -1;
+                host->packetSize += buffer->dataLength;
 
-            default:
-                break;
+                peer->sentUnreliableCommands.insert(peer->sentUnreliableCommands.end(),
+                                                    outgoingCommand);
             }
-
-            switch (enet_protocol_receive_incoming_commands(this, event))
+            else
             {
-            case 1:
-                return 1;
+                host->outgoingCommandPool.release(outgoingCommand);
+            }
 
-            case -1:
-#ifdef ENET_DEBUG
-                perror("Error receiving incoming packets");
-#endif
+            ++command;
+            ++buffer;
+        }
 
-                return -1;
+        host->commandCount = command - host->commands;
+        host->bufferCount  = buffer - host->buffers;
 
-            default:
-                break;
-            }
+        if (peer->state == ENetPeerState::DISCONNECT_LATER &&
+            enet_list_empty(&peer->outgoingReliableCommands) &&
+            enet_list_empty(&peer->outgoingUnreliableCommands) &&
+            enet_list_empty(&peer->sentReliableCommands) &&
+            peer->sentUnreliableCommands.empty())
+        {
+            peer->disconnect(peer->eventData);
+        }
+    } /* enet_protocol_send_unreliable_outgoing_commands */
 
-            switch (enet_protocol_send_outgoing_commands(this, event, 1))
-            {
-            case 1:
-                return 1;
+    static int enet_protocol_check_timeouts(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
+        ENetOutgoingCommand *outgoingCommand;
+        ENetListIterator currentCommand, insertPosition;
 
-            case -1:
-#ifdef ENET_DEBUG
-                perror("Error sending outgoing packets");
-#endif
+        currentCommand = enet_list_begin(&peer->sentReliableCommands);
+        insertPosition = enet_list_begin(&peer->outgoingReliableCommands);
 
-                return -1;
+        while (currentCommand != enet_list_end(&peer->sentReliableCommands)) {
+            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
 
-            default:
-                break;
+            currentCommand = enet_list_next(currentCommand);
+
+            if (ENET_TIME_DIFFERENCE(host->serviceTime, outgoingCommand->sentTime) < outgoingCommand->roundTripTimeout) {
+                continue;
             }
 
-            if (event != nullptr && enet_protocol_dispatch_incoming_commands(this, *event))
-            {
+            if (peer->earliestTimeout == 0 || ENET_TIME_LESS(outgoingCommand->sentTime, peer->earliestTimeout)) {
+                peer->earliestTimeout = outgoingCommand->sentTime;
+            }
+
+            if (peer->earliestTimeout != 0 &&
+                (ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= (enet_uint64) peer->timeoutMaximum * ENET_TIME_MILLISECOND ||
+                (outgoingCommand->roundTripTimeout >= outgoingCommand->roundTripTimeoutLimit &&
+                ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= (enet_uint64) peer->timeoutMinimum * ENET_TIME_MILLISECOND))
+            ) {
+                enet_protocol_notify_disconnect_timeout(host, peer, event);
                 return 1;
             }
 
-            if (ENET_TIME_GREATER_EQUAL(this->serviceTime, timeout))
+            if (outgoingCommand->packet != nullptr)
             {
-                return 0;
+                peer->reliableDataInTransit -= outgoingCommand->fragmentLength;
             }
 
-            do {
-                this->serviceTime = enet_time_get();
-
-                if (ENET_TIME_GREATER_EQUAL(this->serviceTime, timeout))
-                {
-                    return 0;
-                }
+            outgoingCommand->inTransit = 0;
 
-                waitCondition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
-                if (this->socket.wait(waitCondition, ENET_TIME_DIFFERENCE(timeout, this->serviceTime)) !=
-                    0)
-                {
-                    return -1;
-                }
-            } while (waitCondition & ENET_SOCKET_WAIT_INTERRUPT);
+            ++peer->packetsLost;
+            ++peer->totalPacketsLost;
 
-            this->serviceTime = enet_time_get();
-        } while (waitCondition & ENET_SOCKET_WAIT_RECEIVE);
-
-        return 0;
-    } /* enet_host_service */
-
-    // =======================================================================//
-    // !
-    // ! Peer
-    // !
-    // =======================================================================//
+            /* Replaced exponential backoff time with something more linear */
+            /* Source: http://lists.cubik.org/pipermail/enet-discuss/2014-May/002308.html */
+            outgoingCommand->roundTripTimeout = peer->roundTripTime + 4 * peer->roundTripTimeVariance;
+            outgoingCommand->roundTripTimeoutLimit = peer->timeoutLimit * outgoingCommand->roundTripTimeout;
 
-    void *enet_packet_get_data(ENetPacket *packet) { return (void *)packet->data; }
+            enet_list_insert(insertPosition, enet_list_remove(&outgoingCommand->outgoingCommandList));
 
-    enet_uint32 enet_packet_get_length(ENetPacket *packet) { return packet->dataLength; }
+            if (currentCommand == enet_list_begin(&peer->sentReliableCommands) && !enet_list_empty(&peer->sentReliableCommands)) {
+                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+                peer->nextTimeout = outgoingCommand->sentTime + outgoingCommand->roundTripTimeout;
+            }
+        }
 
-    void enet_packet_set_free_callback(ENetPacket *packet, void *callback) {
-        packet->freeCallback = (ENetPacketFreeCallback)callback;
-    }
+        return 0;
+    } /* enet_protocol_check_timeouts */
 
-    void enet_peer_reset_outgoing_commands(ENetList *queue)
-    {
+    static int enet_protocol_send_reliable_outgoing_commands(ENetHost *host, ENetPeer *peer) {
+        ENetProtocol *command = &host->commands[host->commandCount];
+        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
         ENetOutgoingCommand *outgoingCommand;
+        ENetListIterator currentCommand;
+        ENetChannel *channel;
+        enet_uint16 reliableWindow;
+        size_t commandSize;
+        int windowExceeded = 0, windowWrap = 0, canPing = 1;
 
-        while (!enet_list_empty(queue)) {
-            outgoingCommand = (ENetOutgoingCommand *) enet_list_remove(enet_list_begin(queue));
+        currentCommand = enet_list_begin(&peer->outgoingReliableCommands);
 
-            if (outgoingCommand->packet != nullptr)
+        while (currentCommand != enet_list_end(&peer->outgoingReliableCommands)) {
+            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+
+            channel = outgoingCommand->command.header.channelID < peer->channelCount
+                          ? &peer->channels[outgoingCommand->command.header.channelID]
+                          : nullptr;
+            reliableWindow = outgoingCommand->reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+            if (channel != nullptr)
             {
-                --outgoingCommand->packet->referenceCount;
+                if (!windowWrap &&
+                    outgoingCommand->sendAttempts < 1 &&
+                    !(outgoingCommand->reliableSequenceNumber % ENET_PEER_RELIABLE_WINDOW_SIZE) &&
+                    (channel->reliableWindows[(reliableWindow + ENET_PEER_RELIABLE_WINDOWS - 1)
+                    % ENET_PEER_RELIABLE_WINDOWS] >= ENET_PEER_RELIABLE_WINDOW_SIZE ||
+                    channel->usedReliableWindows & ((((1 << ENET_PEER_FREE_RELIABLE_WINDOWS) - 1) << reliableWindow)
+                    | (((1 << ENET_PEER_FREE_RELIABLE_WINDOWS) - 1) >> (ENET_PEER_RELIABLE_WINDOWS - reliableWindow))))
+                ) {
+                    windowWrap = 1;
+                }
 
-                if (outgoingCommand->packet->referenceCount == 0) {
-                    enet_packet_destroy(outgoingCommand->packet);
+                if (windowWrap) {
+                    currentCommand = enet_list_next(currentCommand);
+                    continue;
                 }
             }
 
-            enet_free(outgoingCommand);
-        }
-    }
-
-    void enet_peer_reset_outgoing_commands(std::list<ENetOutgoingCommand *> &queue)
-    {
-        ENetOutgoingCommand *outgoingCommand;
-
-        while (!queue.empty())
-        {
-            outgoingCommand = queue.front();
-            queue.pop_front();
-
             if (outgoingCommand->packet != nullptr)
             {
-                --outgoingCommand->packet->referenceCount;
+                if (!windowExceeded) {
+                    enet_uint32 windowSize = (peer->packetThrottle * peer->windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
 
-                if (outgoingCommand->packet->referenceCount == 0)
-                {
-                    enet_packet_destroy(outgoingCommand->packet);
+                    if (peer->reliableDataInTransit +
+                            outgoingCommand->fragmentLength >
+                        std::max(windowSize, peer->mtu))
+                    {
+                        windowExceeded = 1;
+                    }
+                }
+                if (windowExceeded) {
+                    currentCommand = enet_list_next(currentCommand);
+
+                    continue;
                 }
             }
 
-            enet_free(outgoingCommand);
-        }
-    }
+            canPing = 0;
 
-    void enet_peer_remove_incoming_commands([[maybe_unused]] ENetList *queue, ENetListIterator startCommand, ENetListIterator endCommand)
-    {
+            commandSize = commandSizes[outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK];
+            if (command >= &host->commands[ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS] ||
+                buffer + 1 >= &host->buffers[ENET_BUFFER_MAXIMUM] ||
+                peer->mtu - host->packetSize < commandSize ||
+                (outgoingCommand->packet != nullptr &&
+                 (enet_uint16)(peer->mtu - host->packetSize) <
+                     (enet_uint16)(commandSize + outgoingCommand->fragmentLength)))
+            {
+                host->continueSending = host->segmentedSends;
+                break;
+            }
 
-        for (auto currentCommand = startCommand; currentCommand != endCommand;)
-        {
-            ENetIncomingCommand *incomingCommand = (ENetIncomingCommand *) currentCommand;
+            if (outgoingCommand->sendAttempts < 1)
+            {
+                ENetSequenceIndex<ENetOutgoingCommand> *index = enet_protocol_sent_command_index(peer, outgoingCommand->command.header.channelID);
+
+                if (index != nullptr && index->insert(outgoingCommand) < 0) {
+                    break;
+                }
+            }
 
             currentCommand = enet_list_next(currentCommand);
-            enet_list_remove(&incomingCommand->incomingCommandList);
 
-            if (incomingCommand->packet != nullptr)
+            if (channel != nullptr && outgoingCommand->sendAttempts < 1)
             {
-                --incomingCommand->packet->referenceCount;
+                channel->usedReliableWindows |= 1 << reliableWindow;
+                ++channel->reliableWindows[reliableWindow];
+            }
 
-                if (incomingCommand->packet->referenceCount == 0) {
-                    enet_packet_destroy(incomingCommand->packet);
-                }
+            ++outgoingCommand->sendAttempts;
+            outgoingCommand->inTransit = 1;
+
+            if (outgoingCommand->roundTripTimeout == 0) {
+                outgoingCommand->roundTripTimeout      = peer->roundTripTime + 4 * peer->roundTripTimeVariance;
+                outgoingCommand->roundTripTimeoutLimit = peer->timeoutLimit * outgoingCommand->roundTripTimeout;
+            }
+
+            if (enet_list_empty(&peer->sentReliableCommands)) {
+                peer->nextTimeout = host->serviceTime + outgoingCommand->roundTripTimeout;
             }
 
-            if (incomingCommand->fragments != nullptr)
+            enet_list_insert(enet_list_end(&peer->sentReliableCommands), enet_list_remove(&outgoingCommand->outgoingCommandList));
+
+            outgoingCommand->sentTime = host->serviceTime;
+
+            buffer->data       = command;
+            buffer->dataLength = commandSize;
+
+            host->packetSize  += buffer->dataLength;
+            host->headerFlags |= ENET_PROTOCOL_HEADER_FLAG_SENT_TIME;
+
+            *command = outgoingCommand->command;
+
+            if (outgoingCommand->packet != nullptr)
             {
-                enet_free(incomingCommand->fragments);
+                ++buffer;
+                buffer->data       = outgoingCommand->packet->data + outgoingCommand->fragmentOffset;
+                buffer->dataLength = outgoingCommand->fragmentLength;
+                host->packetSize += outgoingCommand->fragmentLength;
+                peer->reliableDataInTransit += outgoingCommand->fragmentLength;
             }
 
-            enet_free(incomingCommand);
+            ++peer->packetsSent;
+            ++peer->totalPacketsSent;
+
+            ++command;
+            ++buffer;
         }
-    }
 
-    void enet_peer_reset_incoming_commands(ENetList *queue)
-    {
-        enet_peer_remove_incoming_commands(queue, enet_list_begin(queue), enet_list_end(queue));
-    }
+        host->commandCount = command - host->commands;
+        host->bufferCount  = buffer - host->buffers;
 
-    // =======================================================================//
-    // !
-    // ! Host
-    // !
-    // =======================================================================//
+        return canPing;
+    } /* enet_protocol_send_reliable_outgoing_commands */
 
-    /** Creates a host for communicating to peers.
-     *
-     *  @param address   the address at which other peers may connect to this host.  If nullptr,
-     * then no peers may connect to the host.
-     *  @param peerCount the maximum number of peers that should be allocated for the host.
-     *  @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to
-     * ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
-     *  @param incomingBandwidth downstream bandwidth of the host in bytes/second; if 0, ENet will
-     * assume unlimited bandwidth.
-     *  @param outgoingBandwidth upstream bandwidth of the host in bytes/second; if 0, ENet will
-     * assume unlimited bandwidth.
-     *
-     *  @returns the host on success and nullptr on failure
-     *
-     *  @remarks ENet will strategically drop packets on specific sides of a connection between
-     * hosts to ensure the host's bandwidth is not overwhelmed.  The bandwidth parameters also
-     * determine the window size of a connection which limits the amount of reliable packets that
-     * may be in transit at any given time.
+    /** Builds one socket message for each staged datagram, starting with the given message.
+     *  @returns the number of socket messages in use
      */
-    ENetHost::ENetHost(const ENetAddress *address, size_t peerCount, size_t channelLimit,
-                       enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
-    {
-        if (peerCount > ENET_PROTOCOL_MAXIMUM_PEER_ID) {
-            peerCount = ENET_PROTOCOL_MAXIMUM_PEER_ID;
+    static size_t enet_protocol_stage_messages(ENetHost *host, size_t messageIndex) {
+        for (size_t i = 0; i < host->sendDatagramCount; ++i)
+        {
+            ENetDatagram *datagram = &host->sendDatagrams[i];
+            ENetSocketMessage *message;
+
+            if (datagram->messageIndex < messageIndex) {
+                continue;
+            }
+
+            message = &host->sendMessages[messageIndex];
+
+            message->address     = datagram->peer->address;
+            message->buffers     = datagram->buffers;
+            message->bufferCount = datagram->bufferCount;
+            message->dataLength  = 0;
+            message->segmentSize = 0;
+
+            datagram->messageIndex = messageIndex++;
         }
 
-        this->peers.resize(peerCount);
+        return messageIndex;
+    } /* enet_protocol_stage_messages */
 
-        if (!this->socket.is_null())
+    /** Builds socket messages that carry consecutive datagrams to the same peer as one train, as
+     * long as every datagram but the last has the size of the first.
+     *  @returns the number of socket messages in use
+     */
+    static size_t enet_protocol_stage_segmented_messages(ENetHost *host) {
+        ENetBuffer *buffers = host->sendSegmentBuffers.data();
+        size_t messageCount = 0;
+
+        for (size_t i = 0; i < host->sendDatagramCount; ++i)
         {
-            this->socket.set_option(ENET_SOCKOPT_IPV6_V6ONLY, 0);
+            host->sendDatagrams[i].messageIndex = host->sendDatagramCount;
         }
 
-        if (this->socket.is_null() || (address != nullptr && this->socket.bind(address) < 0))
+        for (size_t i = 0; i < host->sendDatagramCount; ++i)
         {
-            assert(0);
-            this->~ENetHost();
+            ENetDatagram *first = &host->sendDatagrams[i];
+            ENetSocketMessage *message;
+            size_t segmentCount = 0, lastLength = 0;
 
-            return;
-        }
+            if (first->messageIndex < host->sendDatagramCount) {
+                continue;
+            }
 
-        this->socket.set_option(ENET_SOCKOPT_NONBLOCK, 1);
-        this->socket.set_option(ENET_SOCKOPT_BROADCAST, 1);
-        this->socket.set_option(ENET_SOCKOPT_RCVBUF, ENET_HOST_RECEIVE_BUFFER_SIZE);
-        this->socket.set_option(ENET_SOCKOPT_SNDBUF, ENET_HOST_SEND_BUFFER_SIZE);
-        this->socket.set_option(ENET_SOCKOPT_IPV6_V6ONLY, 0);
+            message = &host->sendMessages[messageCount];
 
-        if (address != nullptr && this->socket.get_address(&this->address) < 0)
-        {
-            this->address = *address;
-        }
+            message->address     = first->peer->address;
+            message->buffers     = buffers;
+            message->bufferCount = 0;
+            message->dataLength  = 0;
 
-        if (!channelLimit || channelLimit > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
-            channelLimit = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
-        } else if (channelLimit < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT) {
-            channelLimit = ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT;
-        }
+            for (size_t j = i; j < host->sendDatagramCount; ++j)
+            {
+                ENetDatagram *datagram = &host->sendDatagrams[j];
 
-        this->randomSeed = (enet_uint32)(size_t)this;
-        this->randomSeed += this->random_seed();
-        this->randomSeed                 = (this->randomSeed << 16) | (this->randomSeed >> 16);
-        this->channelLimit               = channelLimit;
-        this->incomingBandwidth          = incomingBandwidth;
-        this->outgoingBandwidth          = outgoingBandwidth;
-        this->peerCount                  = peerCount;
-        this->receivedAddress.host       = ENET_HOST_ANY;
-        this->receivedAddress.port       = 0;
-        this->compressor                 = {nullptr, nullptr, nullptr, nullptr};
+                if (datagram->peer != first->peer || datagram->messageIndex < host->sendDatagramCount) {
+                    continue;
+                }
 
-        dispatchQueue.clear();
+                if (segmentCount > 0 &&
+                    (lastLength != first->dataLength ||
+                     datagram->dataLength > first->dataLength ||
+                     segmentCount >= ENET_HOST_SEGMENT_MAXIMUM ||
+                     message->dataLength + datagram->dataLength > ENET_HOST_SEGMENT_DATA_MAXIMUM ||
+                     message->bufferCount + datagram->bufferCount > ENET_HOST_SEGMENT_BUFFER_MAXIMUM))
+                {
+                    break;
+                }
 
-        for (auto &currentPeer : this->peers)
-        {
-            currentPeer.host              = this;
-            currentPeer.incomingPeerID    = &currentPeer - &this->peers.front();
-            currentPeer.outgoingSessionID = currentPeer.incomingSessionID = 0xFF;
-            currentPeer.data                                              = nullptr;
+                memcpy(&message->buffers[message->bufferCount], datagram->buffers, datagram->bufferCount * sizeof(ENetBuffer));
 
-            currentPeer.acknowledgements.clear();
-            enet_list_clear(&currentPeer.sentReliableCommands);
-            currentPeer.sentUnreliableCommands.clear();
-            enet_list_clear(&currentPeer.outgoingReliableCommands);
-            enet_list_clear(&currentPeer.outgoingUnreliableCommands);
-            enet_list_clear(&currentPeer.dispatchedCommands);
+                message->bufferCount += datagram->bufferCount;
+                message->dataLength  += datagram->dataLength;
+                lastLength            = datagram->dataLength;
 
-            currentPeer.reset();
+                datagram->messageIndex = messageCount;
+                ++segmentCount;
+            }
+
+            message->segmentSize = segmentCount > 1 ? first->dataLength : 0;
+            message->dataLength  = 0;
+
+            buffers += message->bufferCount;
+            ++messageCount;
         }
-    } /* enet_host_create */
 
-    /** Destroys the host and all resources associated with it.
-     *  @param host pointer to the host to destroy
+        return messageCount;
+    } /* enet_protocol_stage_segmented_messages */
+
+    /** Hands the datagrams staged by the current send pass to the socket.
+     *  @remarks unreliable commands carried by the staged datagrams are released afterwards, since
+     *  their packets back the datagram buffers until then.
      */
-    ENetHost::~ENetHost()
-    {
-        for (auto &currentPeer : this->peers)
-        {
-            currentPeer.reset();
-        }
-
-        if (this->compressor.context != nullptr && this->compressor.destroy != nullptr)
-        {
-            (*this->compressor.destroy)(this->compressor.context);
-        }
-    }
-
-    /** Initiates a connection to a foreign host.
-     *  @param host host seeking the connection
-     *  @param address destination for the connection
-     *  @param channelCount number of channels to allocate
-     *  @param data user data supplied to the receiving host
-     *  @returns a peer representing the foreign host on success, nullptr on failure
-     *  @remarks The peer returned will have not completed the connection until enet_host_service()
-     *  notifies of an ENetEventType::CONNECT event for the peer.
-     */
-    ENetPeer *ENetHost::connect(const ENetAddress *address, size_t channelCount, enet_uint32 data)
-    {
-        ENetProtocol command;
+    static int enet_protocol_flush_datagrams(ENetHost *host) {
+        size_t messageCount, sentCount = 0;
+        int result = 0;
 
-        if (channelCount < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT) {
-            channelCount = ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT;
-        } else if (channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
-            channelCount = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
+        if (host->segmentedSends) {
+            messageCount = enet_protocol_stage_segmented_messages(host);
+        } else {
+            messageCount = enet_protocol_stage_messages(host, 0);
         }
 
-        auto currentPeer = std::find_if(this->peers.begin(), this->peers.end(), [](auto &peer) {
-            return peer.state == ENetPeerState::DISCONNECTED;
-        });
-
-        if (currentPeer >= this->peers.end())
+        while (sentCount < messageCount)
         {
-            return nullptr;
-        }
+            int sentMessages = host->socket.send_many(&host->sendMessages[sentCount], messageCount - sentCount);
 
-        currentPeer->channels = (ENetChannel *) enet_malloc(channelCount * sizeof(ENetChannel));
-        if (currentPeer->channels == nullptr)
-        {
-            return nullptr;
-        }
+            if (sentMessages < 0)
+            {
+                /* the route may refuse trains (e.g. segments larger than its MTU), so fall back to single datagrams */
+                if (host->sendMessages[sentCount].segmentSize > 0)
+                {
+                    host->segmentedSends = 0;
+                    messageCount = enet_protocol_stage_messages(host, sentCount);
+                    continue;
+                }
 
-        currentPeer->channelCount = channelCount;
-        currentPeer->state        = ENetPeerState::CONNECTING;
-        currentPeer->address      = *address;
-        currentPeer->connectID    = ++this->randomSeed;
+                result = -1;
+                break;
+            }
 
-        if (this->outgoingBandwidth == 0)
-        {
-            currentPeer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
-        }
-        else
-        {
-            currentPeer->windowSize = (this->outgoingBandwidth / ENET_PEER_WINDOW_SIZE_SCALE) *
-                                      ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
-        }
+            /* the socket buffer is full, the remaining datagrams are dropped like a lost packet */
+            if (sentMessages == 0) {
+                break;
+            }
 
-        if (currentPeer->windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
-            currentPeer->windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
-        } else if (currentPeer->windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
-            currentPeer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+            sentCount += sentMessages;
         }
 
-        for (auto channel = currentPeer->channels; channel < &currentPeer->channels[channelCount];
-             ++channel)
+        for (size_t i = 0; i < host->sendDatagramCount; ++i)
         {
-            channel->outgoingReliableSequenceNumber   = 0;
-            channel->outgoingUnreliableSequenceNumber = 0;
-            channel->incomingReliableSequenceNumber   = 0;
-            channel->incomingUnreliableSequenceNumber = 0;
-
-            enet_list_clear(&channel->incomingReliableCommands);
-            enet_list_clear(&channel->incomingUnreliableCommands);
-
-            channel->usedReliableWindows = 0;
-            channel->reliableWindows     = {0};
-        }
-
-        command.header.command                     = ENET_PROTOCOL_COMMAND_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
-        command.header.channelID                   = 0xFF;
-        command.connect.outgoingPeerID             = ENET_HOST_TO_NET_16(currentPeer->incomingPeerID);
-        command.connect.incomingSessionID          = currentPeer->incomingSessionID;
-        command.connect.outgoingSessionID          = currentPeer->outgoingSessionID;
-        command.connect.mtu                        = ENET_HOST_TO_NET_32(currentPeer->mtu);
-        command.connect.windowSize                 = ENET_HOST_TO_NET_32(currentPeer->windowSize);
-        command.connect.channelCount               = ENET_HOST_TO_NET_32(channelCount);
-        command.connect.incomingBandwidth          = ENET_HOST_TO_NET_32(this->incomingBandwidth);
-        command.connect.outgoingBandwidth          = ENET_HOST_TO_NET_32(this->outgoingBandwidth);
-        command.connect.packetThrottleInterval     = ENET_HOST_TO_NET_32(currentPeer->packetThrottleInterval);
-        command.connect.packetThrottleAcceleration = ENET_HOST_TO_NET_32(currentPeer->packetThrottleAcceleration);
-        command.connect.packetThrottleDeceleration = ENET_HOST_TO_NET_32(currentPeer->packetThrottleDeceleration);
-        command.connect.connectID                  = currentPeer->connectID;
-        command.connect.data                       = ENET_HOST_TO_NET_32(data);
-
-        currentPeer->queue_outgoing_command(&command, nullptr, 0, 0);
-
-        return currentPeer.operator->();
-    } /* enet_host_connect */
+            ENetDatagram *datagram = &host->sendDatagrams[i];
 
-    /** Queues a packet to be sent to all peers associated with the host.
-     *  @param host host on which to broadcast the packet
-     *  @param channelID channel on which to broadcast
-     *  @param packet packet to broadcast
-     */
-    void ENetHost::broadcast(enet_uint8 channelID, ENetPacket *packet)
-    {
+            enet_protocol_remove_sent_unreliable_commands(datagram->peer);
 
-        for (auto &currentPeer : this->peers)
-        {
-            if (currentPeer.state != ENetPeerState::CONNECTED)
+            if (datagram->messageIndex < sentCount)
             {
-                continue;
+                host->totalSentData += datagram->dataLength;
+                datagram->peer->totalDataSent += datagram->dataLength;
+                host->totalSentPackets++;
             }
-
-            currentPeer.send(channelID, packet);
-        }
-
-        if (packet->referenceCount == 0) {
-            enet_packet_destroy(packet);
         }
-    }
 
-    /** Sends raw data to specified address. Useful when you want to send unconnected data using host's socket.         
-     *  @param host host sending data
-     *  @param address destination address
-     *  @param data data pointer
-     *  @param dataLength length of data to send
-     *  @retval >=0 bytes sent
-     *  @retval <0 error
-     *  @sa enet_socket_send
-     */
-    int ENetHost::send_raw(const ENetAddress *address, enet_uint8 *data, size_t dataLength)
-    {
-        ENetBuffer buffer;
-        buffer.data = data;
-        buffer.dataLength = dataLength;
-        return this->socket.send(address, &buffer, 1);
-    }
+        host->sendDatagramCount = 0;
 
-    /** Sends raw data to specified address with extended arguments. Allows to send only part of data, handy for other programming languages.
-     *  I.e. if you have data =- { 0, 1, 2, 3 } and call function as enet_host_send_raw_ex(data, 1, 2) then it will skip 1 byte and send 2 bytes { 1, 2 }.
-     *  @param host host sending data
-     *  @param address destination address
-     *  @param data data pointer
-     *  @param skipBytes number of bytes to skip from start of data
-     *  @param bytesToSend number of bytes to send
-     *  @retval >=0 bytes sent
-     *  @retval <0 error
-     *  @sa enet_socket_send
-     */
-    int ENetHost::send_raw_ex(const ENetAddress *address, enet_uint8 *data, size_t skipBytes,
-                              size_t bytesToSend)
-    {
-        ENetBuffer buffer;
-        buffer.data = data + skipBytes;
-        buffer.dataLength = bytesToSend;
-        return this->socket.send(address, &buffer, 1);
-    }
+        return result;
+    } /* enet_protocol_flush_datagrams */
 
-    /** Sets intercept callback for the host.
-     *  @param host host to set a callback
-     *  @param callback intercept callback
-     */
-    void ENetHost::set_intercept(const ENetInterceptCallback callback)
-    {
-        this->intercept = callback;
-    }
+    /** Adds the peers whose retransmission or ping deadline passed to the send queue. */
+    static void enet_protocol_queue_due_peers(ENetHost *host) {
+        ENetTimer *timer;
 
-    /** Sets the packet compressor the host should use to compress and decompress packets.
-     *  @param host host to enable or disable compression for
-     *  @param compressor callbacks for for the packet compressor; if nullptr, then compression is
-     * disabled
-     */
-    void ENetHost::compress(const ENetCompressor *compressor)
-    {
-        if (this->compressor.context != nullptr && this->compressor.destroy)
+        while ((timer = host->timers.expire(host->serviceTime)) != nullptr)
         {
-            (*this->compressor.destroy)(this->compressor.context);
-        }
+            ENetPeer *peer = (ENetPeer *) timer->data;
 
-        if (compressor) {
-            this->compressor = *compressor;
-        } else {
-            this->compressor.context = nullptr;
-        }
-    }
-
-    /** Limits the maximum allowed channels of future incoming connections.
-     *  @param host host to limit
-     *  @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
-     */
-    void ENetHost::channel_limit(size_t channelLimit)
-    {
-        if (!channelLimit || channelLimit > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
-            channelLimit = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
-        } else if (channelLimit < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT) {
-            channelLimit = ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT;
+            if (!peer->needsSend)
+            {
+                host->sendQueue.push_back(peer);
+                peer->needsSend = 1;
+            }
         }
+    } /* enet_protocol_queue_due_peers */
 
-        this->channelLimit = channelLimit;
-    }
-
-    /** Adjusts the bandwidth limits of a host.
-     *  @param host host to adjust
-     *  @param incomingBandwidth new incoming bandwidth
-     *  @param outgoingBandwidth new outgoing bandwidth
-     *  @remarks the incoming and outgoing bandwidth parameters are identical in function to those
-     *  specified in enet_host_create().
+    /** Reschedules the deadlines of the peers visited by a send pass and drops the peers that have
+     * nothing left to send from the send queue.
      */
-    void ENetHost::bandwidth_limit(enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
-    {
-        this->incomingBandwidth          = incomingBandwidth;
-        this->outgoingBandwidth          = outgoingBandwidth;
-        this->recalculateBandwidthLimits = 1;
-    }
-
-    void ENetHost::bandwidth_throttle()
-    {
-        enet_uint32 timeCurrent       = enet_time_get();
-        enet_uint32 elapsedTime       = timeCurrent - this->bandwidthThrottleEpoch;
-        enet_uint32 peersRemaining    = (enet_uint32)this->connectedPeers;
-        enet_uint32 dataTotal         = ~0;
-        enet_uint32 bandwidth         = ~0;
-        enet_uint32 throttle          = 0;
-        enet_uint32 bandwidthLimit    = 0;
-
-        int          needsAdjustment = this->bandwidthLimitedPeers > 0 ? 1 : 0;
-        ENetProtocol command;
-
-        if (elapsedTime < ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL) {
-            return;
-        }
+    static void enet_protocol_prune_send_queue(ENetHost *host) {
+        size_t queuedPeers = 0;
 
-        if (this->outgoingBandwidth == 0 && this->incomingBandwidth == 0)
+        for (auto peer : host->sendQueue)
         {
-            return;
-        }
+            host->schedule_peer(peer);
 
-        this->bandwidthThrottleEpoch = timeCurrent;
-
-        if (peersRemaining == 0) {
-            return;
+            if (peer->state != ENetPeerState::DISCONNECTED &&
+                peer->state != ENetPeerState::ZOMBIE &&
+                (!peer->acknowledgements.empty() ||
+                 !enet_list_empty(&peer->outgoingReliableCommands) ||
+                 !enet_list_empty(&peer->outgoingUnreliableCommands)))
+            {
+                host->sendQueue[queuedPeers++] = peer;
+            }
+            else
+            {
+                peer->needsSend = 0;
+            }
         }
 
-        if (this->outgoingBandwidth != 0)
-        {
-            dataTotal = 0;
-            bandwidth = (this->outgoingBandwidth * elapsedTime) / 1000;
+        host->sendQueue.resize(queuedPeers);
+    } /* enet_protocol_prune_send_queue */
 
-            for (auto &peer : this->peers)
-            {
-                if (peer.state != ENetPeerState::CONNECTED &&
-                    peer.state != ENetPeerState::DISCONNECT_LATER)
-                {
-                    continue;
-                }
+    static int enet_protocol_send_outgoing_commands(ENetHost *host, ENetEvent *event, int checkForTimeouts) {
+        ENetProtocolHeader *header;
+        ENetDatagram *datagram;
+        size_t shouldCompress = 0;
+        int result;
 
-                dataTotal += peer.outgoingDataTotal;
-            }
+        if (checkForTimeouts != 0) {
+            enet_protocol_queue_due_peers(host);
         }
 
-        while (peersRemaining > 0 && needsAdjustment != 0) {
-            needsAdjustment = 0;
+        host->continueSending = 1;
 
-            if (dataTotal <= bandwidth) {
-                throttle = ENET_PEER_PACKET_THROTTLE_SCALE;
-            } else {
-                throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
-            }
+        /* peers queued while the pass runs are appended, and reset peers stay queued until pruned */
+        while (host->continueSending) {
+            host->continueSending = 0;
 
-            for (auto &peer : this->peers)
+            for (size_t queueIndex = 0; queueIndex < host->sendQueue.size(); ++queueIndex)
             {
-                enet_uint32 peerBandwidth;
+                ENetPeer &currentPeer = *host->sendQueue[queueIndex];
 
-                if ((peer.state != ENetPeerState::CONNECTED &&
-                     peer.state != ENetPeerState::DISCONNECT_LATER) ||
-                    peer.incomingBandwidth == 0 ||
-                    peer.outgoingBandwidthThrottleEpoch == timeCurrent)
+                if (currentPeer.state == ENetPeerState::DISCONNECTED ||
+                    currentPeer.state == ENetPeerState::ZOMBIE)
                 {
                     continue;
                 }
 
-                peerBandwidth = (peer.incomingBandwidth * elapsedTime) / 1000;
-                if ((throttle * peer.outgoingDataTotal) / ENET_PEER_PACKET_THROTTLE_SCALE <=
-                    peerBandwidth)
-                {
-                    continue;
-                }
+                datagram = &host->sendDatagrams[host->sendDatagramCount];
+                header   = (ENetProtocolHeader *) datagram->headerData;
 
-                peer.packetThrottleLimit =
-                    (peerBandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / peer.outgoingDataTotal;
+                host->headerFlags  = 0;
+                host->commands     = datagram->commands;
+                host->commandCount = 0;
+                host->buffers      = datagram->buffers;
+                host->bufferCount  = 1;
+                host->packetSize   = sizeof(ENetProtocolHeader);
 
-                if (peer.packetThrottleLimit == 0)
+                if (!currentPeer.acknowledgements.empty())
                 {
-                    peer.packetThrottleLimit = 1;
+                    enet_protocol_send_acknowledgements(host, &currentPeer);
                 }
 
-                if (peer.packetThrottle > peer.packetThrottleLimit)
-                {
-                    peer.packetThrottle = peer.packetThrottleLimit;
-                }
-
-                peer.outgoingBandwidthThrottleEpoch = timeCurrent;
-
-                peer.incomingDataTotal = 0;
-                peer.outgoingDataTotal = 0;
-
-                needsAdjustment = 1;
-                --peersRemaining;
-                bandwidth -= peerBandwidth;
-                dataTotal -= peerBandwidth;
-            }
-        }
-
-        if (peersRemaining > 0) {
-            if (dataTotal <= bandwidth) {
-                throttle = ENET_PEER_PACKET_THROTTLE_SCALE;
-            } else {
-                throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
-            }
-
-            for (auto &peer : this->peers)
-            {
-                if ((peer.state != ENetPeerState::CONNECTED &&
-                     peer.state != ENetPeerState::DISCONNECT_LATER) ||
-                    peer.outgoingBandwidthThrottleEpoch == timeCurrent)
+                if (checkForTimeouts != 0 && !enet_list_empty(&currentPeer.sentReliableCommands) &&
+                    ENET_TIME_GREATER_EQUAL(host->serviceTime, currentPeer.nextTimeout) &&
+                    enet_protocol_check_timeouts(host, &currentPeer, event) == 1)
                 {
-                    continue;
+                    if (event != nullptr && event->type != ENetEventType::NONE)
+                    {
+                        return enet_protocol_flush_datagrams(host) < 0 ? -1 : 1;
+                    }
+                    else
+                    {
+                        continue;
+                    }
                 }
 
-                peer.packetThrottleLimit = throttle;
+                if ((enet_list_empty(&currentPeer.outgoingReliableCommands) ||
+                     enet_protocol_send_reliable_outgoing_commands(host, &currentPeer)) &&
+                    enet_list_empty(&currentPeer.sentReliableCommands) &&
+                    ENET_TIME_DIFFERENCE(host->serviceTime, currentPeer.lastReceiveTime) >=
+                        (enet_uint64) currentPeer.pingInterval * ENET_TIME_MILLISECOND &&
+                    currentPeer.mtu - host->packetSize >= sizeof(ENetProtocolPing))
+                {
+                    currentPeer.ping();
+                    enet_protocol_send_reliable_outgoing_commands(host, &currentPeer);
+                }
 
-                if (peer.packetThrottle > peer.packetThrottleLimit)
+                if (!enet_list_empty(&currentPeer.outgoingUnreliableCommands))
                 {
-                    peer.packetThrottle = peer.packetThrottleLimit;
+                    enet_protocol_send_unreliable_outgoing_commands(host, &currentPeer);
                 }
 
-                peer.incomingDataTotal = 0;
-                peer.outgoingDataTotal = 0;
-            }
-        }
+                if (host->commandCount == 0) {
+                    continue;
+                }
 
-        if (this->recalculateBandwidthLimits)
-        {
-            this->recalculateBandwidthLimits = 0;
+                if (currentPeer.packetLossEpoch == 0)
+                {
+                    currentPeer.packetLossEpoch = host->serviceTime;
+                }
+                else if (ENET_TIME_DIFFERENCE(host->serviceTime, currentPeer.packetLossEpoch) >=
+                             ENET_PEER_PACKET_LOSS_INTERVAL * ENET_TIME_MILLISECOND &&
+                         currentPeer.packetsSent > 0)
+                {
+                    enet_uint32 packetLoss = currentPeer.packetsLost * ENET_PEER_PACKET_LOSS_SCALE /
+                                             currentPeer.packetsSent;
 
-            peersRemaining  = (enet_uint32)this->connectedPeers;
-            bandwidth       = this->incomingBandwidth;
-            needsAdjustment = 1;
+#ifdef ENET_DEBUG
+                    printf("peer %u: %f%%+-%f%% packet loss, %u+-%u us round trip time, %f%% "
+                           "throttle, %u/%u outgoing, %u/%u incoming\n",
+                           currentPeer.incomingPeerID,
+                           currentPeer.packetLoss / (float)ENET_PEER_PACKET_LOSS_SCALE,
+                           currentPeer.packetLossVariance / (float)ENET_PEER_PACKET_LOSS_SCALE,
+                           currentPeer.roundTripTime, currentPeer.roundTripTimeVariance,
+                           currentPeer.packetThrottle / (float)ENET_PEER_PACKET_THROTTLE_SCALE,
+                           enet_list_size(&currentPeer.outgoingReliableCommands),
+                           enet_list_size(&currentPeer.outgoingUnreliableCommands),
+                           currentPeer.channels != nullptr
+                               ? currentPeer.channels->incomingReliableCommands.count
+                               : 0,
+                           currentPeer.channels != nullptr
+                               ? enet_list_size(&currentPeer.channels->incomingUnreliableCommands)
+                               : 0);
+#endif
 
-            if (bandwidth == 0) {
-                bandwidthLimit = 0;
-            } else {
-                while (peersRemaining > 0 && needsAdjustment != 0) {
-                    needsAdjustment = 0;
-                    bandwidthLimit  = bandwidth / peersRemaining;
+                    currentPeer.packetLossVariance -= currentPeer.packetLossVariance / 4;
 
-                    for (auto &peer : this->peers)
+                    if (packetLoss >= currentPeer.packetLoss)
                     {
-                        if ((peer.state != ENetPeerState::CONNECTED &&
-                             peer.state != ENetPeerState::DISCONNECT_LATER) ||
-                            peer.incomingBandwidthThrottleEpoch == timeCurrent)
-                        {
-                            continue;
-                        }
+                        currentPeer.packetLoss += (packetLoss - currentPeer.packetLoss) / 8;
+                        currentPeer.packetLossVariance += (packetLoss - currentPeer.packetLoss) / 4;
+                    }
+                    else
+                    {
+                        currentPeer.packetLoss -= (currentPeer.packetLoss - packetLoss) / 8;
+                        currentPeer.packetLossVariance += (currentPeer.packetLoss - packetLoss) / 4;
+                    }
 
-                        if (peer.outgoingBandwidth > 0 && peer.outgoingBandwidth >= bandwidthLimit)
-                        {
-                            continue;
-                        }
+                    currentPeer.packetLossEpoch = host->serviceTime;
+                    currentPeer.packetsSent     = 0;
+                    currentPeer.packetsLost     = 0;
+                }
 
-                        peer.incomingBandwidthThrottleEpoch = timeCurrent;
+                host->buffers->data = datagram->headerData;
+                if (host->headerFlags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME) {
+                    header->sentTime = ENET_HOST_TO_NET_16((host->serviceTime / ENET_TIME_MILLISECOND) & 0xFFFF);
+                    host->buffers->dataLength = sizeof(ENetProtocolHeader);
+                } else {
+                    host->buffers->dataLength = (size_t) &((ENetProtocolHeader *) 0)->sentTime;
+                }
 
-                        needsAdjustment = 1;
-                        --peersRemaining;
-                        bandwidth -= peer.outgoingBandwidth;
+                shouldCompress = 0;
+                if (host->compressor.context != nullptr && host->compressor.compress != nullptr)
+                {
+                    size_t originalSize = host->packetSize - sizeof(ENetProtocolHeader),
+                      compressedSize    = host->compressor.compress(host->compressor.context, &host->buffers[1], host->bufferCount - 1, originalSize, datagram->compressedData, originalSize);
+                    if (compressedSize > 0 && compressedSize < originalSize) {
+                        host->headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
+                        shouldCompress     = compressedSize;
+                        #ifdef ENET_DEBUG_COMPRESS
+                        printf("peer %u: compressed %u->%u (%u%%)\n", currentPeer.incomingPeerID,
+                               originalSize, compressedSize, (compressedSize * 100) / originalSize);
+#endif
                     }
                 }
-            }
 
-            for (auto &peer : this->peers)
-            {
-                if (peer.state != ENetPeerState::CONNECTED &&
-                    peer.state != ENetPeerState::DISCONNECT_LATER)
+                if (currentPeer.outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID)
                 {
-                    continue;
+                    host->headerFlags |= currentPeer.outgoingSessionID
+                                         << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
+                }
+                header->peerID =
+                    ENET_HOST_TO_NET_16(currentPeer.outgoingPeerID | host->headerFlags);
+                if (host->checksum != nullptr)
+                {
+                    enet_uint32 *checksum = (enet_uint32 *) &datagram->headerData[host->buffers->dataLength];
+                    *checksum = currentPeer.outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID
+                                    ? currentPeer.connectID
+                                    : 0;
+                    host->buffers->dataLength += sizeof(enet_uint32);
+                    *checksum = host->checksum(host->buffers, host->bufferCount);
                 }
 
-                command.header.command   = ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
-                command.header.channelID = 0xFF;
-                command.bandwidthLimit.outgoingBandwidth =
-                    ENET_HOST_TO_NET_32(this->outgoingBandwidth);
+                if (shouldCompress > 0) {
+                    host->buffers[1].data       = datagram->compressedData;
+                    host->buffers[1].dataLength = shouldCompress;
+                    host->bufferCount = 2;
+                }
+
+                currentPeer.lastSendTime = host->serviceTime;
+
+                datagram->peer        = &currentPeer;
+                datagram->bufferCount = host->bufferCount;
+                datagram->dataLength  = 0;
 
-                if (peer.incomingBandwidthThrottleEpoch == timeCurrent)
+                for (size_t i = 0; i < host->bufferCount; ++i)
                 {
-                    command.bandwidthLimit.incomingBandwidth =
-                        ENET_HOST_TO_NET_32(peer.outgoingBandwidth);
+                    datagram->dataLength += host->buffers[i].dataLength;
                 }
-                else
+
+                if (++host->sendDatagramCount >= host->sendDatagrams.size() &&
+                    enet_protocol_flush_datagrams(host) < 0)
                 {
-                    command.bandwidthLimit.incomingBandwidth = ENET_HOST_TO_NET_32(bandwidthLimit);
+                    return -1;
                 }
-
-                peer.queue_outgoing_command(&command, nullptr, 0, 0);
             }
         }
-    } /* enet_host_bandwidth_throttle */
 
-// =======================================================================//
-// !
-// ! Time
-// !
-// =======================================================================//
+        result = enet_protocol_flush_datagrams(host);
 
-    #ifdef _WIN32
-        static LARGE_INTEGER getFILETIMEoffset() {
-            SYSTEMTIME s;
-            FILETIME f;
-            LARGE_INTEGER t;
+        enet_protocol_prune_send_queue(host);
 
-            s.wYear = 1970;
-            s.wMonth = 1;
-            s.wDay = 1;
-            s.wHour = 0;
-            s.wMinute = 0;
-            s.wSecond = 0;
-            s.wMilliseconds = 0;
-            SystemTimeToFileTime(&s, &f);
-            t.QuadPart = f.dwHighDateTime;
-            t.QuadPart <<= 32;
-            t.QuadPart |= f.dwLowDateTime;
-            return (t);
-        }
+        return result;
+    } /* enet_protocol_send_outgoing_commands */
 
-        int clock_gettime(int X, struct timespec *tv) {
-            LARGE_INTEGER t;
-            FILETIME f;
-            double microseconds;
-            static LARGE_INTEGER offset;
-            static double frequencyToMicroseconds;
-            static int initialized = 0;
-            static BOOL usePerformanceCounter = 0;
+    /** Sends any queued packets on the host specified to its designated peers.
+     *
+     *  @param host   host to flush
+     *  @remarks this function need only be used in circumstances where one wishes to send queued packets earlier than in a call to enet_host_service().
+     *  @ingroup host
+     */
+    void ENetHost::flush()
+    {
+        this->update_time();
+        this->drain_submissions();
+        enet_protocol_send_outgoing_commands(this, nullptr, 0);
+    }
 
-            if (!initialized) {
-                LARGE_INTEGER performanceFrequency;
-                initialized = 1;
-                usePerformanceCounter = QueryPerformanceFrequency(&performanceFrequency);
-                if (usePerformanceCounter) {
-                    QueryPerformanceCounter(&offset);
-                    frequencyToMicroseconds = (double)performanceFrequency.QuadPart / 1000000.;
-                } else {
-                    offset = getFILETIMEoffset();
-                    frequencyToMicroseconds = 10.;
-                }
-            }
-            if (usePerformanceCounter) {
-                QueryPerformanceCounter(&t);
-            } else {
-                GetSystemTimeAsFileTime(&f);
-                t.QuadPart = f.dwHighDateTime;
-                t.QuadPart <<= 32;
-                t.QuadPart |= f.dwLowDateTime;
-            }
+    /** Queues a packet to be sent to a peer from any thread.
+     *
+     *  The packet is handed to ENetPeer::send() by the thread servicing the host during its next
+     *  service() or flush(). Producers only take a node from a lock-free free list and push it onto
+     *  a lock-free stack, so they never contend with the service thread or with each other beyond
+     *  a compare-and-swap, and only allocate once ENET_HOST_SUBMISSION_NODES submissions are pending.
+     *
+     *  The first submission after a drain sends an empty datagram to the host's own socket, which
+     *  wakes a service() or ENetReactor::service() blocked waiting for it; the protocol ignores it.
+     *
+     *  @param peer destination peer, owned by this host
+     *  @param channelID channel on which to send
+     *  @param packet packet to send; must not come from the host's packet pool, whose allocation
+     *  is not thread-safe, and must not be touched by the caller afterwards
+     *  @retval 0 on success
+     *  @retval < 0 on failure
+     *  @remarks the packet is destroyed instead of sent if, when the submission is drained, the peer
+     *  is not connected or its slot was reused by another connection since the submission.
+     */
+    int ENetHost::submit(ENetPeer *peer, enet_uint8 channelID, ENetPacket *packet)
+    {
+        /* a stale identifier only makes the drain drop the packet */
+        return this->submit(peer, channelID, packet, peer->connectID);
+    }
 
-            t.QuadPart -= offset.QuadPart;
-            microseconds = (double)t.QuadPart / frequencyToMicroseconds;
-            t.QuadPart = (LONGLONG)microseconds;
-            tv->tv_sec = (long)(t.QuadPart / 1000000);
-            tv->tv_nsec = t.QuadPart % 1000000 * 1000;
-            return (0);
+    /** Queues a packet to be sent from any thread to a peer, as long as it still holds a given connection.
+     *  @param peer destination peer, owned by this host, or nullptr to broadcast
+     *  @param connectID connection the packet is meant for, as reported by the peer's connect event
+     *  @remarks see submit(ENetPeer *, enet_uint8, ENetPacket *); unlike it, this never reads the peer.
+     */
+    int ENetHost::submit(ENetPeer *peer, enet_uint8 channelID, ENetPacket *packet, enet_uint32 connectID)
+    {
+        ENetSubmission *submission = nullptr, *head;
+        enet_uint64     top        = this->freeSubmissions.load(std::memory_order_acquire);
+
+        while ((top & 0xFFFFFFFF) != 0)
+        {
+            ENetSubmission *node = &this->submissionNodes[(top & 0xFFFFFFFF) - 1];
+            enet_uint64     next = (((top >> 32) + 1) << 32) | ENET_ATOMIC_READ(&node->nextFree);
+
+            if (this->freeSubmissions.compare_exchange_weak(top, next, std::memory_order_acquire,
+                                                            std::memory_order_acquire))
+            {
+                submission = node;
+                break;
+            }
         }
-    #elif __APPLE__ && __MAC_OS_X_VERSION_MIN_REQUIRED < 101200
-        #define CLOCK_MONOTONIC 0
 
-        int clock_gettime(int X, struct timespec *ts) {
-            clock_serv_t cclock;
-            mach_timespec_t mts;
+        if (submission == nullptr)
+        {
+            submission = (ENetSubmission *) enet_malloc(sizeof(ENetSubmission));
 
-            host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock);
-            clock_get_time(cclock, &mts);
-            mach_port_deallocate(mach_task_self(), cclock);
+            if (submission == nullptr)
+            {
+                return -1;
+            }
+        }
 
-            ts->tv_sec = mts.tv_sec;
-            ts->tv_nsec = mts.tv_nsec;
+        submission->connectID = connectID;
+        submission->peer      = peer;
+        submission->channelID = channelID;
+        submission->packet    = packet;
+        submission->next      = this->submissions.load(std::memory_order_relaxed);
+        head                  = submission->next;
 
-            return 0;
+        while (!this->submissions.compare_exchange_weak(head, submission, std::memory_order_release,
+                                                        std::memory_order_relaxed))
+        {
+            submission->next = head;
         }
-    #endif
 
-    enet_uint32 enet_time_get() {
-        // TODO enet uses 32 bit timestamps. We should modify it to use
-        // 64 bit timestamps, but this is not trivial since we'd end up
-        // changing half the structs in enet. For now, retain 32 bits, but
-        // use an offset so we don't run out of bits. Basically, the first
-        // call of enet_time_get() will always return 1, and follow-up calls
-        // indicate elapsed time since the first call.
+        /* the node may already be drained here, so only the previous head tells if the stack was empty */
+        if (head == nullptr)
+        {
+            this->wake();
+        }
+
+        return 0;
+    }
+
+    /** Queues a packet to be broadcast from any thread to the peers connected when it is drained.
+     *  @param channelID channel on which to broadcast
+     *  @param packet packet to broadcast, under the same rules as for submit()
+     *  @retval 0 on success
+     *  @retval < 0 on failure
+     */
+    int ENetHost::submit_broadcast(enet_uint8 channelID, ENetPacket *packet)
+    {
+        return this->submit(nullptr, channelID, packet, 0);
+    }
+
+    /** Makes a service() or ENetReactor::service() blocked on the host return to its loop, from any
+     *  thread, by sending an empty datagram to the host's own socket; the protocol ignores it.
+     */
+    void ENetHost::wake()
+    {
+        ENetAddress wakeAddress;
+
+        /* a client socket has no address until its first send, which nothing can be waiting for yet */
+        if (this->socket.get_address(&wakeAddress) < 0 || wakeAddress.port == 0)
+        {
+            return;
+        }
+
+        /* an unspecified address is reached through the IPv4 loopback, which the dual-stack socket accepts */
+        if (in6_equal(wakeAddress.host, ENET_HOST_ANY))
+        {
+            ((enet_uint32 *)&wakeAddress.host.s6_addr)[2] = htonl(0xffff);
+            ((enet_uint32 *)&wakeAddress.host.s6_addr)[3] = htonl(INADDR_LOOPBACK);
+        }
+
+        this->socket.send(&wakeAddress, nullptr, 0);
+    }
+
+    /** Returns a drained submission to the free list, or frees it if submit() had to allocate it. */
+    void ENetHost::release_submission(ENetSubmission *submission)
+    {
+        size_t      index = submission - this->submissionNodes.get();
+        enet_uint64 top, next;
+
+        if (this->submissionNodes == nullptr || submission < this->submissionNodes.get() ||
+            index >= ENET_HOST_SUBMISSION_NODES)
+        {
+            enet_free(submission);
+            return;
+        }
+
+        top = this->freeSubmissions.load(std::memory_order_relaxed);
+
+        do {
+            ENET_ATOMIC_WRITE(&submission->nextFree, (enet_uint32) (top & 0xFFFFFFFF));
+            next = (((top >> 32) + 1) << 32) | (enet_uint64) (index + 1);
+        } while (!this->freeSubmissions.compare_exchange_weak(top, next, std::memory_order_release,
+                                                              std::memory_order_relaxed));
+    }
+
+    /** Hands the packets submitted by other threads to their peers, in submission order. */
+    void ENetHost::drain_submissions()
+    {
+        ENetSubmission *submission, *ordered = nullptr;
+
+        if (this->submissions.load(std::memory_order_relaxed) == nullptr)
+        {
+            return;
+        }
+
+        submission = this->submissions.exchange(nullptr, std::memory_order_acquire);
+
+        while (submission != nullptr)
+        {
+            ENetSubmission *next = submission->next;
+
+            submission->next = ordered;
+            ordered          = submission;
+            submission       = next;
+        }
+
+        while (ordered != nullptr)
+        {
+            submission = ordered;
+            ordered    = ordered->next;
+
+            if (submission->peer == nullptr)
+            {
+                this->broadcast(submission->channelID, submission->packet);
+            }
+            else if (submission->peer->state != ENetPeerState::CONNECTED ||
+                submission->peer->connectID != submission->connectID ||
+                submission->peer->send(submission->channelID, submission->packet) < 0)
+            {
+                if (submission->packet->referenceCount == 0)
+                {
+                    enet_packet_destroy(submission->packet);
+                }
+            }
+
+            this->release_submission(submission);
+        }
+    }
+
+    /** Services the host like service(), but returns up to maximum events per call.
+     *
+     *  @param events  array where the details of the events that occurred are placed
+     *  @param maximum number of entries in events
+     *  @param timeout number of milliseconds to wait for the first event
+     *  @returns the number of events stored in events
+     *  @retval < 0 on failure
+     *  @remarks the host is only serviced when no events were already queued, as with a loop of
+     *  service() calls; a peer's received packets are returned back to back.
+     */
+    int ENetHost::service_many(ENetEvent *events, size_t maximum, enet_uint32 timeout)
+    {
+        size_t count;
+        int    result;
+
+        if (maximum == 0)
+        {
+            return 0;
+        }
+
+        count = enet_protocol_dispatch_incoming_events(this, events, maximum);
+        if (count > 0)
+        {
+            return (int) count;
+        }
+
+        result = this->service(events, timeout);
+        if (result <= 0)
+        {
+            return result;
+        }
+
+        return 1 + (int) enet_protocol_dispatch_incoming_events(this, events + 1, maximum - 1);
+    }
+
+    /** Checks for any queued events on the host and dispatches one if available.
+     *
+     *  @param host    host to check for events
+     *  @param event   an event structure where event details will be placed if available
+     *  @retval > 0 if an event was dispatched
+     *  @retval 0 if no events are available
+     *  @retval < 0 on failure
+     *  @ingroup host
+     */
+    bool ENetHost::check_events(ENetEvent &event)
+    {
+        event.type   = ENetEventType::NONE;
+        event.peer   = nullptr;
+        event.packet = nullptr;
+
+        return enet_protocol_dispatch_incoming_commands(this, event);
+    }
+
+    /** Waits for events on the host specified and shuttles packets between
+     *  the host and its peers.
+     *
+     *  @param host    host to service
+     *  @param event   an event structure where event details will be placed if one occurs
+     *                 if event == nullptr then no events will be delivered
+     *  @param timeout number of milliseconds that ENet should wait for events
+     *  @retval > 0 if an event occurred within the specified time limit
+     *  @retval 0 if no event occurred
+     *  @retval < 0 on failure
+     *  @remarks enet_host_service should be called fairly regularly for adequate performance
+     *  @ingroup host
+     */
+    int ENetHost::service(ENetEvent *event, enet_uint32 timeout)
+    {
+        enet_uint32 waitCondition;
+        enet_uint64 deadline;
+
+        if (event != nullptr && this->check_events(*event))
+        {
+            return 1;
+        }
+
+        deadline = this->update_time() + (enet_uint64) timeout * ENET_TIME_MILLISECOND;
+
+        do {
+            this->drain_submissions();
+
+            if (ENET_TIME_DIFFERENCE(this->serviceTime, this->bandwidthThrottleEpoch) >=
+                ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL * ENET_TIME_MILLISECOND)
+            {
+                this->bandwidth_throttle();
+            }
+
+            switch (enet_protocol_send_outgoing_commands(this, event, 1))
+            {
+            case 1:
+                return 1;
+
+            case -1:
+#ifdef ENET_DEBUG
+                perror("Error sending outgoing packets");
+#endif
+
+                return -1;
+
+            default:
+                break;
+            }
+
+            switch (enet_protocol_receive_incoming_commands(this, event))
+            {
+            case 1:
+                return 1;
+
+            case -1:
+#ifdef ENET_DEBUG
+                perror("Error receiving incoming packets");
+#endif
+
+                return -1;
+
+            default:
+                break;
+            }
+
+            switch (enet_protocol_send_outgoing_commands(this, event, 1))
+            {
+            case 1:
+                return 1;
+
+            case -1:
+#ifdef ENET_DEBUG
+                perror("Error sending outgoing packets");
+#endif
+
+                return -1;
+
+            default:
+                break;
+            }
+
+            if (event != nullptr && enet_protocol_dispatch_incoming_commands(this, *event))
+            {
+                return 1;
+            }
+
+            if (ENET_TIME_GREATER_EQUAL(this->serviceTime, deadline))
+            {
+                return 0;
+            }
+
+            do {
+                this->update_time();
+
+                if (ENET_TIME_GREATER_EQUAL(this->serviceTime, deadline))
+                {
+                    return 0;
+                }
+
+                waitCondition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
+                if (this->socket.wait(waitCondition, (enet_uint32) ((deadline - this->serviceTime + ENET_TIME_MILLISECOND - 1) /
+                                                                    ENET_TIME_MILLISECOND)) != 0)
+                {
+                    return -1;
+                }
+            } while (waitCondition & ENET_SOCKET_WAIT_INTERRUPT);
+
+            this->update_time();
+        } while (waitCondition & ENET_SOCKET_WAIT_RECEIVE);
+
+        return 0;
+    } /* enet_host_service */
+
+    // =======================================================================//
+    // !
+    // ! Peer
+    // !
+    // =======================================================================//
+
+    void *enet_packet_get_data(ENetPacket *packet) { return (void *)packet->data; }
+
+    enet_uint32 enet_packet_get_length(ENetPacket *packet) { return packet->dataLength; }
+
+    void enet_packet_set_free_callback(ENetPacket *packet, void *callback) {
+        packet->freeCallback = (ENetPacketFreeCallback)callback;
+    }
+
+    void enet_peer_reset_outgoing_commands(ENetHost *host, ENetList *queue)
+    {
+        ENetOutgoingCommand *outgoingCommand;
+
+        while (!enet_list_empty(queue)) {
+            outgoingCommand = (ENetOutgoingCommand *) enet_list_remove(enet_list_begin(queue));
+
+            if (outgoingCommand->packet != nullptr)
+            {
+                --outgoingCommand->packet->referenceCount;
+
+                if (outgoingCommand->packet->referenceCount == 0) {
+                    enet_packet_destroy(outgoingCommand->packet);
+                }
+            }
+
+            host->outgoingCommandPool.release(outgoingCommand);
+        }
+    }
+
+    void enet_peer_reset_outgoing_commands(ENetHost *host, std::list<ENetOutgoingCommand *> &queue)
+    {
+        ENetOutgoingCommand *outgoingCommand;
+
+        while (!queue.empty())
+        {
+            outgoingCommand = queue.front();
+            queue.pop_front();
+
+            if (outgoingCommand->packet != nullptr)
+            {
+                --outgoingCommand->packet->referenceCount;
+
+                if (outgoingCommand->packet->referenceCount == 0)
+                {
+                    enet_packet_destroy(outgoingCommand->packet);
+                }
+            }
+
+            host->outgoingCommandPool.release(outgoingCommand);
+        }
+    }
+
+    void enet_peer_free_incoming_command(ENetHost *host, ENetIncomingCommand *incomingCommand)
+    {
+        if (incomingCommand->fragments != nullptr && incomingCommand->fragments != incomingCommand->fragmentBitmap)
+        {
+            enet_free(incomingCommand->fragments);
+        }
+
+        host->incomingCommandPool.release(incomingCommand);
+    }
+
+    void enet_peer_remove_incoming_commands(ENetHost *host, [[maybe_unused]] ENetList *queue, ENetListIterator startCommand, ENetListIterator endCommand)
+    {
+
+        for (auto currentCommand = startCommand; currentCommand != endCommand;)
+        {
+            ENetIncomingCommand *incomingCommand = (ENetIncomingCommand *) currentCommand;
+
+            currentCommand = enet_list_next(currentCommand);
+            enet_list_remove(&incomingCommand->incomingCommandList);
+
+            if (incomingCommand->packet != nullptr)
+            {
+                --incomingCommand->packet->referenceCount;
+
+                if (incomingCommand->packet->referenceCount == 0) {
+                    enet_packet_destroy(incomingCommand->packet);
+                }
+            }
+
+            enet_peer_free_incoming_command(host, incomingCommand);
+        }
+    }
+
+    void enet_peer_reset_incoming_commands(ENetHost *host, ENetList *queue)
+    {
+        enet_peer_remove_incoming_commands(host, queue, enet_list_begin(queue), enet_list_end(queue));
+    }
+
+    void enet_peer_reset_incoming_commands(ENetHost *host, ENetSequenceIndex<ENetIncomingCommand> &queue)
+    {
+        /* erasing may move a later command into the current slot, so it is looked at again */
+        for (size_t i = 0; queue.count > 0;)
+        {
+            ENetIncomingCommand *incomingCommand = queue.slots[i];
+
+            if (incomingCommand == nullptr) {
+                ++i;
+                continue;
+            }
+
+            queue.erase(incomingCommand);
+
+            if (incomingCommand->packet != nullptr)
+            {
+                --incomingCommand->packet->referenceCount;
+
+                if (incomingCommand->packet->referenceCount == 0) {
+                    enet_packet_destroy(incomingCommand->packet);
+                }
+            }
+
+            enet_peer_free_incoming_command(host, incomingCommand);
+        }
+
+        queue.destroy();
+    }
+
+    // =======================================================================//
+    // !
+    // ! Host
+    // !
+    // =======================================================================//
+
+    /** Creates a host for communicating to peers.
+     *
+     *  @param address   the address at which other peers may connect to this host.  If nullptr,
+     * then no peers may connect to the host.
+     *  @param peerCount the maximum number of peers that should be allocated for the host.
+     *  @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to
+     * ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
+     *  @param incomingBandwidth downstream bandwidth of the host in bytes/second; if 0, ENet will
+     * assume unlimited bandwidth.
+     *  @param outgoingBandwidth upstream bandwidth of the host in bytes/second; if 0, ENet will
+     * assume unlimited bandwidth.
+     *  @param flags bitwise-or of ENetHostFlag constants
+     *
+     *  @remarks if the socket cannot be created, configured or bound, the host is left without peers
+     * and with a closed socket, which socket.is_null() reports; it must not be used any further.
+     *
+     *  @remarks ENet will strategically drop packets on specific sides of a connection between
+     * hosts to ensure the host's bandwidth is not overwhelmed.  The bandwidth parameters also
+     * determine the window size of a connection which limits the amount of reliable packets that
+     * may be in transit at any given time.
+     */
+    ENetHost::ENetHost(const ENetAddress *address, size_t peerCount, size_t channelLimit,
+                       enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth, enet_uint32 flags)
+    {
+        if (peerCount > ENET_PROTOCOL_MAXIMUM_PEER_ID) {
+            peerCount = ENET_PROTOCOL_MAXIMUM_PEER_ID;
+        }
+
+        this->peers.resize(peerCount);
+
+        if (!this->socket.is_null())
+        {
+            this->socket.set_option(ENET_SOCKOPT_IPV6_V6ONLY, 0);
+        }
+
+        if (this->socket.is_null() ||
+            ((flags & ENET_HOST_FLAG_REUSE_PORT) && this->socket.set_option(ENET_SOCKOPT_REUSEPORT, 1) < 0) ||
+            (address != nullptr && this->socket.bind(address) < 0))
+        {
+            this->peers.clear();
+            this->socket.close();
+
+            return;
+        }
+
+        this->socket.set_option(ENET_SOCKOPT_NONBLOCK, 1);
+        this->socket.set_option(ENET_SOCKOPT_BROADCAST, 1);
+        this->socket.set_option(ENET_SOCKOPT_RCVBUF, ENET_HOST_RECEIVE_BUFFER_SIZE);
+        this->socket.set_option(ENET_SOCKOPT_SNDBUF, ENET_HOST_SEND_BUFFER_SIZE);
+        this->socket.set_option(ENET_SOCKOPT_IPV6_V6ONLY, 0);
+
+        if (address != nullptr && this->socket.get_address(&this->address) < 0)
+        {
+            this->address = *address;
+        }
+
+        this->submissionNodes.reset(new ENetSubmission[ENET_HOST_SUBMISSION_NODES]);
+
+        for (size_t i = 0; i < ENET_HOST_SUBMISSION_NODES; ++i)
+        {
+            this->submissionNodes[i].nextFree = i + 1 < ENET_HOST_SUBMISSION_NODES ? (enet_uint32) (i + 2) : 0;
+        }
+
+        this->freeSubmissions.store(1, std::memory_order_relaxed);
+
+        if (!channelLimit || channelLimit > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
+            channelLimit = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
+        } else if (channelLimit < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT) {
+            channelLimit = ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT;
+        }
+
+        this->randomSeed = (enet_uint32)(size_t)this;
+        this->randomSeed += this->random_seed();
+        this->randomSeed                 = (this->randomSeed << 16) | (this->randomSeed >> 16);
+        this->channelLimit               = channelLimit;
+        this->incomingBandwidth          = incomingBandwidth;
+        this->outgoingBandwidth          = outgoingBandwidth;
+        this->peerCount                  = peerCount;
+        this->receivedAddress.host       = ENET_HOST_ANY;
+        this->receivedAddress.port       = 0;
+        this->compressor                 = {nullptr, nullptr, nullptr, nullptr};
+
+        this->set_receive_batch(ENET_HOST_DEFAULT_RECEIVE_BATCH_SIZE);
+        this->set_send_batch(ENET_HOST_DEFAULT_SEND_BATCH_SIZE);
+        this->packetPool = new ENetPacketPool();
+
+        this->dispatchQueue.reset(peerCount);
+
+        for (auto &currentPeer : this->peers)
+        {
+            currentPeer.host              = this;
+            currentPeer.incomingPeerID    = &currentPeer - &this->peers.front();
+            currentPeer.outgoingSessionID = currentPeer.incomingSessionID = 0xFF;
+            currentPeer.data                                              = nullptr;
+            currentPeer.timer.data                                        = &currentPeer;
+
+            currentPeer.acknowledgements.clear();
+            enet_list_clear(&currentPeer.sentReliableCommands);
+            currentPeer.sentUnreliableCommands.clear();
+            enet_list_clear(&currentPeer.outgoingReliableCommands);
+            enet_list_clear(&currentPeer.outgoingUnreliableCommands);
+            enet_list_clear(&currentPeer.dispatchedCommands);
+
+            currentPeer.reset();
+        }
+
+        this->freePeers.reserve(peerCount);
+
+        for (auto currentPeer = this->peers.rbegin(); currentPeer != this->peers.rend(); ++currentPeer)
+        {
+            this->freePeers.push_back(&*currentPeer);
+        }
+    } /* enet_host_create */
+
+    /** Destroys the host and all resources associated with it.
+     *  @param host pointer to the host to destroy
+     */
+    ENetHost::~ENetHost()
+    {
+        for (auto &currentPeer : this->peers)
+        {
+            currentPeer.reset();
+        }
+
+        this->drain_submissions();
+
+        if (this->packetPool != nullptr)
+        {
+            for (auto slab : this->receiveSlabs)
+            {
+                this->packetPool->release_slab(slab);
+            }
+
+            this->receiveSlabs.clear();
+            this->packetPool->unreference();
+            this->packetPool = nullptr;
+        }
+
+        if (this->compressor.context != nullptr && this->compressor.destroy != nullptr)
+        {
+            (*this->compressor.destroy)(this->compressor.context);
+        }
+    }
+
+    /** Initiates a connection to a foreign host.
+     *  @param host host seeking the connection
+     *  @param address destination for the connection
+     *  @param channelCount number of channels to allocate
+     *  @param data user data supplied to the receiving host
+     *  @returns a peer representing the foreign host on success, nullptr on failure
+     *  @remarks The peer returned will have not completed the connection until enet_host_service()
+     *  notifies of an ENetEventType::CONNECT event for the peer.
+     */
+    ENetPeer *ENetHost::connect(const ENetAddress *address, size_t channelCount, enet_uint32 data)
+    {
+        ENetProtocol command;
+
+        if (channelCount < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT) {
+            channelCount = ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT;
+        } else if (channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
+            channelCount = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
+        }
+
+        if (this->freePeers.empty())
+        {
+            return nullptr;
+        }
+
+        ENetPeer *currentPeer = this->freePeers.back();
+
+        currentPeer->channels = (ENetChannel *) enet_malloc(channelCount * sizeof(ENetChannel));
+        if (currentPeer->channels == nullptr)
+        {
+            return nullptr;
+        }
+
+        this->acquire_peer(currentPeer);
+
+        currentPeer->channelCount = channelCount;
+        currentPeer->state        = ENetPeerState::CONNECTING;
+        currentPeer->address      = *address;
+        currentPeer->connectID    = ++this->randomSeed;
+
+        if (this->outgoingBandwidth == 0)
+        {
+            currentPeer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+        }
+        else
+        {
+            currentPeer->windowSize = (this->outgoingBandwidth / ENET_PEER_WINDOW_SIZE_SCALE) *
+                                      ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        }
+
+        if (currentPeer->windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE) {
+            currentPeer->windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
+        } else if (currentPeer->windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE) {
+            currentPeer->windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+        }
+
+        for (auto channel = currentPeer->channels; channel < &currentPeer->channels[channelCount];
+             ++channel)
+        {
+            channel->outgoingReliableSequenceNumber   = 0;
+            channel->outgoingUnreliableSequenceNumber = 0;
+            channel->incomingReliableSequenceNumber   = 0;
+            channel->incomingUnreliableSequenceNumber = 0;
+
+            enet_list_clear(&channel->incomingUnreliableCommands);
+
+            channel->usedReliableWindows      = 0;
+            channel->reliableWindows          = {0};
+            channel->sentReliableCommands     = {};
+            channel->incomingReliableCommands = {};
+        }
+
+        command.header.command                     = ENET_PROTOCOL_COMMAND_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+        command.header.channelID                   = 0xFF;
+        command.connect.outgoingPeerID             = ENET_HOST_TO_NET_16(currentPeer->incomingPeerID);
+        command.connect.incomingSessionID          = enet_protocol_encode_session(currentPeer->incomingSessionID, this->capabilities);
+        command.connect.outgoingSessionID          = currentPeer->outgoingSessionID;
+        command.connect.mtu                        = ENET_HOST_TO_NET_32(currentPeer->mtu);
+        command.connect.windowSize                 = ENET_HOST_TO_NET_32(currentPeer->windowSize);
+        command.connect.channelCount               = ENET_HOST_TO_NET_32(channelCount);
+        command.connect.incomingBandwidth          = ENET_HOST_TO_NET_32(this->incomingBandwidth);
+        command.connect.outgoingBandwidth          = ENET_HOST_TO_NET_32(this->outgoingBandwidth);
+        command.connect.packetThrottleInterval     = ENET_HOST_TO_NET_32(currentPeer->packetThrottleInterval);
+        command.connect.packetThrottleAcceleration = ENET_HOST_TO_NET_32(currentPeer->packetThrottleAcceleration);
+        command.connect.packetThrottleDeceleration = ENET_HOST_TO_NET_32(currentPeer->packetThrottleDeceleration);
+        command.connect.connectID                  = currentPeer->connectID;
+        command.connect.data                       = ENET_HOST_TO_NET_32(data);
+
+        currentPeer->queue_outgoing_command(&command, nullptr, 0, 0);
+
+        return currentPeer;
+    } /* enet_host_connect */
+
+    /** Queues a packet to be sent to all peers associated with the host.
+     *  @param host host on which to broadcast the packet
+     *  @param channelID channel on which to broadcast
+     *  @param packet packet to broadcast
+     */
+    void ENetHost::broadcast(enet_uint8 channelID, ENetPacket *packet)
+    {
+
+        for (auto currentPeer : this->activePeers)
+        {
+            if (currentPeer->state != ENetPeerState::CONNECTED)
+            {
+                continue;
+            }
+
+            currentPeer->send(channelID, packet);
+        }
+
+        if (packet->referenceCount == 0) {
+            enet_packet_destroy(packet);
+        }
+    }
+
+    /** Creates a packet whose storage comes from the host's packet pool.
+     *  @param data initial contents of the packet's data, may be nullptr
+     *  @param dataLength size of the data allocated for this packet
+     *  @param flags flags for this packet as described for the ENetPacket structure
+     *  @returns the packet on success, nullptr on failure
+     *  @remarks the packet is destroyed with enet_packet_destroy and may outlive the host.
+     */
+    ENetPacket *ENetHost::create_packet(const void *data, size_t dataLength, enet_uint32 flags)
+    {
+        return enet_packet_create_pooled(this->packetPool, data, dataLength, flags);
+    }
+
+    /** Creates a packet for data received by the host. With zero-copy receive enabled, data lying in
+     *  the slab of the datagram being handled is not copied: the packet points into the slab and
+     *  keeps it from being reused until the packet is destroyed.
+     *  @param data contents of the packet, may be nullptr
+     *  @param dataLength length of the contents
+     *  @param flags flags for this packet as described for the ENetPacket structure
+     *  @returns the packet on success, nullptr on failure
+     */
+    ENetPacket *ENetHost::create_received_packet(const void *data, size_t dataLength, enet_uint32 flags)
+    {
+        ENetReceiveSlab *slab = this->receivedSlab;
+        ENetPacket *     packet;
+
+        if (slab == nullptr || data == nullptr || (const enet_uint8 *) data < slab->data() ||
+            (const enet_uint8 *) data + dataLength > slab->data() + slab->size)
+        {
+            return this->create_packet(data, dataLength, flags);
+        }
+
+        packet = this->packetPool->allocate(0);
+        if (packet == nullptr) {
+            return nullptr;
+        }
+
+        packet->referenceCount = 0;
+        packet->flags          = flags;
+        packet->data           = (enet_uint8 *) data;
+        packet->dataLength     = dataLength;
+        packet->freeCallback   = nullptr;
+        packet->userData       = nullptr;
+        packet->slab           = slab;
+        ++slab->references;
+
+        return packet;
+    }
+
+    /** Sends raw data to specified address. Useful when you want to send unconnected data using host's socket.         
+     *  @param host host sending data
+     *  @param address destination address
+     *  @param data data pointer
+     *  @param dataLength length of data to send
+     *  @retval >=0 bytes sent
+     *  @retval <0 error
+     *  @sa enet_socket_send
+     */
+    int ENetHost::send_raw(const ENetAddress *address, enet_uint8 *data, size_t dataLength)
+    {
+        ENetBuffer buffer;
+        buffer.data = data;
+        buffer.dataLength = dataLength;
+        return this->socket.send(address, &buffer, 1);
+    }
+
+    /** Sends raw data to specified address with extended arguments. Allows to send only part of data, handy for other programming languages.
+     *  I.e. if you have data =- { 0, 1, 2, 3 } and call function as enet_host_send_raw_ex(data, 1, 2) then it will skip 1 byte and send 2 bytes { 1, 2 }.
+     *  @param host host sending data
+     *  @param address destination address
+     *  @param data data pointer
+     *  @param skipBytes number of bytes to skip from start of data
+     *  @param bytesToSend number of bytes to send
+     *  @retval >=0 bytes sent
+     *  @retval <0 error
+     *  @sa enet_socket_send
+     */
+    int ENetHost::send_raw_ex(const ENetAddress *address, enet_uint8 *data, size_t skipBytes,
+                              size_t bytesToSend)
+    {
+        ENetBuffer buffer;
+        buffer.data = data + skipBytes;
+        buffer.dataLength = bytesToSend;
+        return this->socket.send(address, &buffer, 1);
+    }
+
+    /** Sets intercept callback for the host.
+     *  @param host host to set a callback
+     *  @param callback intercept callback
+     */
+    void ENetHost::set_intercept(const ENetInterceptCallback callback)
+    {
+        this->intercept = callback;
+    }
+
+    /** Sets the clock the host reads its service time from, such as a virtual clock in tests and benchmarks.
+     *  @param callback returns the current time in microseconds; nullptr restores enet_time_get_us()
+     *  @param context passed to callback
+     *  @remarks set the clock before peers connect: deadlines already scheduled stay on the old one.
+     */
+    void ENetHost::set_time_source(const ENetTimeSourceCallback callback, void *context)
+    {
+        this->timeSource        = callback;
+        this->timeSourceContext = context;
+
+        this->update_time();
+
+        if (this->timers.timerCount == 0)
+        {
+            this->timers.time = this->serviceTime / ENET_TIME_MILLISECOND;
+        }
+    }
+
+    /** Reads the host's clock once into serviceTime, which the following stage of the service
+     *  loop then uses instead of reading the clock again.
+     *  @returns the new service time
+     */
+    enet_uint64 ENetHost::update_time()
+    {
+        this->serviceTime = this->timeSource != nullptr ? this->timeSource(this->timeSourceContext) : enet_time_get_us();
+
+        return this->serviceTime;
+    }
+
+    /** Sets the packet compressor the host should use to compress and decompress packets.
+     *  @param host host to enable or disable compression for
+     *  @param compressor callbacks for for the packet compressor; if nullptr, then compression is
+     * disabled
+     */
+    void ENetHost::compress(const ENetCompressor *compressor)
+    {
+        if (this->compressor.context != nullptr && this->compressor.destroy)
+        {
+            (*this->compressor.destroy)(this->compressor.context);
+        }
+
+        if (compressor) {
+            this->compressor = *compressor;
+        } else {
+            this->compressor.context = nullptr;
+        }
+    }
+
+    /** Sets the packet compressor to the built-in LZ compressor.
+     *  @param dictionary preset dictionary, typically a representative datagram; may be nullptr
+     *  @param dictionaryLength length of the dictionary, at most ENET_LZ_DICTIONARY_MAXIMUM bytes are used
+     *  @retval 0 on success
+     *  @retval < 0 on failure
+     *  @remarks the remote host must use the same dictionary.
+     */
+    int ENetHost::compress_with_lz(const void *dictionary, size_t dictionaryLength)
+    {
+        ENetCompressor compressor;
+
+        compressor.context = enet_lz_create(dictionary, dictionaryLength);
+        if (compressor.context == nullptr)
+        {
+            return -1;
+        }
+
+        compressor.compress   = enet_lz_compress;
+        compressor.decompress = enet_lz_decompress;
+        compressor.destroy    = enet_lz_destroy;
+        this->compress(&compressor);
+
+        return 0;
+    }
+
+    /** Limits the maximum allowed channels of future incoming connections.
+     *  @param host host to limit
+     *  @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
+     */
+    void ENetHost::channel_limit(size_t channelLimit)
+    {
+        if (!channelLimit || channelLimit > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
+            channelLimit = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
+        } else if (channelLimit < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT) {
+            channelLimit = ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT;
+        }
+
+        this->channelLimit = channelLimit;
+    }
+
+    /** Sets how many datagrams the host fetches from its socket with a single system call.
+     *  @param host host to adjust
+     *  @param batchSize number of datagrams received per call; if 0, then this is equivalent to
+     * ENET_HOST_DEFAULT_RECEIVE_BATCH_SIZE, and it is limited to ENET_MESSAGE_MAXIMUM
+     *  @retval 0 on success
+     *  @retval < 0 if datagrams of the previous batch are still waiting to be handled
+     *  @remarks each datagram of the batch reserves ENET_PROTOCOL_MAXIMUM_MTU bytes of storage.
+     */
+    int ENetHost::set_receive_batch(size_t batchSize)
+    {
+        size_t slotSize;
+
+        if (this->receiveMessageIndex < this->receiveMessageCount) {
+            return -1;
+        }
+
+        if (!batchSize) {
+            batchSize = ENET_HOST_DEFAULT_RECEIVE_BATCH_SIZE;
+        } else if (batchSize > ENET_MESSAGE_MAXIMUM) {
+            batchSize = ENET_MESSAGE_MAXIMUM;
+        }
+
+        slotSize = this->coalescedReceives ? (size_t) ENET_HOST_SEGMENT_RECEIVE_BUFFER_SIZE : (size_t) ENET_PROTOCOL_MAXIMUM_MTU;
+
+        for (auto slab : this->receiveSlabs)
+        {
+            this->packetPool->release_slab(slab);
+        }
+
+        this->receiveSlabs.clear();
+        this->receivedSlab = nullptr;
+
+        if (this->zeroCopyReceives)
+        {
+            this->receiveData.clear();
+            this->receiveSlabs.reserve(batchSize);
+
+            for (size_t i = 0; i < batchSize; ++i)
+            {
+                ENetReceiveSlab *slab = this->packetPool->acquire_slab(slotSize);
+
+                if (slab == nullptr) {
+                    return -1;
+                }
+
+                this->receiveSlabs.push_back(slab);
+            }
+        }
+        else
+        {
+            this->receiveData.resize(batchSize * slotSize);
+        }
+
+        this->receiveBuffers.resize(batchSize);
+        this->receiveMessages.resize(batchSize);
+
+        for (size_t i = 0; i < batchSize; ++i)
+        {
+            this->receiveBuffers[i].data        = this->zeroCopyReceives ? this->receiveSlabs[i]->data() : &this->receiveData[i * slotSize];
+            this->receiveBuffers[i].dataLength  = slotSize;
+            this->receiveMessages[i].buffers     = &this->receiveBuffers[i];
+            this->receiveMessages[i].bufferCount = 1;
+            this->receiveMessages[i].dataLength  = 0;
+            this->receiveMessages[i].segmentSize = 0;
+        }
+
+        this->receiveMessageIndex  = 0;
+        this->receiveMessageCount  = 0;
+        this->receiveSegmentOffset = 0;
+
+        return 0;
+    }
+
+    /** Sets how many datagrams a send pass stages before handing them to the socket with a single
+     * system call.
+     *  @param host host to adjust
+     *  @param batchSize number of datagrams sent per call; if 0, then this is equivalent to
+     * ENET_HOST_DEFAULT_SEND_BATCH_SIZE, and it is limited to ENET_MESSAGE_MAXIMUM
+     *  @retval 0 on success
+     *  @retval < 0 if called while a send pass is staging datagrams
+     */
+    int ENetHost::set_send_batch(size_t batchSize)
+    {
+        if (this->sendDatagramCount > 0) {
+            return -1;
+        }
+
+        if (!batchSize) {
+            batchSize = ENET_HOST_DEFAULT_SEND_BATCH_SIZE;
+        } else if (batchSize > ENET_MESSAGE_MAXIMUM) {
+            batchSize = ENET_MESSAGE_MAXIMUM;
+        }
+
+        this->sendDatagrams.resize(batchSize);
+        this->sendMessages.resize(batchSize);
+        this->sendSegmentBuffers.resize(this->segmentedSends ? batchSize * ENET_BUFFER_MAXIMUM : 0);
+
+        this->commands = this->sendDatagrams.front().commands;
+        this->buffers  = this->sendDatagrams.front().buffers;
+
+        return 0;
+    }
+
+    /** Enables or disables UDP segmentation offload for the host's socket. When enabled, datagrams
+     * staged for the same peer within a send batch (see set_send_batch()) are handed to the kernel
+     * as a single train, and trains coalesced by the kernel on receive are split back into
+     * datagrams. Only useful with a send batch larger than one.
+     *  @param host host to adjust
+     *  @param enable non-zero to enable segmentation offload
+     *  @retval 0 on success
+     *  @retval < 0 if the socket does not support UDP_SEGMENT and UDP_GRO, or datagrams are pending
+     *  @remarks if the route to a peer refuses a train, the host falls back to sending single datagrams.
+     *  With the io_uring backend the ring is rebuilt for the new buffer sizes, see set_io_uring().
+     */
+    int ENetHost::set_segmentation_offload(int enable)
+    {
+        if (this->sendDatagramCount > 0 || this->receiveMessageIndex < this->receiveMessageCount) {
+            return -1;
+        }
+
+        if (enable &&
+            (this->socket.set_option(ENET_SOCKOPT_UDP_SEGMENT, 0) < 0 ||
+             this->socket.set_option(ENET_SOCKOPT_UDP_GRO, 1) < 0))
+        {
+            return -1;
+        }
+
+        if (!enable) {
+            this->socket.set_option(ENET_SOCKOPT_UDP_GRO, 0);
+        }
+
+        this->segmentedSends    = enable ? 1 : 0;
+        this->coalescedReceives = enable ? 1 : 0;
+
+        this->set_send_batch(this->sendDatagrams.size());
+
+    #ifdef ENET_HAS_IO_URING
+        /* the provided buffers are sized either for single datagrams or for trains */
+        if (this->socket.uring != nullptr) {
+            return this->set_io_uring(1);
+        }
+    #endif
+
+        return this->set_receive_batch(this->receiveMessages.size());
+    }
+
+    /** Enables or disables zero-copy receive. When enabled, each datagram is received into its own
+     * slab and the packets delivered for unfragmented, uncompressed messages point into it instead
+     * of holding a copy, so they need neither a copy nor a heap allocation.
+     *  @param host host to adjust
+     *  @param enable non-zero to enable zero-copy receive
+     *  @retval 0 on success
+     *  @retval < 0 if datagrams are pending, the slabs could not be allocated or the io_uring backend is enabled
+     *  @remarks a slab is not reused while any packet pointing into it is alive, so holding on to
+     * received packets holds on to whole datagrams, up to ENET_HOST_SEGMENT_RECEIVE_BUFFER_SIZE
+     * bytes each with segmentation offload. Enabling it sets ENetPacketPool::concurrentRelease,
+     * which must stay set while zero-copy packets are alive.
+     */
+    int ENetHost::set_zero_copy_receive(int enable)
+    {
+        if (this->receiveMessageIndex < this->receiveMessageCount || this->packetPool == nullptr) {
+            return -1;
+        }
+
+    #ifdef ENET_HAS_IO_URING
+        if (enable && this->socket.uring != nullptr) {
+            return -1;
+        }
+    #endif
+
+        /* slab references are not atomic, so packets destroyed on other threads must go through
+         * the returned stack and release their slab when the host's thread reclaims them */
+        if (enable) {
+            this->packetPool->concurrentRelease = true;
+        }
+
+        this->zeroCopyReceives = enable ? 1 : 0;
+
+        if (this->set_receive_batch(this->receiveMessages.size()) < 0)
+        {
+            this->zeroCopyReceives = 0;
+            this->set_receive_batch(this->receiveMessages.size());
+            return -1;
+        }
+
+        return 0;
+    }
+
+    /** Moves the host's datagrams through io_uring instead of recvmmsg and sendmmsg. Datagrams are
+     * received by a multishot recvmsg into buffers provided to the kernel up front and reaped from
+     * the completion queue, and the datagrams of a send pass are submitted with one io_uring_enter.
+     *  @param host host to adjust
+     *  @param enable non-zero to enable the io_uring backend
+     *  @retval 0 on success
+     *  @retval < 0 if io_uring or multishot recvmsg is not available, zero-copy receive is enabled,
+     *  or datagrams are pending; the host then keeps using recvmmsg and sendmmsg
+     *  @remarks enable it before adding the host to an ENetReactor, which waits on the ring then.
+     *  Enabling, disabling or rebuilding the ring, which set_segmentation_offload() also does while
+     *  it is enabled, changes ENetSocket::wait_handle(), so a host already added to a reactor must
+     *  be removed before and added again afterwards.
+     */
+    int ENetHost::set_io_uring(int enable)
+    {
+        if (this->sendDatagramCount > 0 || this->receiveMessageIndex < this->receiveMessageCount) {
+            return -1;
+        }
+
+    #ifdef ENET_HAS_IO_URING
+        if (enable && this->zeroCopyReceives) {
+            return -1;
+        }
+
+        this->socket.uring.reset();
+
+        if (enable)
+        {
+            auto uring = std::make_unique<ENetUring>();
+
+            if (uring->open(this->socket.m_socket,
+                            this->coalescedReceives ? ENET_HOST_URING_SEGMENT_BUFFERS : ENET_HOST_URING_RECEIVE_BUFFERS,
+                            this->coalescedReceives ? (size_t) ENET_HOST_SEGMENT_RECEIVE_BUFFER_SIZE : (size_t) ENET_PROTOCOL_MAXIMUM_MTU,
+                            this->coalescedReceives ? CMSG_SPACE(sizeof(int)) : 0) < 0)
+            {
+                /* a previous ring is gone already, and the receive messages still point into it */
+                this->set_receive_batch(this->receiveMessages.size());
+                return -1;
+            }
+
+            this->socket.uring = std::move(uring);
+        }
+
+        /* the backend points the receive messages at its own buffers, so give them back theirs */
+        return this->set_receive_batch(this->receiveMessages.size());
+    #else
+        return enable ? -1 : 0;
+    #endif
+    }
+
+    /** Swaps the receive slabs still pinned by packets of the previous batch for unused ones.
+     *  @retval 0 on success
+     *  @retval < 0 if memory is exhausted
+     */
+    int ENetHost::renew_receive_slabs()
+    {
+        for (size_t i = 0; i < this->receiveMessageCount; ++i)
+        {
+            ENetReceiveSlab *slab = this->receiveSlabs[i];
+
+            if (slab->references == 1) {
+                continue;
+            }
+
+            slab = this->packetPool->acquire_slab(slab->size);
+            if (slab == nullptr) {
+                return -1;
+            }
+
+            this->packetPool->release_slab(this->receiveSlabs[i]);
+            this->receiveSlabs[i]        = slab;
+            this->receiveBuffers[i].data = slab->data();
+        }
+
+        this->receivedSlab = nullptr;
+
+        return 0;
+    }
+
+    /** Moves the peer at the back of the free peers to the active peers. */
+    void ENetHost::acquire_peer(ENetPeer *peer)
+    {
+        assert(!this->freePeers.empty() && this->freePeers.back() == peer);
+
+        this->freePeers.pop_back();
+
+        peer->activeIndex = (enet_uint16) this->activePeers.size();
+        this->activePeers.push_back(peer);
+    }
+
+    /** Schedules the peer's next retransmission timeout, or its next ping while nothing is in flight.
+     *  @remarks a deadline that moves later only makes the peer visit the send pass early, so only
+     *  changes that can bring it forward need to reschedule.
+     */
+    void ENetHost::schedule_peer(ENetPeer *peer)
+    {
+        if (peer->state == ENetPeerState::DISCONNECTED || peer->state == ENetPeerState::ZOMBIE)
+        {
+            this->timers.cancel(&peer->timer);
+            return;
+        }
+
+        this->timers.schedule(&peer->timer, enet_list_empty(&peer->sentReliableCommands)
+                                                ? peer->lastReceiveTime + (enet_uint64) peer->pingInterval * ENET_TIME_MILLISECOND
+                                                : peer->nextTimeout);
+    }
+
+    /** Returns the service time by which the host needs to be serviced again: its current service
+     *  time if work is already queued or received datagrams are still unprocessed, otherwise its
+     *  earliest retransmission, ping or bandwidth throttle deadline.
+     *  @returns ~0 if nothing is scheduled
+     */
+    enet_uint64 ENetHost::next_deadline()
+    {
+        enet_uint64 deadline = this->timers.next_deadline();
+
+        if (!this->sendQueue.empty() || !this->dispatchQueue.empty() ||
+            this->submissions.load(std::memory_order_relaxed) != nullptr ||
+            this->receiveMessageIndex < this->receiveMessageCount || this->receiveSegmentOffset != 0)
+        {
+            return this->serviceTime;
+        }
+
+    #ifdef ENET_HAS_IO_URING
+        if (this->socket.uring != nullptr && this->socket.uring->pending())
+        {
+            return this->serviceTime;
+        }
+    #endif
+
+        if (this->incomingBandwidth != 0 || this->outgoingBandwidth != 0)
+        {
+            deadline = std::min(deadline, this->bandwidthThrottleEpoch + ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL * ENET_TIME_MILLISECOND);
+        }
+
+        return deadline;
+    }
+
+    /** Adds a peer that is no longer disconnected or connecting to the host's connection index. */
+    void ENetHost::index_peer(ENetPeer *peer)
+    {
+        ENetPeerKey key = { peer->address.host, peer->address.port, peer->connectID };
+
+        this->peerIndex.emplace(key, peer);
+        ++this->peerAddressCounts[peer->address.host];
+    }
+
+    /** Returns a peer that is being reset to the free peers, dropping it from the active peers and the connection index.
+     *  @remarks called before the peer's state, address and connect ID are cleared.
+     */
+    void ENetHost::release_peer(ENetPeer *peer)
+    {
+        if (peer->state != ENetPeerState::CONNECTING)
+        {
+            ENetPeerKey key = { peer->address.host, peer->address.port, peer->connectID };
+            auto range = this->peerIndex.equal_range(key);
+
+            for (auto entry = range.first; entry != range.second; ++entry)
+            {
+                if (entry->second == peer)
+                {
+                    this->peerIndex.erase(entry);
+                    break;
+                }
+            }
+
+            auto count = this->peerAddressCounts.find(peer->address.host);
+
+            if (count != this->peerAddressCounts.end() && --count->second == 0) {
+                this->peerAddressCounts.erase(count);
+            }
+        }
+
+        this->timers.cancel(&peer->timer);
+
+        this->activePeers[peer->activeIndex] = this->activePeers.back();
+        this->activePeers[peer->activeIndex]->activeIndex = peer->activeIndex;
+        this->activePeers.pop_back();
+
+        this->freePeers.push_back(peer);
+    }
+
+    /** Adjusts the bandwidth limits of a host.
+     *  @param host host to adjust
+     *  @param incomingBandwidth new incoming bandwidth
+     *  @param outgoingBandwidth new outgoing bandwidth
+     *  @remarks the incoming and outgoing bandwidth parameters are identical in function to those
+     *  specified in enet_host_create().
+     */
+    void ENetHost::bandwidth_limit(enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+    {
+        this->incomingBandwidth          = incomingBandwidth;
+        this->outgoingBandwidth          = outgoingBandwidth;
+        this->recalculateBandwidthLimits = 1;
+    }
+
+    void ENetHost::bandwidth_throttle()
+    {
+        enet_uint64 timeCurrent       = this->serviceTime;
+        enet_uint32 elapsedTime       = (enet_uint32) ((timeCurrent - this->bandwidthThrottleEpoch) / ENET_TIME_MILLISECOND);
+        enet_uint32 peersRemaining    = (enet_uint32)this->connectedPeers;
+        enet_uint32 dataTotal         = ~0;
+        enet_uint32 bandwidth         = ~0;
+        enet_uint32 throttle          = 0;
+        enet_uint32 bandwidthLimit    = 0;
+
+        int          needsAdjustment = this->bandwidthLimitedPeers > 0 ? 1 : 0;
+        ENetProtocol command;
+
+        if (elapsedTime < ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL) {
+            return;
+        }
+
+        if (this->outgoingBandwidth == 0 && this->incomingBandwidth == 0)
+        {
+            return;
+        }
+
+        this->bandwidthThrottleEpoch = timeCurrent;
+
+        if (peersRemaining == 0) {
+            return;
+        }
+
+        if (this->outgoingBandwidth != 0)
+        {
+            dataTotal = 0;
+            bandwidth = (this->outgoingBandwidth * elapsedTime) / 1000;
+
+            for (auto peer : this->activePeers)
+            {
+                if (peer->state != ENetPeerState::CONNECTED &&
+                    peer->state != ENetPeerState::DISCONNECT_LATER)
+                {
+                    continue;
+                }
+
+                dataTotal += peer->outgoingDataTotal;
+            }
+        }
+
+        while (peersRemaining > 0 && needsAdjustment != 0) {
+            needsAdjustment = 0;
+
+            if (dataTotal <= bandwidth) {
+                throttle = ENET_PEER_PACKET_THROTTLE_SCALE;
+            } else {
+                throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
+            }
+
+            for (auto peer : this->activePeers)
+            {
+                enet_uint32 peerBandwidth;
+
+                if ((peer->state != ENetPeerState::CONNECTED &&
+                     peer->state != ENetPeerState::DISCONNECT_LATER) ||
+                    peer->incomingBandwidth == 0 ||
+                    peer->outgoingBandwidthThrottleEpoch == timeCurrent)
+                {
+                    continue;
+                }
+
+                peerBandwidth = (peer->incomingBandwidth * elapsedTime) / 1000;
+                if ((throttle * peer->outgoingDataTotal) / ENET_PEER_PACKET_THROTTLE_SCALE <=
+                    peerBandwidth)
+                {
+                    continue;
+                }
+
+                peer->packetThrottleLimit =
+                    (peerBandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / peer->outgoingDataTotal;
+
+                if (peer->packetThrottleLimit == 0)
+                {
+                    peer->packetThrottleLimit = 1;
+                }
+
+                if (peer->packetThrottle > peer->packetThrottleLimit)
+                {
+                    peer->packetThrottle = peer->packetThrottleLimit;
+                }
+
+                peer->outgoingBandwidthThrottleEpoch = timeCurrent;
+
+                peer->incomingDataTotal = 0;
+                peer->outgoingDataTotal = 0;
+
+                needsAdjustment = 1;
+                --peersRemaining;
+                bandwidth -= peerBandwidth;
+                dataTotal -= peerBandwidth;
+            }
+        }
+
+        if (peersRemaining > 0) {
+            if (dataTotal <= bandwidth) {
+                throttle = ENET_PEER_PACKET_THROTTLE_SCALE;
+            } else {
+                throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
+            }
+
+            for (auto peer : this->activePeers)
+            {
+                if ((peer->state != ENetPeerState::CONNECTED &&
+                     peer->state != ENetPeerState::DISCONNECT_LATER) ||
+                    peer->outgoingBandwidthThrottleEpoch == timeCurrent)
+                {
+                    continue;
+                }
+
+                peer->packetThrottleLimit = throttle;
+
+                if (peer->packetThrottle > peer->packetThrottleLimit)
+                {
+                    peer->packetThrottle = peer->packetThrottleLimit;
+                }
+
+                peer->incomingDataTotal = 0;
+                peer->outgoingDataTotal = 0;
+            }
+        }
+
+        if (this->recalculateBandwidthLimits)
+        {
+            this->recalculateBandwidthLimits = 0;
+
+            peersRemaining  = (enet_uint32)this->connectedPeers;
+            bandwidth       = this->incomingBandwidth;
+            needsAdjustment = 1;
+
+            if (bandwidth == 0) {
+                bandwidthLimit = 0;
+            } else {
+                while (peersRemaining > 0 && needsAdjustment != 0) {
+                    needsAdjustment = 0;
+                    bandwidthLimit  = bandwidth / peersRemaining;
+
+                    for (auto peer : this->activePeers)
+                    {
+                        if ((peer->state != ENetPeerState::CONNECTED &&
+                             peer->state != ENetPeerState::DISCONNECT_LATER) ||
+                            peer->incomingBandwidthThrottleEpoch == timeCurrent)
+                        {
+                            continue;
+                        }
+
+                        if (peer->outgoingBandwidth > 0 && peer->outgoingBandwidth >= bandwidthLimit)
+                        {
+                            continue;
+                        }
+
+                        peer->incomingBandwidthThrottleEpoch = timeCurrent;
+
+                        needsAdjustment = 1;
+                        --peersRemaining;
+                        bandwidth -= peer->outgoingBandwidth;
+                    }
+                }
+            }
+
+            for (auto peer : this->activePeers)
+            {
+                if (peer->state != ENetPeerState::CONNECTED &&
+                    peer->state != ENetPeerState::DISCONNECT_LATER)
+                {
+                    continue;
+                }
+
+                command.header.command   = ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+                command.header.channelID = 0xFF;
+                command.bandwidthLimit.outgoingBandwidth =
+                    ENET_HOST_TO_NET_32(this->outgoingBandwidth);
+
+                if (peer->incomingBandwidthThrottleEpoch == timeCurrent)
+                {
+                    command.bandwidthLimit.incomingBandwidth =
+                        ENET_HOST_TO_NET_32(peer->outgoingBandwidth);
+                }
+                else
+                {
+                    command.bandwidthLimit.incomingBandwidth = ENET_HOST_TO_NET_32(bandwidthLimit);
+                }
+
+                peer->queue_outgoing_command(&command, nullptr, 0, 0);
+            }
+        }
+    } /* enet_host_bandwidth_throttle */
+
+// =======================================================================//
+// !
+// ! Event ring
+// !
+// =======================================================================//
+
+    ENetEventRing::ENetEventRing(size_t capacity)
+    {
+        size_t size = 2;
+
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        this->cells.reset(new Cell[size]);
+        this->mask = size - 1;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            this->cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /** @retval false if the ring is full */
+    bool ENetEventRing::push(const ENetEvent &event)
+    {
+        size_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+        Cell * cell;
+
+        for (;;)
+        {
+            cell = &this->cells[position & this->mask];
+
+            intptr_t difference = (intptr_t) cell->sequence.load(std::memory_order_acquire) - (intptr_t) position;
+
+            if (difference == 0)
+            {
+                if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = this->enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->event = event;
+        cell->sequence.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /** @retval false if the ring is empty */
+    bool ENetEventRing::pop(ENetEvent &event)
+    {
+        size_t position = this->dequeuePosition.load(std::memory_order_relaxed);
+        Cell * cell;
+
+        for (;;)
+        {
+            cell = &this->cells[position & this->mask];
+
+            intptr_t difference = (intptr_t) cell->sequence.load(std::memory_order_acquire) - (intptr_t) (position + 1);
+
+            if (difference == 0)
+            {
+                if (this->dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = this->dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        event = cell->event;
+        cell->sequence.store(position + this->mask + 1, std::memory_order_release);
+
+        /* pairs with the fence in wait_for_space(), so either the producer sees the freed cell or we see it waiting */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (this->producerWaiting.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(this->spaceLock);
+            this->spaceAvailable.notify_one();
+        }
+
+        return true;
+    }
+
+    /** Whether the next push would fail; exact when there is a single producer. */
+    bool ENetEventRing::full()
+    {
+        size_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+
+        return this->cells[position & this->mask].sequence.load(std::memory_order_acquire) != position;
+    }
+
+    /** Blocks the producer until a consumer pops an event or milliseconds pass. */
+    void ENetEventRing::wait_for_space(enet_uint32 milliseconds)
+    {
+        std::unique_lock<std::mutex> lock(this->spaceLock);
+
+        this->producerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        this->spaceAvailable.wait_for(lock, std::chrono::milliseconds(milliseconds), [this] { return !this->full(); });
+        this->producerWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    /** Makes service_events() deliver events through a bounded ring that other threads drain.
+     *
+     *  Pooled packets stay destroyable on any thread, even if ENetPacketPool::concurrentRelease
+     *  was cleared before. Consumers should treat
+     *  event.peer as an identity only and send through ENetHost::submit(), since the peer keeps
+     *  being updated by the servicing thread.
+     *
+     *  @param capacity number of events the ring holds, rounded up to a power of two; 0 disables the ring
+     *  @retval 0 on success
+     *  @retval < 0 on failure
+     *  @remarks must not be called while consumers are draining the ring.
+     */
+    int ENetHost::set_event_ring(size_t capacity)
+    {
+        if (capacity == 0)
+        {
+            this->eventRing.reset();
+            return 0;
+        }
+
+        if (this->packetPool == nullptr)
+        {
+            return -1;
+        }
+
+        this->packetPool->concurrentRelease = true;
+        this->eventRing = std::make_unique<ENetEventRing>(capacity);
+
+        return 0;
+    }
+
+    /** Services the host like service() and moves every available event into the event ring.
+     *
+     *  When the ring is full, the host is still serviced to keep acknowledgements, pings and
+     *  resends flowing, but no further events are taken: they wait on their peers, bounded by
+     *  maximumWaitingData, until consumers make room. The call then blocks until a consumer takes
+     *  an event, for at most ENET_HOST_EVENT_RING_STALL_TIMEOUT milliseconds so that incoming
+     *  datagrams keep being acknowledged, rather than letting a servicing loop spin.
+     *
+     *  @param timeout number of milliseconds to wait for the first event
+     *  @returns the number of events pushed into the ring
+     *  @retval < 0 on failure
+     */
+    int ENetHost::service_events(enet_uint32 timeout)
+    {
+        ENetEvent event;
+        int       count = 0, result;
+
+        if (this->eventRing == nullptr)
+        {
+            return -1;
+        }
+
+        if (this->eventRing->full())
+        {
+            ++this->eventRingStalls;
+
+            if (this->service(nullptr, 0) < 0)
+            {
+                return -1;
+            }
+
+            this->eventRing->wait_for_space(std::min(timeout, (enet_uint32) ENET_HOST_EVENT_RING_STALL_TIMEOUT));
+            return 0;
+        }
+
+        result = this->service(&event, timeout);
+
+        while (result > 0)
+        {
+            this->eventRing->push(event);
+            ++count;
+
+            if (this->eventRing->full())
+            {
+                ++this->eventRingStalls;
+                break;
+            }
+
+            result = this->check_events(event) ? 1 : 0;
+        }
+
+        return result < 0 ? -1 : count;
+    }
+
+    /** Takes up to maximum events from the event ring; may be called from any thread.
+     *  @returns the number of events stored in events
+     */
+    size_t ENetHost::receive_events(ENetEvent *events, size_t maximum)
+    {
+        size_t count = 0;
+
+        if (this->eventRing == nullptr)
+        {
+            return 0;
+        }
+
+        while (count < maximum && this->eventRing->pop(events[count]))
+        {
+            ++count;
+        }
+
+        return count;
+    }
+
+// =======================================================================//
+// !
+// ! Sharded host
+// !
+// =======================================================================//
+
+    /** Creates shardCount hosts on the same port.
+     *  @param address the address to bind all shards to; a port of 0 picks one port for all of them
+     *  @param shardCount number of hosts and service threads
+     *  @param peerCount the maximum number of peers of each shard
+     *  @remarks on failure, shards is left empty.
+     */
+    ENetShardedHost::ENetShardedHost(const ENetAddress *address, size_t shardCount, size_t peerCount,
+                                     size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+    {
+        this->address = *address;
+
+        for (size_t index = 0; index < shardCount; ++index)
+        {
+            auto shard = std::make_unique<ENetShard>();
+
+            shard->group = this;
+            shard->index = index;
+            shard->host  = std::make_unique<ENetHost>(&this->address, peerCount, channelLimit, incomingBandwidth,
+                                                      outgoingBandwidth, ENET_HOST_FLAG_REUSE_PORT);
+
+            /* the shards created so far close their sockets with their hosts */
+            if (shard->host->socket.is_null() || shard->host->socket.get_address(&this->address) < 0)
+            {
+                this->shards.clear();
+
+                return;
+            }
+
+            this->shards.push_back(std::move(shard));
+        }
+    }
+
+    /** Stops the shards; packets still submitted to them are destroyed with their hosts. */
+    ENetShardedHost::~ENetShardedHost()
+    {
+        this->stop();
+    }
+
+    /** Starts one service thread per shard.
+     *  @param callback called on the shard's thread for every event
+     *  @param context passed to the callback
+     *  @param serviceTimeout milliseconds a shard blocks waiting for datagrams; stop() may take as long to return
+     *  @retval 0 on success
+     *  @retval < 0 on failure
+     */
+    int ENetShardedHost::start(ENetShardEventCallback callback, void *context, enet_uint32 serviceTimeout)
+    {
+        if (this->shards.empty() || this->running.exchange(true))
+        {
+            return -1;
+        }
+
+        this->callback       = callback;
+        this->context        = context;
+        this->serviceTimeout = serviceTimeout;
+
+        for (auto &shard : this->shards)
+        {
+            shard->thread = std::thread(&ENetShardedHost::service_shard, this, shard.get());
+        }
+
+        return 0;
+    }
+
+    /** Stops and joins the service threads. Peers stay connected until the host is destroyed. */
+    void ENetShardedHost::stop()
+    {
+        this->running = false;
+
+        for (auto &shard : this->shards)
+        {
+            if (shard->thread.joinable())
+            {
+                shard->thread.join();
+            }
+        }
+    }
+
+    /** Looks up a connected peer of any shard by its address.
+     *  @retval true if the peer was found and stored in result
+     */
+    bool ENetShardedHost::find_peer(const ENetAddress *address, ENetShardPeer *result)
+    {
+        std::lock_guard<std::mutex> lock(this->directoryMutex);
+        auto entry = this->directory.find({address->host, address->port, 0});
+
+        if (entry == this->directory.end())
+        {
+            return false;
+        }
+
+        *result = entry->second;
+        return true;
+    }
+
+    /** Queues a copy of data to be sent to a peer by the shard that owns it.
+     *  @retval 0 on success
+     *  @retval < 0 on failure
+     *  @remarks the packet is dropped if the peer has disconnected by the time the shard handles it.
+     */
+    int ENetShardedHost::send(const ENetShardPeer *peer, enet_uint8 channelID, const void *data, size_t dataLength,
+                              enet_uint32 flags)
+    {
+        ENetHost *  host;
+        ENetPacket *packet;
+
+        if (peer->shard >= this->shards.size())
+        {
+            return -1;
+        }
+
+        host = this->shards[peer->shard]->host.get();
+
+        if (peer->peerID >= host->peers.size())
+        {
+            return -1;
+        }
+
+        packet = enet_packet_create(data, dataLength, flags);
+        if (packet == nullptr)
+        {
+            return -1;
+        }
+
+        if (host->submit(&host->peers[peer->peerID], channelID, packet, peer->connectID) < 0)
+        {
+            enet_packet_destroy(packet);
+            return -1;
+        }
+
+        return 0;
+    }
+
+    /** Queues a copy of data to be broadcast by every shard to its connected peers.
+     *  @retval 0 on success
+     *  @retval < 0 on failure
+     */
+    int ENetShardedHost::broadcast(enet_uint8 channelID, const void *data, size_t dataLength, enet_uint32 flags)
+    {
+        for (auto &shard : this->shards)
+        {
+            ENetPacket *packet = enet_packet_create(data, dataLength, flags);
+
+            if (packet == nullptr)
+            {
+                return -1;
+            }
+
+            if (shard->host->submit_broadcast(channelID, packet) < 0)
+            {
+                enet_packet_destroy(packet);
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    /** Runs on the shard's thread until stop(): services the host, which also sends the packets
+     *  submitted to it and wakes up for them. */
+    void ENetShardedHost::service_shard(ENetShard *shard)
+    {
+        ENetHost *host = shard->host.get();
+        ENetEvent event;
+
+        while (this->running)
+        {
+            while (this->running && host->service(&event, this->serviceTimeout) > 0)
+            {
+                ENetPeerKey key = {event.peer->address.host, event.peer->address.port, 0};
+
+                switch (event.type)
+                {
+                    case ENetEventType::CONNECT: {
+                        std::lock_guard<std::mutex> lock(this->directoryMutex);
+                        this->directory[key] = {shard->index, event.peer->incomingPeerID, event.peer->connectID};
+                        break;
+                    }
+
+                    case ENetEventType::DISCONNECT:
+                    case ENetEventType::DISCONNECT_TIMEOUT: {
+                        std::lock_guard<std::mutex> lock(this->directoryMutex);
+                        auto entry = this->directory.find(key);
+
+                        if (entry != this->directory.end() && entry->second.shard == shard->index &&
+                            entry->second.peerID == event.peer->incomingPeerID)
+                        {
+                            this->directory.erase(entry);
+                        }
+                        break;
+                    }
+
+                    default:
+                        break;
+                }
+
+                if (this->callback != nullptr)
+                {
+                    (*this->callback)(shard, &event, this->context);
+                }
+                else if (event.type == ENetEventType::RECEIVE)
+                {
+                    enet_packet_destroy(event.packet);
+                }
+            }
+        }
+    }
+
+// =======================================================================//
+// !
+// ! Reactor
+// !
+// =======================================================================//
+
+    ENetReactor::ENetReactor()
+    {
+    #ifdef ENET_HAS_EPOLL
+        this->pollSet = epoll_create1(EPOLL_CLOEXEC);
+    #endif
+    }
+
+    ENetReactor::~ENetReactor()
+    {
+    #ifdef ENET_HAS_EPOLL
+        if (this->pollSet >= 0)
+        {
+            close(this->pollSet);
+        }
+    #endif
+    }
+
+    /** Registers a host to be serviced by the reactor.
+     *  @retval 0 on success
+     *  @retval < 0 if the host could not be registered or already is
+     */
+    int ENetReactor::add(ENetHost *host)
+    {
+        for (auto &entry : this->hosts)
+        {
+            if (entry->host == host)
+            {
+                return -1;
+            }
+        }
+
+        auto entry    = std::make_unique<ENetReactorHost>();
+        entry->host   = host;
+        entry->handle = host->socket.wait_handle();
+
+    #ifdef ENET_HAS_EPOLL
+        epoll_event pollEvent = {};
+
+        pollEvent.events   = EPOLLIN;
+        pollEvent.data.ptr = entry.get();
+
+        if (this->pollSet < 0 || epoll_ctl(this->pollSet, EPOLL_CTL_ADD, entry->handle, &pollEvent) < 0)
+        {
+            return -1;
+        }
+
+        this->pollEvents.resize(this->hosts.size() + 1);
+    #else
+        this->pollSockets.push_back({entry->handle, POLLIN, 0});
+    #endif
+
+        this->hosts.push_back(std::move(entry));
+        return 0;
+    }
+
+    /** Unregisters a host; it is left as it is and may be serviced directly again.
+     *  @retval 0 on success
+     *  @retval < 0 if the host was not registered
+     */
+    int ENetReactor::remove(ENetHost *host)
+    {
+        for (size_t index = 0; index < this->hosts.size(); ++index)
+        {
+            if (this->hosts[index]->host != host)
+            {
+                continue;
+            }
+
+        #ifdef ENET_HAS_EPOLL
+            epoll_ctl(this->pollSet, EPOLL_CTL_DEL, this->hosts[index]->handle, nullptr);
+            this->pollEvents.pop_back();
+        #else
+            this->pollSockets.erase(this->pollSockets.begin() + index);
+        #endif
+
+            this->hosts.erase(this->hosts.begin() + index);
+            return 0;
+        }
+
+        return -1;
+    }
+
+    /** Waits until a registered host is ready or the timeout passes, then services the ready hosts.
+     *  @param callback called for every event of a serviced host; if nullptr, received packets are destroyed
+     *  @param context passed to the callback
+     *  @param timeout milliseconds to wait if no host becomes ready sooner
+     *  @returns the number of events delivered
+     *  @retval < 0 on failure
+     *  @remarks hosts may use their own time sources, since each deadline is compared against the
+     *  clock of its host; they must not be added or removed from the callback.
+     *  Packets submitted to a host from other threads wake the reactor through the host's socket.
+     *  Without registered hosts, it only sleeps for the timeout.
+     */
+    int ENetReactor::service(ENetReactorEventCallback callback, void *context, enet_uint32 timeout)
+    {
+        enet_uint64 wait = (enet_uint64) timeout * ENET_TIME_MILLISECOND;
+        ENetEvent   event;
+        int         count = 0, waitCount, waitTimeout;
+
+        if (this->hosts.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+            return 0;
+        }
+
+        for (auto &entry : this->hosts)
+        {
+            enet_uint64 now = entry->host->update_time();
+
+            entry->deadline = entry->host->next_deadline();
+            wait            = std::min(wait, ENET_TIME_LESS(now, entry->deadline) ? entry->deadline - now : 0);
+        }
+
+        waitTimeout = (int) ((wait + ENET_TIME_MILLISECOND - 1) / ENET_TIME_MILLISECOND);
+
+    #ifdef ENET_HAS_EPOLL
+        waitCount = epoll_wait(this->pollSet, this->pollEvents.data(), (int) this->pollEvents.size(), waitTimeout);
+        if (waitCount < 0 && errno != EINTR)
+        {
+            return -1;
+        }
+
+        for (int index = 0; index < waitCount; ++index)
+        {
+            ((ENetReactorHost *) this->pollEvents[index].data.ptr)->readable = 1;
+        }
+    #else
+        waitCount = ::poll(this->pollSockets.data(), this->pollSockets.size(), waitTimeout);
+        if (waitCount < 0 && errno != EINTR)
+        {
+            return -1;
+        }
+
+        for (size_t index = 0; index < this->pollSockets.size() && waitCount > 0; ++index)
+        {
+            this->hosts[index]->readable = (this->pollSockets[index].revents & POLLIN) != 0;
+        }
+    #endif
+
+        for (auto &entry : this->hosts)
+        {
+            ENetHost *host = entry->host;
+            int       result;
+
+            if (!entry->readable && ENET_TIME_LESS(host->update_time(), entry->deadline))
+            {
+                continue;
+            }
+
+            entry->readable = 0;
+
+            /* one service per host and pass; datagrams left in its socket keep it readable for the next */
+            for (result = host->service(&event, 0); result > 0; result = host->check_events(event) ? 1 : 0)
+            {
+                if (callback != nullptr)
+                {
+                    (*callback)(host, &event, context);
+                }
+                else if (event.type == ENetEventType::RECEIVE)
+                {
+                    enet_packet_destroy(event.packet);
+                }
+
+                ++count;
+            }
+
+            if (result < 0)
+            {
+                return -1;
+            }
+        }
+
+        return count;
+    }
+
+// =======================================================================//
+// !
+// ! Time
+// !
+// =======================================================================//
+
+    #ifdef _WIN32
+        static LARGE_INTEGER getFILETIMEoffset() {
+            SYSTEMTIME s;
+            FILETIME f;
+            LARGE_INTEGER t;
+
+            s.wYear = 1970;
+            s.wMonth = 1;
+            s.wDay = 1;
+            s.wHour = 0;
+            s.wMinute = 0;
+            s.wSecond = 0;
+            s.wMilliseconds = 0;
+            SystemTimeToFileTime(&s, &f);
+            t.QuadPart = f.dwHighDateTime;
+            t.QuadPart <<= 32;
+            t.QuadPart |= f.dwLowDateTime;
+            return (t);
+        }
+
+        int clock_gettime(int X, struct timespec *tv) {
+            LARGE_INTEGER t;
+            FILETIME f;
+            double microseconds;
+            static LARGE_INTEGER offset;
+            static double frequencyToMicroseconds;
+            static int initialized = 0;
+            static BOOL usePerformanceCounter = 0;
+
+            if (!initialized) {
+                LARGE_INTEGER performanceFrequency;
+                initialized = 1;
+                usePerformanceCounter = QueryPerformanceFrequency(&performanceFrequency);
+                if (usePerformanceCounter) {
+                    QueryPerformanceCounter(&offset);
+                    frequencyToMicroseconds = (double)performanceFrequency.QuadPart / 1000000.;
+                } else {
+                    offset = getFILETIMEoffset();
+                    frequencyToMicroseconds = 10.;
+                }
+            }
+            if (usePerformanceCounter) {
+                QueryPerformanceCounter(&t);
+            } else {
+                GetSystemTimeAsFileTime(&f);
+                t.QuadPart = f.dwHighDateTime;
+                t.QuadPart <<= 32;
+                t.QuadPart |= f.dwLowDateTime;
+            }
+
+            t.QuadPart -= offset.QuadPart;
+            microseconds = (double)t.QuadPart / frequencyToMicroseconds;
+            t.QuadPart = (LONGLONG)microseconds;
+            tv->tv_sec = (long)(t.QuadPart / 1000000);
+            tv->tv_nsec = t.QuadPart % 1000000 * 1000;
+            return (0);
+        }
+    #elif __APPLE__ && __MAC_OS_X_VERSION_MIN_REQUIRED < 101200
+        #define CLOCK_MONOTONIC 0
+
+        int clock_gettime(int X, struct timespec *ts) {
+            clock_serv_t cclock;
+            mach_timespec_t mts;
+
+            host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock);
+            clock_get_time(cclock, &mts);
+            mach_port_deallocate(mach_task_self(), cclock);
+
+            ts->tv_sec = mts.tv_sec;
+            ts->tv_nsec = mts.tv_nsec;
+
+            return 0;
+        }
+    #endif
+
+    enet_uint64 enet_time_get_us() {
+        // Service time is kept in 64 bit microseconds, so it neither wraps
+        // nor loses sub-millisecond round trip times. It is measured from
+        // an offset so that the first call of enet_time_get_us() always
+        // returns 1ms, and follow-up calls indicate elapsed time since the
+        // first call.
         //
         // Note that we don't want to return 0 from the first call, in case
         // some part of enet uses 0 as a special value (meaning time not set
         // for example).
         static uint64_t start_time_ns = 0;
 
-        struct timespec ts;
-    #if defined(CLOCK_MONOTONIC_RAW)
-        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-    #else
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-    #endif
+        // CLOCK_MONOTONIC rather than CLOCK_MONOTONIC_RAW, since only the
+        // former is read from the vDSO without a syscall on every kernel.
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        static const uint64_t ns_in_s = 1000 * 1000 * 1000;
+        static const uint64_t ns_in_ms = 1000 * 1000;
+        static const uint64_t ns_in_us = 1000;
+        uint64_t current_time_ns = ts.tv_nsec + (uint64_t)ts.tv_sec * ns_in_s;
+
+        // Most of the time we just want to atomically read the start time. We
+        // could just use a single CAS instruction instead of this if, but it
+        // would be slower in the average case.
+        //
+        // Note that statics are auto-initialized to zero, and starting a thread
+        // implies a memory barrier. So we know that whatever thread calls this,
+        // it correctly sees the start_time_ns as 0 initially.
+        uint64_t offset_ns = ENET_ATOMIC_READ(&start_time_ns);
+        if (offset_ns == 0) {
+            // We still need to CAS, since two different threads can get here
+            // at the same time.
+            //
+            // We assume that current_time_ns is > 1ms.
+            //
+            // Set the value of the start_time_ns, such that the first timestamp
+            // is at 1ms. This ensures 0 remains a special value.
+            uint64_t want_value = current_time_ns - 1 * ns_in_ms;
+            uint64_t old_value = ENET_ATOMIC_CAS(&start_time_ns, 0, want_value);
+            offset_ns = old_value == 0 ? want_value : old_value;
+        }
+
+        uint64_t result_in_ns = current_time_ns - offset_ns;
+        return result_in_ns / ns_in_us;
+    }
+
+    enet_uint32 enet_time_get() {
+        return (enet_uint32) (enet_time_get_us() / ENET_TIME_MILLISECOND);
+    }
+
+// =======================================================================//
+// !
+// ! Platform Specific (Unix)
+// !
+// =======================================================================//
+
+    #ifndef _WIN32
+
+    int enet_initialize(void) {
+        return 0;
+    }
+
+    void enet_deinitialize(void) {}
+
+    enet_uint64 ENetHost::random_seed(void) { return static_cast<enet_uint64>(time(nullptr)); }
+
+    int enet_address_set_host_ip(ENetAddress *address, const char *name) {
+        if (!inet_pton(AF_INET6, name, &address->host)) {
+            return -1;
+        }
+
+        return 0;
+    }
+
+    int enet_address_set_host(ENetAddress *address, const char *name) {
+        struct addrinfo hints, *resultList = nullptr;
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+
+        if (getaddrinfo(name, nullptr, &hints, &resultList) != 0)
+        {
+            return -1;
+        }
+
+        for (auto result = resultList; result != nullptr; result = result->ai_next)
+        {
+            if (result->ai_addr != nullptr && result->ai_addrlen >= sizeof(struct sockaddr_in))
+            {
+                if (result->ai_family == AF_INET) {
+                    struct sockaddr_in * sin = (struct sockaddr_in *) result->ai_addr;
+
+                    ((uint32_t *)&address->host.s6_addr)[0] = 0;
+                    ((uint32_t *)&address->host.s6_addr)[1] = 0;
+                    ((uint32_t *)&address->host.s6_addr)[2] = htonl(0xffff);
+                    ((uint32_t *)&address->host.s6_addr)[3] = sin->sin_addr.s_addr;
+
+                    freeaddrinfo(resultList);
+
+                    return 0;
+                }
+                else if(result->ai_family == AF_INET6) {
+                    struct sockaddr_in6 * sin = (struct sockaddr_in6 *)result->ai_addr;
+
+                    address->host = sin->sin6_addr;
+                    address->sin6_scope_id = sin->sin6_scope_id;
+
+                    freeaddrinfo(resultList);
+
+                    return 0;
+                }
+            }
+        }
+
+        if (resultList != nullptr)
+        {
+            freeaddrinfo(resultList);
+        }
+
+        return enet_address_set_host_ip(address, name);
+    } /* enet_address_set_host */
+
+    int enet_address_get_host_ip(const ENetAddress *address, char *name, size_t nameLength) {
+        if (inet_ntop(AF_INET6, &address->host, name, nameLength) == nullptr)
+        {
+            return -1;
+        }
+
+        return 0;
+    }
+
+    int enet_address_get_host(const ENetAddress *address, char *name, size_t nameLength) {
+        struct sockaddr_in6 sin;
+        int err;
+
+        memset(&sin, 0, sizeof(struct sockaddr_in6));
+
+        sin.sin6_family = AF_INET6;
+        sin.sin6_port = ENET_HOST_TO_NET_16 (address->port);
+        sin.sin6_addr = address->host;
+        sin.sin6_scope_id = address->sin6_scope_id;
+
+        err = getnameinfo((struct sockaddr *)&sin, sizeof(sin), name, nameLength, nullptr, 0,
+                          NI_NAMEREQD);
+        if (!err) {
+            if (name != nullptr && nameLength > 0 && !memchr(name, '\0', nameLength))
+            {
+                return -1;
+            }
+            return 0;
+        }
+        if (err != EAI_NONAME) {
+            return -1;
+        }
+
+        return enet_address_get_host_ip(address, name, nameLength);
+    } /* enet_address_get_host */
+
+    int ENetSocket::bind(const ENetAddress *address)
+    {
+        struct sockaddr_in6 sin;
+        memset(&sin, 0, sizeof(struct sockaddr_in6));
+        sin.sin6_family = AF_INET6;
 
-        static const uint64_t ns_in_s = 1000 * 1000 * 1000;
-        static const uint64_t ns_in_ms = 1000 * 1000;
-        uint64_t current_time_ns = ts.tv_nsec + (uint64_t)ts.tv_sec * ns_in_s;
+        if (address != nullptr)
+        {
+            sin.sin6_port       = ENET_HOST_TO_NET_16(address->port);
+            sin.sin6_addr       = address->host;
+            sin.sin6_scope_id   = address->sin6_scope_id;
+        }
+        else
+        {
+            sin.sin6_port       = 0;
+            sin.sin6_addr       = ENET_HOST_ANY;
+            sin.sin6_scope_id   = 0;
+        }
 
-        // Most of the time we just want to atomically read the start time. We
-        // could just use a single CAS instruction instead of this if, but it
-        // would be slower in the average case.
-        //
-        // Note that statics are auto-initialized to zero, and starting a thread
-        // implies a memory barrier. So we know that whatever thread calls this,
-        // it correctly sees the start_time_ns as 0 initially.
-        uint64_t offset_ns = ENET_ATOMIC_READ(&start_time_ns);
-        if (offset_ns == 0) {
-            // We still need to CAS, since two different threads can get here
-            // at the same time.
-            //
-            // We assume that current_time_ns is > 1ms.
-            //
-            // Set the value of the start_time_ns, such that the first timestamp
-            // is at 1ms. This ensures 0 remains a special value.
-            uint64_t want_value = current_time_ns - 1 * ns_in_ms;
-            uint64_t old_value = ENET_ATOMIC_CAS(&start_time_ns, 0, want_value);
-            offset_ns = old_value == 0 ? want_value : old_value;
+        return ::bind(m_socket, (struct sockaddr *)&sin, sizeof(struct sockaddr_in6));
+    }
+
+    int ENetSocket::get_address(ENetAddress *address)
+    {
+        struct sockaddr_in6 sin;
+        socklen_t sinLength = sizeof(struct sockaddr_in6);
+
+        if (getsockname(m_socket, (struct sockaddr *)&sin, &sinLength) == -1)
+        {
+            return -1;
         }
 
-        uint64_t result_in_ns = current_time_ns - offset_ns;
-        return (enet_uint32)(result_in_ns / ns_in_ms);
+        address->host           = sin.sin6_addr;
+        address->port           = ENET_NET_TO_HOST_16(sin.sin6_port);
+        address->sin6_scope_id  = sin.sin6_scope_id;
+
+        return 0;
     }
 
-// =======================================================================//
-// !
-// ! Platform Specific (Unix)
-// !
-// =======================================================================//
+    int ENetSocket::listen(int backlog)
+    {
+        return ::listen(m_socket, backlog < 0 ? SOMAXCONN : backlog);
+    }
+
+    int ENetSocket::set_option(ENetSocketOption option, int value)
+    {
+        int result = -1;
+
+        switch (option) {
+            case ENET_SOCKOPT_NONBLOCK:
+                result = fcntl(m_socket, F_SETFL,
+                               (value ? O_NONBLOCK : 0) | (fcntl(m_socket, F_GETFL) & ~O_NONBLOCK));
+                break;
+
+            case ENET_SOCKOPT_BROADCAST:
+                result =
+                    setsockopt(m_socket, SOL_SOCKET, SO_BROADCAST, (char *)&value, sizeof(int));
+                break;
+
+            case ENET_SOCKOPT_REUSEADDR:
+                result =
+                    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, (char *)&value, sizeof(int));
+                break;
+
+        #ifdef SO_REUSEPORT
+            case ENET_SOCKOPT_REUSEPORT:
+                result =
+                    setsockopt(m_socket, SOL_SOCKET, SO_REUSEPORT, (char *)&value, sizeof(int));
+                break;
+        #endif
+
+            case ENET_SOCKOPT_RCVBUF:
+                result = setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, (char *)&value, sizeof(int));
+                break;
+
+            case ENET_SOCKOPT_SNDBUF:
+                result = setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, (char *)&value, sizeof(int));
+                break;
+
+            case ENET_SOCKOPT_RCVTIMEO: {
+                struct timeval timeVal;
+                timeVal.tv_sec  = value / 1000;
+                timeVal.tv_usec = (value % 1000) * 1000;
+                result          = setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeVal,
+                                    sizeof(struct timeval));
+                break;
+            }
+
+            case ENET_SOCKOPT_SNDTIMEO: {
+                struct timeval timeVal;
+                timeVal.tv_sec  = value / 1000;
+                timeVal.tv_usec = (value % 1000) * 1000;
+                result          = setsockopt(m_socket, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeVal,
+                                    sizeof(struct timeval));
+                break;
+            }
+
+            case ENET_SOCKOPT_NODELAY:
+                result =
+                    setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, (char *)&value, sizeof(int));
+                break;
+
+            case ENET_SOCKOPT_IPV6_V6ONLY:
+                result =
+                    setsockopt(m_socket, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&value, sizeof(int));
+                break;
+
+        #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+            case ENET_SOCKOPT_UDP_SEGMENT:
+                result = setsockopt(m_socket, SOL_UDP, UDP_SEGMENT, (char *)&value, sizeof(int));
+                break;
+
+            case ENET_SOCKOPT_UDP_GRO:
+                result = setsockopt(m_socket, SOL_UDP, UDP_GRO, (char *)&value, sizeof(int));
+                break;
+        #endif
+
+            default:
+                break;
+        }
+        return result == -1 ? -1 : 0;
+    } /* set_option */
+
+    int ENetSocket::get_option(ENetSocketOption option, int *value)
+    {
+        int result = -1;
+        socklen_t len;
+
+        switch (option) {
+            case ENET_SOCKOPT_ERROR:
+                len    = sizeof(int);
+                result = getsockopt(m_socket, SOL_SOCKET, SO_ERROR, value, &len);
+                break;
+
+            default:
+                break;
+        }
+        return result == -1 ? -1 : 0;
+    }
+
+    int ENetSocket::connect(const ENetAddress *address)
+    {
+        struct sockaddr_in6 sin;
+        int result;
+
+        memset(&sin, 0, sizeof(struct sockaddr_in6));
+
+        sin.sin6_family     = AF_INET6;
+        sin.sin6_port       = ENET_HOST_TO_NET_16(address->port);
+        sin.sin6_addr       = address->host;
+        sin.sin6_scope_id   = address->sin6_scope_id;
+
+        result = ::connect(m_socket, (struct sockaddr *)&sin, sizeof(struct sockaddr_in6));
+        if (result == -1 && errno == EINPROGRESS) {
+            return 0;
+        }
+
+        return result;
+    }
+
+    int ENetSocket::accept(ENetAddress *address)
+    {
+        int result;
+        struct sockaddr_in6 sin;
+        socklen_t           sinLength = sizeof(struct sockaddr_in6);
+
+        result = ::accept(m_socket, address != nullptr ? (struct sockaddr *)&sin : nullptr,
+                          address != nullptr ? &sinLength : nullptr);
+
+        if (result == -1) {
+            return ENET_SOCKET_NULL;
+        }
+
+        if (address != nullptr)
+        {
+            address->host = sin.sin6_addr;
+            address->port = ENET_NET_TO_HOST_16 (sin.sin6_port);
+            address->sin6_scope_id = sin.sin6_scope_id;
+        }
+
+        return result;
+    }
+
+    int ENetSocket::shutdown(ENetSocketShutdown how) { return ::shutdown(m_socket, (int)how); }
+
+    ENetSocket::~ENetSocket()
+    {
+        this->close();
+    }
+
+    /** Closes the socket, after which is_null() is true. */
+    void ENetSocket::close()
+    {
+        if (m_socket != -1)
+        {
+            ::close(m_socket);
+            m_socket = ENET_SOCKET_NULL;
+        }
+    }
+
+    int ENetSocket::send(const ENetAddress *address, const ENetBuffer *buffers, size_t bufferCount)
+    {
+        struct msghdr msgHdr;
+        struct sockaddr_in6 sin;
+        int sentLength;
+
+        memset(&msgHdr, 0, sizeof(struct msghdr));
+
+        if (address != nullptr)
+        {
+            memset(&sin, 0, sizeof(struct sockaddr_in6));
+
+            sin.sin6_family     = AF_INET6;
+            sin.sin6_port       = ENET_HOST_TO_NET_16(address->port);
+            sin.sin6_addr       = address->host;
+            sin.sin6_scope_id   = address->sin6_scope_id;
+
+            msgHdr.msg_name    = &sin;
+            msgHdr.msg_namelen = sizeof(struct sockaddr_in6);
+        }
+
+        msgHdr.msg_iov    = (struct iovec *) buffers;
+        msgHdr.msg_iovlen = bufferCount;
+
+        sentLength = sendmsg(m_socket, &msgHdr, MSG_NOSIGNAL);
+
+        if (sentLength == -1) {
+            if (errno == EWOULDBLOCK) {
+                return 0;
+            }
+
+            return -1;
+        }
+
+        return sentLength;
+    }
+
+    int ENetSocket::receive(ENetAddress *address, ENetBuffer *buffers, size_t bufferCount)
+    {
+        struct msghdr msgHdr;
+        struct sockaddr_in6 sin;
+        int recvLength;
+
+        memset(&msgHdr, 0, sizeof(struct msghdr));
 
-    #ifndef _WIN32
+        if (address != nullptr)
+        {
+            msgHdr.msg_name    = &sin;
+            msgHdr.msg_namelen = sizeof(struct sockaddr_in6);
+        }
 
-    int enet_initialize(void) {
-        return 0;
-    }
+        msgHdr.msg_iov    = (struct iovec *) buffers;
+        msgHdr.msg_iovlen = bufferCount;
 
-    void enet_deinitialize(void) {}
+        recvLength = recvmsg(m_socket, &msgHdr, MSG_NOSIGNAL);
 
-    enet_uint64 ENetHost::random_seed(void) { return static_cast<enet_uint64>(time(nullptr)); }
+        if (recvLength == -1) {
+            if (errno == EWOULDBLOCK) {
+                return 0;
+            }
 
-    int enet_address_set_host_ip(ENetAddress *address, const char *name) {
-        if (!inet_pton(AF_INET6, name, &address->host)) {
             return -1;
         }
 
-        return 0;
+        if (msgHdr.msg_flags & MSG_TRUNC) {
+            return -1;
+        }
+
+        if (address != nullptr)
+        {
+            address->host           = sin.sin6_addr;
+            address->port           = ENET_NET_TO_HOST_16(sin.sin6_port);
+            address->sin6_scope_id  = sin.sin6_scope_id;
+        }
+
+        return recvLength;
     }
 
-    int enet_address_set_host(ENetAddress *address, const char *name) {
-        struct addrinfo hints, *resultList = nullptr;
+    /** Receives up to messageCount datagrams, one into each message.
+     *  @returns the number of datagrams received, 0 if none were pending, or -1 on failure
+     *  @remarks a datagram that did not fit into its buffers is reported with a dataLength of 0.
+     */
+    int ENetSocket::receive_many(ENetSocketMessage *messages, size_t messageCount)
+    {
+    #ifdef ENET_HAS_IO_URING
+        if (this->uring != nullptr) {
+            return this->uring->receive_many(messages, messageCount);
+        }
+    #endif
 
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_UNSPEC;
+    #ifdef ENET_HAS_MMSG
+        struct mmsghdr msgHdrs[ENET_MESSAGE_MAXIMUM];
+        struct sockaddr_in6 sins[ENET_MESSAGE_MAXIMUM];
+        int recvCount;
+    #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+        alignas(struct cmsghdr) char control[ENET_MESSAGE_MAXIMUM][CMSG_SPACE(sizeof(int))];
+    #endif
 
-        if (getaddrinfo(name, nullptr, &hints, &resultList) != 0)
+        if (messageCount > ENET_MESSAGE_MAXIMUM) {
+            messageCount = ENET_MESSAGE_MAXIMUM;
+        }
+
+        memset(msgHdrs, 0, messageCount * sizeof(struct mmsghdr));
+
+        for (size_t i = 0; i < messageCount; ++i)
         {
+            msgHdrs[i].msg_hdr.msg_name    = &sins[i];
+            msgHdrs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+            msgHdrs[i].msg_hdr.msg_iov     = (struct iovec *) messages[i].buffers;
+            msgHdrs[i].msg_hdr.msg_iovlen  = messages[i].bufferCount;
+        #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+            msgHdrs[i].msg_hdr.msg_control    = control[i];
+            msgHdrs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        #endif
+        }
+
+        recvCount = recvmmsg(m_socket, msgHdrs, messageCount, MSG_NOSIGNAL, nullptr);
+
+        if (recvCount == -1) {
+            if (errno == EWOULDBLOCK) {
+                return 0;
+            }
+
             return -1;
         }
 
-        for (auto result = resultList; result != nullptr; result = result->ai_next)
+        for (int i = 0; i < recvCount; ++i)
         {
-            if (result->ai_addr != nullptr && result->ai_addrlen >= sizeof(struct sockaddr_in))
+            messages[i].address.host          = sins[i].sin6_addr;
+            messages[i].address.port          = ENET_NET_TO_HOST_16(sins[i].sin6_port);
+            messages[i].address.sin6_scope_id = sins[i].sin6_scope_id;
+            messages[i].dataLength            = msgHdrs[i].msg_hdr.msg_flags & MSG_TRUNC ? 0 : msgHdrs[i].msg_len;
+            messages[i].segmentSize           = 0;
+
+        #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgHdrs[i].msg_hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgHdrs[i].msg_hdr, cmsg))
             {
-                if (result->ai_family == AF_INET) {
-                    struct sockaddr_in * sin = (struct sockaddr_in *) result->ai_addr;
-
-                    ((uint32_t *)&address->host.s6_addr)[0] = 0;
-                    ((uint32_t *)&address->host.s6_addr)[1] = 0;
-                    ((uint32_t *)&address->host.s6_addr)[2] = htonl(0xffff);
-                    ((uint32_t *)&address->host.s6_addr)[3] = sin->sin_addr.s_addr;
-
-                    freeaddrinfo(resultList);
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+                {
+                    int segmentSize;
 
-                    return 0;
+                    memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(int));
+                    messages[i].segmentSize = segmentSize;
                 }
-                else if(result->ai_family == AF_INET6) {
-                    struct sockaddr_in6 * sin = (struct sockaddr_in6 *)result->ai_addr;
+            }
+        #endif
+        }
 
-                    address->host = sin->sin6_addr;
-                    address->sin6_scope_id = sin->sin6_scope_id;
+        return recvCount;
+    #else
+        size_t recvCount;
 
-                    freeaddrinfo(resultList);
+        for (recvCount = 0; recvCount < messageCount; ++recvCount)
+        {
+            int recvLength = this->receive(&messages[recvCount].address, messages[recvCount].buffers, messages[recvCount].bufferCount);
 
-                    return 0;
-                }
+            if (recvLength < 0) {
+                return recvCount > 0 ? (int) recvCount : -1;
             }
+
+            if (recvLength == 0) {
+                break;
+            }
+
+            messages[recvCount].dataLength  = recvLength;
+            messages[recvCount].segmentSize = 0;
         }
 
-        if (resultList != nullptr)
-        {
-            freeaddrinfo(resultList);
+        return (int) recvCount;
+    #endif
+    } /* receive_many */
+
+    /** Sends up to messageCount datagrams, stopping at the first one the socket does not accept.
+     *  @returns the number of datagrams sent, 0 if the socket would block, or -1 on failure
+     */
+    int ENetSocket::send_many(ENetSocketMessage *messages, size_t messageCount)
+    {
+    #ifdef ENET_HAS_IO_URING
+        if (this->uring != nullptr) {
+            return this->uring->send_many(messages, messageCount);
         }
+    #endif
 
-        return enet_address_set_host_ip(address, name);
-    } /* enet_address_set_host */
+    #ifdef ENET_HAS_MMSG
+        struct mmsghdr msgHdrs[ENET_MESSAGE_MAXIMUM];
+        struct sockaddr_in6 sins[ENET_MESSAGE_MAXIMUM];
+        int sentCount;
+    #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+        alignas(struct cmsghdr) char control[ENET_MESSAGE_MAXIMUM][CMSG_SPACE(sizeof(enet_uint16))];
+    #endif
 
-    int enet_address_get_host_ip(const ENetAddress *address, char *name, size_t nameLength) {
-        if (inet_ntop(AF_INET6, &address->host, name, nameLength) == nullptr)
-        {
-            return -1;
+        if (messageCount > ENET_MESSAGE_MAXIMUM) {
+            messageCount = ENET_MESSAGE_MAXIMUM;
         }
 
-        return 0;
-    }
+        memset(msgHdrs, 0, messageCount * sizeof(struct mmsghdr));
+        memset(sins, 0, messageCount * sizeof(struct sockaddr_in6));
 
-    int enet_address_get_host(const ENetAddress *address, char *name, size_t nameLength) {
-        struct sockaddr_in6 sin;
-        int err;
+        for (size_t i = 0; i < messageCount; ++i)
+        {
+            sins[i].sin6_family   = AF_INET6;
+            sins[i].sin6_port     = ENET_HOST_TO_NET_16(messages[i].address.port);
+            sins[i].sin6_addr     = messages[i].address.host;
+            sins[i].sin6_scope_id = messages[i].address.sin6_scope_id;
+
+            msgHdrs[i].msg_hdr.msg_name    = &sins[i];
+            msgHdrs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+            msgHdrs[i].msg_hdr.msg_iov     = (struct iovec *) messages[i].buffers;
+            msgHdrs[i].msg_hdr.msg_iovlen  = messages[i].bufferCount;
+
+        #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+            if (messages[i].segmentSize > 0)
+            {
+                struct cmsghdr *cmsg;
+                enet_uint16 segmentSize = (enet_uint16) messages[i].segmentSize;
 
-        memset(&sin, 0, sizeof(struct sockaddr_in6));
+                memset(control[i], 0, sizeof(control[i]));
 
-        sin.sin6_family = AF_INET6;
-        sin.sin6_port = ENET_HOST_TO_NET_16 (address->port);
-        sin.sin6_addr = address->host;
-        sin.sin6_scope_id = address->sin6_scope_id;
+                msgHdrs[i].msg_hdr.msg_control    = control[i];
+                msgHdrs[i].msg_hdr.msg_controllen = sizeof(control[i]);
 
-        err = getnameinfo((struct sockaddr *)&sin, sizeof(sin), name, nameLength, nullptr, 0,
-                          NI_NAMEREQD);
-        if (!err) {
-            if (name != nullptr && nameLength > 0 && !memchr(name, '\0', nameLength))
-            {
-                return -1;
+                cmsg             = CMSG_FIRSTHDR(&msgHdrs[i].msg_hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type  = UDP_SEGMENT;
+                cmsg->cmsg_len   = CMSG_LEN(sizeof(enet_uint16));
+                memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(enet_uint16));
             }
-            return 0;
-        }
-        if (err != EAI_NONAME) {
-            return -1;
+        #endif
         }
 
-        return enet_address_get_host_ip(address, name, nameLength);
-    } /* enet_address_get_host */
+        sentCount = sendmmsg(m_socket, msgHdrs, messageCount, MSG_NOSIGNAL);
 
-    int ENetSocket::bind(const ENetAddress *address)
-    {
-        struct sockaddr_in6 sin;
-        memset(&sin, 0, sizeof(struct sockaddr_in6));
-        sin.sin6_family = AF_INET6;
+        if (sentCount == -1) {
+            if (errno == EWOULDBLOCK) {
+                return 0;
+            }
 
-        if (address != nullptr)
+            return -1;
+        }
+
+        for (int i = 0; i < sentCount; ++i)
         {
-            sin.sin6_port       = ENET_HOST_TO_NET_16(address->port);
-            sin.sin6_addr       = address->host;
-            sin.sin6_scope_id   = address->sin6_scope_id;
+            messages[i].dataLength = msgHdrs[i].msg_len;
         }
-        else
+
+        return sentCount;
+    #else
+        size_t sentCount;
+
+        for (sentCount = 0; sentCount < messageCount; ++sentCount)
         {
-            sin.sin6_port       = 0;
-            sin.sin6_addr       = ENET_HOST_ANY;
-            sin.sin6_scope_id   = 0;
+            int sentLength = this->send(&messages[sentCount].address, messages[sentCount].buffers, messages[sentCount].bufferCount);
+
+            if (sentLength < 0) {
+                return sentCount > 0 ? (int) sentCount : -1;
+            }
+
+            if (sentLength == 0) {
+                break;
+            }
+
+            messages[sentCount].dataLength = sentLength;
         }
 
-        return ::bind(m_socket, (struct sockaddr *)&sin, sizeof(struct sockaddr_in6));
+        return (int) sentCount;
+    #endif
+    } /* send_many */
+
+    int ENetSocket::select(ENetSocketSet *readSet, ENetSocketSet *writeSet, enet_uint32 timeout)
+    {
+        timeval timeVal = {timeout / 1000, (timeout % 1000) * 1000};
+
+        return ::select(m_socket + 1, readSet, writeSet, nullptr, &timeVal);
     }
 
-    int ENetSocket::get_address(ENetAddress *address)
+    int ENetSocket::wait(enet_uint32 &condition, enet_uint64 timeout)
     {
-        struct sockaddr_in6 sin;
-        socklen_t sinLength = sizeof(struct sockaddr_in6);
+        pollfd pollSocket = {
+            m_socket,
+            0,
+        };
 
-        if (getsockname(m_socket, (struct sockaddr *)&sin, &sinLength) == -1)
+    #ifdef ENET_HAS_IO_URING
+        if (this->uring != nullptr) {
+            return this->uring->wait(condition, timeout);
+        }
+    #endif
+
+        if (condition & ENET_SOCKET_WAIT_SEND)
+        {
+            pollSocket.events |= POLLOUT;
+        }
+
+        if (condition & ENET_SOCKET_WAIT_RECEIVE)
         {
+            pollSocket.events |= POLLIN;
+        }
+
+        int pollCount = ::poll(&pollSocket, 1, timeout);
+
+        if (pollCount < 0) {
+            if (errno == EINTR && condition & ENET_SOCKET_WAIT_INTERRUPT)
+            {
+                condition = ENET_SOCKET_WAIT_INTERRUPT;
+
+                return 0;
+            }
+
             return -1;
         }
 
-        address->host           = sin.sin6_addr;
-        address->port           = ENET_NET_TO_HOST_16(sin.sin6_port);
-        address->sin6_scope_id  = sin.sin6_scope_id;
+        condition = ENET_SOCKET_WAIT_NONE;
 
-        return 0;
-    }
+        if (pollCount == 0) {
+            return 0;
+        }
 
-    int ENetSocket::listen(int backlog)
-    {
-        return ::listen(m_socket, backlog < 0 ? SOMAXCONN : backlog);
-    }
+        if (pollSocket.revents & POLLOUT) {
+            condition |= ENET_SOCKET_WAIT_SEND;
+        }
 
-    int ENetSocket::set_option(ENetSocketOption option, int value)
-    {
-        int result = -1;
+        if (pollSocket.revents & POLLIN) {
+            condition |= ENET_SOCKET_WAIT_RECEIVE;
+        }
 
-        switch (option) {
-            case ENET_SOCKOPT_NONBLOCK:
-                result = fcntl(m_socket, F_SETFL,
-                               (value ? O_NONBLOCK : 0) | (fcntl(m_socket, F_GETFL) & ~O_NONBLOCK));
-                break;
+        return 0;
+    } /* enet_socket_wait */
 
-            case ENET_SOCKOPT_BROADCAST:
-                result =
-                    setsockopt(m_socket, SOL_SOCKET, SO_BROADCAST, (char *)&value, sizeof(int));
-                break;
+    /** Returns the descriptor that becomes readable when datagrams arrive: the socket itself, or
+     *  the ring of the io_uring backend, which takes the datagrams off the socket.
+     */
+    int ENetSocket::wait_handle()
+    {
+    #ifdef ENET_HAS_IO_URING
+        if (this->uring != nullptr) {
+            return this->uring->ringFD;
+        }
+    #endif
 
-            case ENET_SOCKOPT_REUSEADDR:
-                result =
-                    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, (char *)&value, sizeof(int));
-                break;
+        return m_socket;
+    }
 
-            case ENET_SOCKOPT_RCVBUF:
-                result = setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, (char *)&value, sizeof(int));
-                break;
+    #ifdef ENET_HAS_IO_URING
 
-            case ENET_SOCKOPT_SNDBUF:
-                result = setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, (char *)&value, sizeof(int));
-                break;
+    #define ENET_URING_RECEIVE ((enet_uint64) -1) /**< user data of the multishot recvmsg */
+    #define ENET_URING_CANCEL  ((enet_uint64) -2) /**< user data of the request cancelling it */
 
-            case ENET_SOCKOPT_RCVTIMEO: {
-                struct timeval timeVal;
-                timeVal.tv_sec  = value / 1000;
-                timeVal.tv_usec = (value % 1000) * 1000;
-                result          = setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeVal,
-                                    sizeof(struct timeval));
-                break;
-            }
+    /** space for the address in a receive buffer, rounded up so that the control data stays aligned */
+    #define ENET_URING_NAME_SIZE ((sizeof(struct sockaddr_in6) + 7) & ~(size_t) 7)
 
-            case ENET_SOCKOPT_SNDTIMEO: {
-                struct timeval timeVal;
-                timeVal.tv_sec  = value / 1000;
-                timeVal.tv_usec = (value % 1000) * 1000;
-                result          = setsockopt(m_socket, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeVal,
-                                    sizeof(struct timeval));
-                break;
-            }
+    ENetUring::~ENetUring()
+    {
+        io_uring_sqe *sqe;
 
-            case ENET_SOCKOPT_NODELAY:
-                result =
-                    setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, (char *)&value, sizeof(int));
-                break;
+        /* the kernel may write into the provided buffers until the receive is cancelled */
+        if (this->receiveArmed && (sqe = this->prepare()) != nullptr)
+        {
+            sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+            sqe->fd        = -1;
+            sqe->addr      = ENET_URING_RECEIVE;
+            sqe->user_data = ENET_URING_CANCEL;
 
-            case ENET_SOCKOPT_IPV6_V6ONLY:
-                result =
-                    setsockopt(m_socket, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&value, sizeof(int));
-                break;
+            do {
+                if (this->enter(1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                    break;
+                }
 
-            default:
-                break;
+                this->reap();
+            } while (this->receiveArmed);
         }
-        return result == -1 ? -1 : 0;
-    } /* set_option */
 
-    int ENetSocket::get_option(ENetSocketOption option, int *value)
-    {
-        int result = -1;
-        socklen_t len;
+        if (this->bufferRing != nullptr) {
+            munmap(this->bufferRing, this->bufferRingSize);
+        }
 
-        switch (option) {
-            case ENET_SOCKOPT_ERROR:
-                len    = sizeof(int);
-                result = getsockopt(m_socket, SOL_SOCKET, SO_ERROR, value, &len);
-                break;
+        if (this->sqes != nullptr) {
+            munmap(this->sqes, this->sqesSize);
+        }
 
-            default:
-                break;
+        if (this->ring != nullptr) {
+            munmap(this->ring, this->ringSize);
+        }
+
+        if (this->ringFD != -1) {
+            close(this->ringFD);
         }
-        return result == -1 ? -1 : 0;
     }
 
-    int ENetSocket::connect(const ENetAddress *address)
+    /** Sets up the rings, provides the receive buffers and arms the receive.
+     *  @param socket datagram socket to move the datagrams of
+     *  @param bufferCount number of receive buffers, a power of two
+     *  @param payloadSize bytes of datagram data a receive buffer holds
+     *  @param controlSize bytes of ancillary data a receive buffer holds
+     *  @retval 0 on success
+     *  @retval < 0 if the kernel lacks io_uring, provided buffer rings or multishot recvmsg
+     */
+    int ENetUring::open(int socket, size_t bufferCount, size_t payloadSize, size_t controlSize)
     {
-        struct sockaddr_in6 sin;
-        int result;
+        io_uring_params  params             = {};
+        io_uring_buf_reg bufferRegistration = {};
+        enet_uint8 *     base;
 
-        memset(&sin, 0, sizeof(struct sockaddr_in6));
+        params.flags      = IORING_SETUP_CQSIZE;
+        params.cq_entries = (unsigned) (bufferCount + 2 * ENET_MESSAGE_MAXIMUM);
 
-        sin.sin6_family     = AF_INET6;
-        sin.sin6_port       = ENET_HOST_TO_NET_16(address->port);
-        sin.sin6_addr       = address->host;
-        sin.sin6_scope_id   = address->sin6_scope_id;
+        this->socket = socket;
+        this->ringFD = (int) syscall(__NR_io_uring_setup, ENET_MESSAGE_MAXIMUM, &params);
 
-        result = ::connect(m_socket, (struct sockaddr *)&sin, sizeof(struct sockaddr_in6));
-        if (result == -1 && errno == EINPROGRESS) {
-            return 0;
+        if (this->ringFD < 0) {
+            this->ringFD = -1;
+            return -1;
         }
 
-        return result;
-    }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+            return -1;
+        }
 
-    int ENetSocket::accept(ENetAddress *address)
-    {
-        int result;
-        struct sockaddr_in6 sin;
-        socklen_t           sinLength = sizeof(struct sockaddr_in6);
+        this->ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                  params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        this->ring     = mmap(nullptr, this->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringFD,
+                              IORING_OFF_SQ_RING);
 
-        result = ::accept(m_socket, address != nullptr ? (struct sockaddr *)&sin : nullptr,
-                          address != nullptr ? &sinLength : nullptr);
+        if (this->ring == MAP_FAILED) {
+            this->ring = nullptr;
+            return -1;
+        }
 
-        if (result == -1) {
-            return ENET_SOCKET_NULL;
+        this->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        this->sqes     = (io_uring_sqe *) mmap(nullptr, this->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                               this->ringFD, IORING_OFF_SQES);
+
+        if (this->sqes == MAP_FAILED) {
+            this->sqes = nullptr;
+            return -1;
         }
 
-        if (address != nullptr)
+        base            = (enet_uint8 *) this->ring;
+        this->sqHead    = (unsigned *) (base + params.sq_off.head);
+        this->sqTail    = (unsigned *) (base + params.sq_off.tail);
+        this->sqArray   = (unsigned *) (base + params.sq_off.array);
+        this->sqMask    = *(unsigned *) (base + params.sq_off.ring_mask);
+        this->sqEntries = params.sq_entries;
+        this->cqHead    = (unsigned *) (base + params.cq_off.head);
+        this->cqTail    = (unsigned *) (base + params.cq_off.tail);
+        this->cqMask    = *(unsigned *) (base + params.cq_off.ring_mask);
+        this->cqes      = (io_uring_cqe *) (base + params.cq_off.cqes);
+
+        /* the buffer ring is read by the kernel and has to be page aligned */
+        this->bufferRingSize = bufferCount * sizeof(io_uring_buf);
+        this->bufferRing     = (io_uring_buf_ring *) mmap(nullptr, this->bufferRingSize, PROT_READ | PROT_WRITE,
+                                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (this->bufferRing == MAP_FAILED) {
+            this->bufferRing = nullptr;
+            return -1;
+        }
+
+        bufferRegistration.ring_addr    = (enet_uint64) (uintptr_t) this->bufferRing;
+        bufferRegistration.ring_entries = (enet_uint32) bufferCount;
+        bufferRegistration.bgid         = 0;
+
+        if (syscall(__NR_io_uring_register, this->ringFD, IORING_REGISTER_PBUF_RING, &bufferRegistration, 1) < 0) {
+            return -1;
+        }
+
+        /* each buffer starts with the recvmsg header, followed by the address and the ancillary data */
+        this->bufferCount = (enet_uint16) bufferCount;
+        this->bufferSize  = (sizeof(io_uring_recvmsg_out) + ENET_URING_NAME_SIZE + controlSize + payloadSize + 15) & ~(size_t) 15;
+
+        this->bufferData.resize(bufferCount * this->bufferSize);
+        this->receiveBuffers.resize(bufferCount);
+        this->heldBuffers.reserve(bufferCount);
+        this->completions.reserve(bufferCount);
+
+        for (size_t i = 0; i < bufferCount; ++i)
         {
-            address->host = sin.sin6_addr;
-            address->port = ENET_NET_TO_HOST_16 (sin.sin6_port);
-            address->sin6_scope_id = sin.sin6_scope_id;
+            this->receiveBuffers[i].data =
+                &this->bufferData[i * this->bufferSize + sizeof(io_uring_recvmsg_out) + ENET_URING_NAME_SIZE + controlSize];
+
+            this->provide_buffer((enet_uint16) i);
         }
 
-        return result;
+        ENET_ATOMIC_WRITE(&this->bufferRing->tail, this->bufferTail);
+
+        this->receiveHeader.msg_namelen    = ENET_URING_NAME_SIZE;
+        this->receiveHeader.msg_controllen = controlSize;
+
+        /* kernels without multishot recvmsg fail it right away */
+        if (this->arm_receive() < 0 || this->enter(0, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+            return -1;
+        }
+
+        this->reap();
+
+        return this->receiveArmed ? 0 : -1;
     }
 
-    int ENetSocket::shutdown(ENetSocketShutdown how) { return ::shutdown(m_socket, (int)how); }
+    /** Returns the next free submission queue entry, cleared, or nullptr if the queue is full. */
+    io_uring_sqe *ENetUring::prepare()
+    {
+        unsigned      tail = *this->sqTail + this->sqPending;
+        io_uring_sqe *sqe;
 
-    ENetSocket::~ENetSocket()
+        if (this->sqes == nullptr || tail - ENET_ATOMIC_READ(this->sqHead) >= this->sqEntries) {
+            return nullptr;
+        }
+
+        sqe = &this->sqes[tail & this->sqMask];
+        memset(sqe, 0, sizeof(io_uring_sqe));
+
+        this->sqArray[tail & this->sqMask] = tail & this->sqMask;
+        ++this->sqPending;
+
+        return sqe;
+    }
+
+    /** Publishes the prepared entries and submits every entry the kernel has not consumed yet.
+     *  @param waitCount number of completions to wait for
+     *  @returns the result of io_uring_enter
+     */
+    int ENetUring::enter(unsigned waitCount, unsigned flags, void *argument, size_t argumentSize)
     {
-        if (m_socket != -1)
+        unsigned submitCount;
+
+        if (this->sqPending > 0)
         {
-            close(m_socket);
+            ENET_ATOMIC_WRITE(this->sqTail, *this->sqTail + this->sqPending);
+            this->sqPending = 0;
         }
+
+        submitCount = *this->sqTail - ENET_ATOMIC_READ(this->sqHead);
+
+        return (int) syscall(__NR_io_uring_enter, this->ringFD, submitCount, waitCount, flags, argument, argumentSize);
     }
 
-    int ENetSocket::send(const ENetAddress *address, const ENetBuffer *buffers, size_t bufferCount)
+    /** Takes every completion off the completion queue: received datagrams are kept in completions
+     *  until receive_many() takes them, and send results are stored in sendResults.
+     */
+    void ENetUring::reap()
     {
-        struct msghdr msgHdr;
-        struct sockaddr_in6 sin;
-        int sentLength;
-
-        memset(&msgHdr, 0, sizeof(struct msghdr));
+        unsigned head = *this->cqHead;
+        unsigned tail = ENET_ATOMIC_READ(this->cqTail);
 
-        if (address != nullptr)
+        for (; head != tail; ++head)
         {
-            memset(&sin, 0, sizeof(struct sockaddr_in6));
+            io_uring_cqe *cqe = &this->cqes[head & this->cqMask];
 
-            sin.sin6_family     = AF_INET6;
-            sin.sin6_port       = ENET_HOST_TO_NET_16(address->port);
-            sin.sin6_addr       = address->host;
-            sin.sin6_scope_id   = address->sin6_scope_id;
+            if (cqe->user_data == ENET_URING_RECEIVE)
+            {
+                /* the receive stops on errors and when it runs out of buffers */
+                if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                    this->receiveArmed = 0;
+                }
 
-            msgHdr.msg_name    = &sin;
-            msgHdr.msg_namelen = sizeof(struct sockaddr_in6);
+                if (cqe->flags & IORING_CQE_F_BUFFER) {
+                    this->completions.push_back({cqe->res, (enet_uint16) (cqe->flags >> IORING_CQE_BUFFER_SHIFT)});
+                }
+            }
+            else if (cqe->user_data < ENET_MESSAGE_MAXIMUM)
+            {
+                this->sendResults[cqe->user_data] = cqe->res;
+                --this->sendPending;
+            }
         }
 
-        msgHdr.msg_iov    = (struct iovec *) buffers;
-        msgHdr.msg_iovlen = bufferCount;
-
-        sentLength = sendmsg(m_socket, &msgHdr, MSG_NOSIGNAL);
+        ENET_ATOMIC_WRITE(this->cqHead, head);
+    }
 
-        if (sentLength == -1) {
-            if (errno == EWOULDBLOCK) {
-                return 0;
-            }
+    /** Queues a multishot recvmsg selecting its buffers from the provided buffer ring. */
+    int ENetUring::arm_receive()
+    {
+        io_uring_sqe *sqe = this->prepare();
 
+        if (sqe == nullptr) {
             return -1;
         }
 
-        return sentLength;
+        sqe->opcode    = IORING_OP_RECVMSG;
+        sqe->fd        = this->socket;
+        sqe->addr      = (enet_uint64) (uintptr_t) &this->receiveHeader;
+        sqe->len       = 1;
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        sqe->user_data = ENET_URING_RECEIVE;
+
+        this->receiveArmed = 1;
+
+        return 0;
     }
 
-    int ENetSocket::receive(ENetAddress *address, ENetBuffer *buffers, size_t bufferCount)
+    /** Adds a buffer to the provided buffer ring; the kernel sees it once the ring tail is written. */
+    void ENetUring::provide_buffer(enet_uint16 bufferID)
     {
-        struct msghdr msgHdr;
-        struct sockaddr_in6 sin;
-        int recvLength;
-
-        memset(&msgHdr, 0, sizeof(struct msghdr));
+        /* bufs is declared as a flexible array after an empty struct, which is not empty in C++ */
+        io_uring_buf *buffer = (io_uring_buf *) this->bufferRing + (this->bufferTail & (this->bufferCount - 1));
 
-        if (address != nullptr)
-        {
-            msgHdr.msg_name    = &sin;
-            msgHdr.msg_namelen = sizeof(struct sockaddr_in6);
-        }
+        buffer->addr = (enet_uint64) (uintptr_t) &this->bufferData[bufferID * this->bufferSize];
+        buffer->len  = (enet_uint32) this->bufferSize;
+        buffer->bid  = bufferID;
 
-        msgHdr.msg_iov    = (struct iovec *) buffers;
-        msgHdr.msg_iovlen = bufferCount;
+        ++this->bufferTail;
+    }
 
-        recvLength = recvmsg(m_socket, &msgHdr, MSG_NOSIGNAL);
+    /** Takes up to messageCount received datagrams off the completion queue. The messages are
+     *  pointed at the provided buffers holding them, which are given back to the kernel by the next call.
+     *  @returns the number of datagrams received, 0 if none were pending, or -1 on failure
+     *  @remarks a datagram that did not fit into its buffer is reported with a dataLength of 0.
+     */
+    int ENetUring::receive_many(ENetSocketMessage *messages, size_t messageCount)
+    {
+        int receivedCount = 0;
 
-        if (recvLength == -1) {
-            if (errno == EWOULDBLOCK) {
-                return 0;
+        if (!this->heldBuffers.empty())
+        {
+            for (auto bufferID : this->heldBuffers) {
+                this->provide_buffer(bufferID);
             }
 
-            return -1;
+            this->heldBuffers.clear();
+            ENET_ATOMIC_WRITE(&this->bufferRing->tail, this->bufferTail);
         }
 
-        if (msgHdr.msg_flags & MSG_TRUNC) {
-            return -1;
+        if (this->completionIndex >= this->completions.size())
+        {
+            this->completions.clear();
+            this->completionIndex = 0;
+            this->reap();
         }
 
-        if (address != nullptr)
+        if (!this->receiveArmed)
         {
-            address->host           = sin.sin6_addr;
-            address->port           = ENET_NET_TO_HOST_16(sin.sin6_port);
-            address->sin6_scope_id  = sin.sin6_scope_id;
+            if (this->arm_receive() < 0 || this->enter(0, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+                return -1;
+            }
+
+            this->reap();
         }
 
-        return recvLength;
-    }
+        while ((size_t) receivedCount < messageCount && this->completionIndex < this->completions.size())
+        {
+            const Completion &     completion = this->completions[this->completionIndex++];
+            io_uring_recvmsg_out * header     = (io_uring_recvmsg_out *) &this->bufferData[completion.bufferID * this->bufferSize];
+            struct sockaddr_in6 *  sin        = (struct sockaddr_in6 *) (header + 1);
+            ENetSocketMessage *    message    = &messages[receivedCount++];
 
-    int ENetSocket::select(ENetSocketSet *readSet, ENetSocketSet *writeSet, enet_uint32 timeout)
-    {
-        timeval timeVal = {timeout / 1000, (timeout % 1000) * 1000};
+            this->heldBuffers.push_back(completion.bufferID);
 
-        return ::select(m_socket + 1, readSet, writeSet, nullptr, &timeVal);
-    }
+            message->buffers     = &this->receiveBuffers[completion.bufferID];
+            message->bufferCount = 1;
+            message->dataLength  = 0;
+            message->segmentSize = 0;
 
-    int ENetSocket::wait(enet_uint32 &condition, enet_uint64 timeout)
+            if (completion.result < 0 || header->flags & MSG_TRUNC) {
+                continue;
+            }
+
+            message->address.host          = sin->sin6_addr;
+            message->address.port          = ENET_NET_TO_HOST_16(sin->sin6_port);
+            message->address.sin6_scope_id = sin->sin6_scope_id;
+            message->buffers->dataLength   = header->payloadlen;
+            message->dataLength            = header->payloadlen;
+
+        #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+            if (header->controllen > 0)
+            {
+                struct msghdr msgHdr = {};
+
+                msgHdr.msg_control    = (enet_uint8 *) sin + ENET_URING_NAME_SIZE;
+                msgHdr.msg_controllen = header->controllen;
+
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgHdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgHdr, cmsg))
+                {
+                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+                    {
+                        int segmentSize;
+
+                        memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(int));
+                        message->segmentSize = segmentSize;
+                    }
+                }
+            }
+        #endif
+        }
+
+        return receivedCount;
+    } /* ENetUring::receive_many */
+
+    /** Queues one sendmsg per datagram, linked so that the first one the socket refuses cancels the
+     *  rest, submits them with one system call and waits for their completion.
+     *  @returns the number of datagrams sent, 0 if the socket would block, or -1 on failure
+     */
+    int ENetUring::send_many(ENetSocketMessage *messages, size_t messageCount)
     {
-        pollfd pollSocket = {
-            m_socket,
-            0,
-        };
+        int sentCount = 0;
 
-        if (condition & ENET_SOCKET_WAIT_SEND)
-        {
-            pollSocket.events |= POLLOUT;
+        messageCount = std::min(messageCount, (size_t) (this->sqEntries - (*this->sqTail + this->sqPending - ENET_ATOMIC_READ(this->sqHead))));
+        if (messageCount > ENET_MESSAGE_MAXIMUM) {
+            messageCount = ENET_MESSAGE_MAXIMUM;
         }
 
-        if (condition & ENET_SOCKET_WAIT_RECEIVE)
+        if (messageCount == 0) {
+            return 0;
+        }
+
+        for (size_t i = 0; i < messageCount; ++i)
         {
-            pollSocket.events |= POLLIN;
+            io_uring_sqe *       sqe    = this->prepare();
+            struct msghdr *      msgHdr = &this->sendHeaders[i];
+            struct sockaddr_in6 *sin    = &this->sendNames[i];
+
+            memset(sin, 0, sizeof(struct sockaddr_in6));
+            memset(msgHdr, 0, sizeof(struct msghdr));
+
+            sin->sin6_family   = AF_INET6;
+            sin->sin6_port     = ENET_HOST_TO_NET_16(messages[i].address.port);
+            sin->sin6_addr     = messages[i].address.host;
+            sin->sin6_scope_id = messages[i].address.sin6_scope_id;
+
+            msgHdr->msg_name    = sin;
+            msgHdr->msg_namelen = sizeof(struct sockaddr_in6);
+            msgHdr->msg_iov     = (struct iovec *) messages[i].buffers;
+            msgHdr->msg_iovlen  = messages[i].bufferCount;
+
+        #ifdef ENET_HAS_SEGMENTATION_OFFLOAD
+            if (messages[i].segmentSize > 0)
+            {
+                struct cmsghdr *cmsg;
+                enet_uint16 segmentSize = (enet_uint16) messages[i].segmentSize;
+
+                memset(this->sendControl[i], 0, sizeof(this->sendControl[i]));
+
+                msgHdr->msg_control    = this->sendControl[i];
+                msgHdr->msg_controllen = sizeof(this->sendControl[i]);
+
+                cmsg             = CMSG_FIRSTHDR(msgHdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type  = UDP_SEGMENT;
+                cmsg->cmsg_len   = CMSG_LEN(sizeof(enet_uint16));
+                memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(enet_uint16));
+            }
+        #endif
+
+            sqe->opcode    = IORING_OP_SENDMSG;
+            sqe->fd        = this->socket;
+            sqe->addr      = (enet_uint64) (uintptr_t) msgHdr;
+            sqe->len       = 1;
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+            sqe->flags     = i + 1 < messageCount ? IOSQE_IO_LINK : 0;
+            sqe->user_data = i;
+
+            this->sendResults[i] = -ECANCELED;
         }
 
-        int pollCount = ::poll(&pollSocket, 1, timeout);
+        this->sendPending = (unsigned) messageCount;
 
-        if (pollCount < 0) {
-            if (errno == EINTR && condition & ENET_SOCKET_WAIT_INTERRUPT)
+        /* the datagram buffers are released once this returns, so every send has to be complete */
+        do {
+            if (this->enter(this->sendPending, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                errno != EINTR && errno != EAGAIN && errno != EBUSY)
             {
-                condition = ENET_SOCKET_WAIT_INTERRUPT;
+                return -1;
+            }
+
+            this->reap();
+        } while (this->sendPending > 0);
 
+        for (; (size_t) sentCount < messageCount && this->sendResults[sentCount] >= 0; ++sentCount)
+        {
+            messages[sentCount].dataLength = this->sendResults[sentCount];
+        }
+
+        if (sentCount == 0)
+        {
+            if (this->sendResults[0] == -EWOULDBLOCK) {
                 return 0;
             }
 
+            errno = -this->sendResults[0];
             return -1;
         }
 
-        condition = ENET_SOCKET_WAIT_NONE;
+        return sentCount;
+    } /* ENetUring::send_many */
 
-        if (pollCount == 0) {
-            return 0;
-        }
+    /** Waits for received datagrams; send readiness is not waited on, as sends do not block.
+     *  @param condition ENET_SOCKET_WAIT_RECEIVE on return if datagrams are ready to be taken
+     *  @param timeout milliseconds to wait
+     */
+    int ENetUring::wait(enet_uint32 &condition, enet_uint64 timeout)
+    {
+        struct __kernel_timespec timeSpec = {(long long) (timeout / 1000), (long long) (timeout % 1000) * 1000000};
+        io_uring_getevents_arg   argument = {};
 
-        if (pollSocket.revents & POLLOUT) {
-            condition |= ENET_SOCKET_WAIT_SEND;
-        }
+        argument.ts = (enet_uint64) (uintptr_t) &timeSpec;
 
-        if (pollSocket.revents & POLLIN) {
-            condition |= ENET_SOCKET_WAIT_RECEIVE;
+        this->reap();
+
+        if (this->completionIndex >= this->completions.size() && this->receiveArmed)
+        {
+            if (this->enter(1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument)) < 0 && errno != ETIME)
+            {
+                if (errno == EINTR && condition & ENET_SOCKET_WAIT_INTERRUPT)
+                {
+                    condition = ENET_SOCKET_WAIT_INTERRUPT;
+
+                    return 0;
+                }
+
+                return -1;
+            }
+
+            this->reap();
         }
 
+        /* a receive that stopped is armed again by the next receive_many() */
+        condition = this->completionIndex < this->completions.size() || !this->receiveArmed ? ENET_SOCKET_WAIT_RECEIVE
+                                                                                              : ENET_SOCKET_WAIT_NONE;
+
         return 0;
-    } /* enet_socket_wait */
+    } /* ENetUring::wait */
+
+    /** Whether datagrams may be waiting that a wait on the ring descriptor would not report: completions
+     *  already reaped, for instance by send_many(), buffers held past a full receive pass, or a
+     *  multishot receive that stopped when the provided buffers ran out. */
+    bool ENetUring::pending()
+    {
+        return this->completionIndex < this->completions.size() || !this->heldBuffers.empty() || !this->receiveArmed;
+    }
+
+    #endif // ENET_HAS_IO_URING
 
     #endif // !_WIN32
 
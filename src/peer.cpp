@@ -22,7 +22,7 @@ ENetPeerState ENetPeer::get_state()
 
 enet_uint32 ENetPeer::get_rtt()
 {
-    return this->roundTripTime;
+    return this->roundTripTime / ENET_TIME_MILLISECOND;
 }
 
 enet_uint64 ENetPeer::get_packets_sent()
@@ -173,41 +173,35 @@ void ENetPeer::dispatch_incoming_unreliable_commands(ENetChannel *channel)
         droppedCommand = currentCommand;
     }
 
-    enet_peer_remove_incoming_commands(&channel->incomingUnreliableCommands, enet_list_begin(&channel->incomingUnreliableCommands), droppedCommand);
+    enet_peer_remove_incoming_commands(host, &channel->incomingUnreliableCommands, enet_list_begin(&channel->incomingUnreliableCommands), droppedCommand);
 }
 
 void ENetPeer::dispatch_incoming_reliable_commands(ENetChannel *channel)
 {
-    ENetListIterator currentCommand;
+    ENetIncomingCommand *incomingCommand;
+    bool dispatched = false;
 
-    for (currentCommand = enet_list_begin(&channel->incomingReliableCommands);
-            currentCommand != enet_list_end(&channel->incomingReliableCommands);
-            currentCommand = enet_list_next(currentCommand))
+    while ((incomingCommand = channel->incomingReliableCommands.find(channel->incomingReliableSequenceNumber + 1)) != nullptr &&
+            incomingCommand->fragmentsRemaining <= 0)
     {
-        ENetIncomingCommand *incomingCommand = (ENetIncomingCommand *)currentCommand;
-
-        if (incomingCommand->fragmentsRemaining > 0 || incomingCommand->reliableSequenceNumber != (enet_uint16)(channel->incomingReliableSequenceNumber + 1))
-        {
-            break;
-        }
-
+        channel->incomingReliableCommands.erase(incomingCommand);
         channel->incomingReliableSequenceNumber = incomingCommand->reliableSequenceNumber;
 
         if (incomingCommand->fragmentCount > 0)
         {
             channel->incomingReliableSequenceNumber += incomingCommand->fragmentCount - 1;
         }
+
+        enet_list_insert(enet_list_end(&this->dispatchedCommands), incomingCommand);
+        dispatched = true;
     }
 
-    if (currentCommand == enet_list_begin(&channel->incomingReliableCommands))
+    if (!dispatched)
     {
         return;
     }
 
     channel->incomingUnreliableSequenceNumber = 0;
-    enet_list_move(enet_list_end(&this->dispatchedCommands),
-            enet_list_begin(&channel->incomingReliableCommands),
-            enet_list_previous(currentCommand));
 
     if (!this->needsDispatch)
     {
@@ -239,7 +233,13 @@ void ENetPeer::queue_acknowledgement(const ENetProtocol *command, enet_uint16 se
 
     ENetAcknowledgement acknowledgement = { *command, sentTime };
 
-    this->acknowledgements.insert(this->acknowledgements.end(), acknowledgement);
+    this->acknowledgements.push_back(acknowledgement);
+
+    if (!this->needsSend)
+    {
+        host->sendQueue.push_back(this);
+        this->needsSend = 1;
+    }
 }
 
 ENetIncomingCommand *ENetPeer::queue_incoming_command(const ENetProtocol *command,
@@ -314,33 +314,9 @@ ENetIncomingCommand *ENetPeer::queue_incoming_command(const ENetProtocol *comman
                 return discardCommand(packet, fragmentCount);
             }
 
-            for (currentCommand = enet_list_previous(enet_list_end(&channel->incomingReliableCommands));
-                    currentCommand != enet_list_end(&channel->incomingReliableCommands);
-                    currentCommand = enet_list_previous(currentCommand))
+            if (channel->incomingReliableCommands.find(reliableSequenceNumber) != nullptr)
             {
-                incomingCommand = (ENetIncomingCommand *)currentCommand;
-
-                if (reliableSequenceNumber >= channel->incomingReliableSequenceNumber)
-                {
-                    if (incomingCommand->reliableSequenceNumber < channel->incomingReliableSequenceNumber)
-                    {
-                        continue;
-                    }
-                }
-                else if (incomingCommand->reliableSequenceNumber >= channel->incomingReliableSequenceNumber)
-                {
-                    break;
-                }
-
-                if (incomingCommand->reliableSequenceNumber <= reliableSequenceNumber)
-                {
-                    if (incomingCommand->reliableSequenceNumber < reliableSequenceNumber)
-                    {
-                        break;
-                    }
-
-                    return discardCommand(packet, fragmentCount);
-                }
+                return discardCommand(packet, fragmentCount);
             }
             break;
 
@@ -411,13 +387,13 @@ ENetIncomingCommand *ENetPeer::queue_incoming_command(const ENetProtocol *comman
         return notifyError(packet);
     }
 
-    packet = enet_packet_create(data, dataLength, flags);
+    packet = this->host->create_received_packet(data, dataLength, flags);
     if (packet == nullptr)
     {
         return notifyError(packet);
     }
 
-    incomingCommand = (ENetIncomingCommand *)enet_malloc(sizeof(ENetIncomingCommand));
+    incomingCommand = (ENetIncomingCommand *)this->host->incomingCommandPool.allocate();
     if (incomingCommand == nullptr)
     {
         return notifyError(packet);
@@ -433,14 +409,18 @@ ENetIncomingCommand *ENetPeer::queue_incoming_command(const ENetProtocol *comman
 
     if (fragmentCount > 0)
     {
-        if (fragmentCount <= ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
+        if (fragmentCount <= ENET_INCOMING_COMMAND_FRAGMENT_WORDS * 32)
+        {
+            incomingCommand->fragments = incomingCommand->fragmentBitmap;
+        }
+        else if (fragmentCount <= ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
         {
             incomingCommand->fragments = (enet_uint32 *)enet_malloc((fragmentCount + 31) / 32 * sizeof(enet_uint32));
         }
 
         if (incomingCommand->fragments == nullptr)
         {
-            enet_free(incomingCommand);
+            this->host->incomingCommandPool.release(incomingCommand);
 
             return notifyError(packet);
         }
@@ -454,16 +434,25 @@ ENetIncomingCommand *ENetPeer::queue_incoming_command(const ENetProtocol *comman
         this->totalWaitingData += packet->dataLength;
     }
 
-    enet_list_insert(enet_list_next(currentCommand), incomingCommand);
-
     switch (command->header.command & ENET_PROTOCOL_COMMAND_MASK)
     {
         case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
         case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+            if (channel->incomingReliableCommands.insert(incomingCommand) < 0)
+            {
+                --packet->referenceCount;
+                this->totalWaitingData -= packet->dataLength;
+                enet_peer_free_incoming_command(this->host, incomingCommand);
+
+                return notifyError(packet);
+            }
+
             this->dispatch_incoming_reliable_commands(channel);
             break;
 
         default:
+            enet_list_insert(enet_list_next(currentCommand), incomingCommand);
+
             this->dispatch_incoming_unreliable_commands(channel);
             break;
     }
@@ -477,7 +466,7 @@ ENetOutgoingCommand *ENetPeer::queue_outgoing_command(const ENetProtocol *comman
         enet_uint32 offset,
         enet_uint16 length)
 {
-    ENetOutgoingCommand *outgoingCommand = (ENetOutgoingCommand *)enet_malloc(sizeof(ENetOutgoingCommand));
+    ENetOutgoingCommand *outgoingCommand = (ENetOutgoingCommand *)this->host->outgoingCommandPool.allocate();
 
     if (outgoingCommand == nullptr)
     {
@@ -538,6 +527,7 @@ void ENetPeer::setup_outgoing_command(ENetOutgoingCommand *outgoingCommand)
     }
 
     outgoingCommand->sendAttempts = 0;
+    outgoingCommand->inTransit = 0;
     outgoingCommand->sentTime = 0;
     outgoingCommand->roundTripTimeout = 0;
     outgoingCommand->roundTripTimeoutLimit = 0;
@@ -566,34 +556,36 @@ void ENetPeer::setup_outgoing_command(ENetOutgoingCommand *outgoingCommand)
     {
         enet_list_insert(enet_list_end(&this->outgoingUnreliableCommands), outgoingCommand);
     }
+
+    if (!this->needsSend)
+    {
+        host->sendQueue.push_back(this);
+        this->needsSend = 1;
+    }
 }
 
 void ENetPeer::reset_queues()
 {
+    /* needsDispatch stays set while the peer sits in the host's dispatch queue; the stale entry
+     * is skipped and cleared when it is popped. */
 
-    if (this->needsDispatch)
-    {
-        this->needsDispatch = 0;
-    }
-
-    while (!this->acknowledgements.empty())
-    {
-        this->acknowledgements.pop_front();
-    }
+    this->acknowledgements.clear();
 
-    enet_peer_reset_outgoing_commands(&this->sentReliableCommands);
-    enet_peer_reset_outgoing_commands(this->sentUnreliableCommands);
-    enet_peer_reset_outgoing_commands(&this->outgoingReliableCommands);
-    enet_peer_reset_outgoing_commands(&this->outgoingUnreliableCommands);
-    enet_peer_reset_incoming_commands(&this->dispatchedCommands);
+    enet_peer_reset_outgoing_commands(this->host, &this->sentReliableCommands);
+    enet_peer_reset_outgoing_commands(this->host, this->sentUnreliableCommands);
+    enet_peer_reset_outgoing_commands(this->host, &this->outgoingReliableCommands);
+    enet_peer_reset_outgoing_commands(this->host, &this->outgoingUnreliableCommands);
+    enet_peer_reset_incoming_commands(this->host, &this->dispatchedCommands);
+    this->sentControlCommands.destroy();
 
     if (this->channels != nullptr && this->channelCount > 0)
     {
         for (auto channel = this->channels; channel < &this->channels[this->channelCount];
                 ++channel)
         {
-            enet_peer_reset_incoming_commands(&channel->incomingReliableCommands);
-            enet_peer_reset_incoming_commands(&channel->incomingUnreliableCommands);
+            enet_peer_reset_incoming_commands(this->host, channel->incomingReliableCommands);
+            enet_peer_reset_incoming_commands(this->host, &channel->incomingUnreliableCommands);
+            channel->sentReliableCommands.destroy();
         }
 
         enet_free(this->channels);
@@ -711,6 +703,11 @@ void ENetPeer::reset()
 {
     this->on_disconnect();
 
+    if (this->state != ENetPeerState::DISCONNECTED)
+    {
+        this->host->release_peer(this);
+    }
+
     // We don't want to reset connectID here, otherwise, we can't get it in the Disconnect event
     // peer->connectID                     = 0;
     this->outgoingPeerID = ENET_PROTOCOL_MAXIMUM_PEER_ID;
@@ -745,11 +742,11 @@ void ENetPeer::reset()
     this->timeoutLimit = ENET_PEER_TIMEOUT_LIMIT;
     this->timeoutMinimum = ENET_PEER_TIMEOUT_MINIMUM;
     this->timeoutMaximum = ENET_PEER_TIMEOUT_MAXIMUM;
-    this->lastRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME;
-    this->lowestRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME;
+    this->lastRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME * ENET_TIME_MILLISECOND;
+    this->lowestRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME * ENET_TIME_MILLISECOND;
     this->lastRoundTripTimeVariance = 0;
     this->highestRoundTripTimeVariance = 0;
-    this->roundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME;
+    this->roundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME * ENET_TIME_MILLISECOND;
     this->roundTripTimeVariance = 0;
     this->mtu = this->host->mtu;
     this->reliableDataInTransit = 0;
@@ -759,6 +756,7 @@ void ENetPeer::reset()
     this->outgoingUnsequencedGroup = 0;
     this->eventData = 0;
     this->totalWaitingData = 0;
+    this->capabilities = 0;
 
     this->unsequencedWindow = { 0 };
     this->reset_queues();
@@ -775,6 +773,8 @@ void ENetPeer::timeout(enet_uint32 timeoutLimit, enet_uint32 timeoutMinimum,
 void ENetPeer::ping_interval(enet_uint32 pingInterval)
 {
     this->pingInterval = pingInterval ? pingInterval : ENET_PEER_PING_INTERVAL;
+
+    this->host->schedule_peer(this);
 }
 
 void ENetPeer::ping()
@@ -812,12 +812,7 @@ ENetPacket *ENetPeer::receive(enet_uint8 *channelID)
     packet = incomingCommand->packet;
     --packet->referenceCount;
 
-    if (incomingCommand->fragments != nullptr)
-    {
-        enet_free(incomingCommand->fragments);
-    }
-
-    enet_free(incomingCommand);
+    enet_peer_free_incoming_command(this->host, incomingCommand);
     this->totalWaitingData -= packet->dataLength;
 
     return packet;
@@ -910,7 +905,7 @@ int ENetPeer::send(enet_uint8 channelID, ENetPacket *packet)
                 fragmentLength = packet->dataLength - fragmentOffset;
             }
 
-            fragment = (ENetOutgoingCommand *)enet_malloc(sizeof(ENetOutgoingCommand));
+            fragment = (ENetOutgoingCommand *)this->host->outgoingCommandPool.allocate();
 
             if (fragment == nullptr)
             {
@@ -918,7 +913,7 @@ int ENetPeer::send(enet_uint8 channelID, ENetPacket *packet)
                 {
                     fragment = (ENetOutgoingCommand *)enet_list_remove(enet_list_begin(&fragments));
 
-                    enet_free(fragment);
+                    this->host->outgoingCommandPool.release(fragment);
                 }
 
                 return -1;
@@ -0,0 +1,684 @@
+#define _WINSOCK_DEPRECATED_NO_WARNINGS
+
+#define ENET_IMPLEMENTATION
+#include "enet.h"
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Runs body repeatedly for about a quarter of a second and returns nanoseconds per iteration. */
+template <typename Body>
+static double bench_run(Body body) {
+    using clock = std::chrono::steady_clock;
+
+    size_t iterations = 0;
+    auto   start      = clock::now();
+    auto   elapsed    = clock::duration::zero();
+
+    do {
+        for (int i = 0; i < 256; ++i) {
+            body();
+        }
+
+        iterations += 256;
+        elapsed = clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(250));
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+/* Time stamp counter ticks per nanosecond, or 1 where there is no TSC and figures are in ns. */
+static double bench_cycles_per_ns = 1;
+
+static void bench_calibrate() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    using clock = std::chrono::steady_clock;
+
+    auto        start  = clock::now();
+    enet_uint64 cycles = __rdtsc();
+
+    while (clock::now() - start < std::chrono::milliseconds(100))
+        ;
+
+    bench_cycles_per_ns = (__rdtsc() - cycles) / std::chrono::duration<double, std::nano>(clock::now() - start).count();
+#endif
+}
+
+static enet_uint32 crc32_bytewise(enet_uint32 crc, const enet_uint8 *data, size_t dataLength) {
+    while (dataLength-- > 0) {
+        crc = (crc >> 8) ^ crcTables[0][(crc & 0xFF) ^ *data++];
+    }
+
+    return crc;
+}
+
+static int bench_crc32() {
+    static enet_uint8 data[ENET_PROTOCOL_MAXIMUM_MTU];
+    const size_t      lengths[] = {64, 576, ENET_HOST_DEFAULT_MTU, ENET_PROTOCOL_MAXIMUM_MTU};
+    volatile enet_uint32 sink   = 0;
+    int               result    = 0;
+
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = (enet_uint8)(i * 131 + 7);
+    }
+
+    printf("crc32                 bytes    bytewise     slice-8      pclmul   (MB/s)\n");
+
+    for (size_t length : lengths) {
+        enet_uint32 expected = crc32_bytewise(0xFFFFFFFF, data, length);
+        double      bytewise = bench_run([&] { sink = crc32_bytewise(0xFFFFFFFF, data, length); });
+        double      slice8   = bench_run([&] { sink = enet_crc32_update_slice8(0xFFFFFFFF, data, length); });
+        double      pclmul   = 0;
+
+        if (enet_crc32_update_slice8(0xFFFFFFFF, data, length) != expected) {
+            printf("crc32 slice-8 mismatch at %zu bytes\n", length);
+            result = 1;
+        }
+
+#if defined(ENET_HAS_PCLMUL)
+        if (enet_crc32_select() == enet_crc32_update_pclmul) {
+            if (enet_crc32_update_pclmul(0xFFFFFFFF, data, length) != expected) {
+                printf("crc32 pclmul mismatch at %zu bytes\n", length);
+                result = 1;
+            }
+
+            pclmul = bench_run([&] { sink = enet_crc32_update_pclmul(0xFFFFFFFF, data, length); });
+        }
+#endif
+
+        printf("%27zu %11.0f %11.0f %11.0f\n", length, length * 1e3 / bytewise, length * 1e3 / slice8,
+               pclmul > 0 ? length * 1e3 / pclmul : 0.0);
+    }
+
+    (void)sink;
+    return result;
+}
+
+/*
+ * Game-state traffic: each datagram carries one snapshot of 40 entities as a command header
+ * followed by a 32 byte entity record, the way the send path hands them to the compressor.
+ * Between snapshots entities move a little and a few change state.
+ */
+typedef struct {
+    enet_uint16 id;
+    enet_uint16 flags;
+    int32_t     position[3];
+    int16_t     velocity[3];
+    enet_uint16 heading;
+    enet_uint16 health;
+    enet_uint16 animation;
+} BenchEntity;
+
+typedef struct {
+    enet_uint8  headers[40][12];
+    BenchEntity entities[40];
+    ENetBuffer  buffers[80];
+} BenchSnapshot;
+
+static void bench_snapshot_step(BenchSnapshot *snapshot, enet_uint32 tick) {
+    for (int i = 0; i < 40; ++i) {
+        BenchEntity *entity = &snapshot->entities[i];
+        enet_uint8  *header = snapshot->headers[i];
+
+        if (tick == 0) {
+            memset(entity, 0, sizeof(*entity));
+            entity->id     = (enet_uint16)(1000 + i);
+            entity->health = 100;
+            entity->position[0] = i * 4096;
+            entity->position[2] = (i % 7) * 8192;
+        }
+
+        entity->velocity[0] = (int16_t)(((i * 37 + tick) % 64) - 32);
+        entity->velocity[2] = (int16_t)(((i * 11 + tick * 3) % 64) - 32);
+        entity->position[0] += entity->velocity[0];
+        entity->position[2] += entity->velocity[2];
+        entity->heading      = (enet_uint16)(entity->heading + (i & 3));
+        entity->animation    = (enet_uint16)((tick / 8 + i) % 12);
+
+        if ((tick + i) % 53 == 0) {
+            entity->health = (enet_uint16)(entity->health > 10 ? entity->health - 10 : 100);
+        }
+
+        header[0] = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE;
+        header[1] = 0;
+        header[2] = (enet_uint8)(tick >> 8);
+        header[3] = (enet_uint8)tick;
+        header[4] = 0;
+        header[5] = (enet_uint8)i;
+        header[6] = 0;
+        header[7] = sizeof(BenchEntity);
+        memset(&header[8], 0, 4);
+
+        snapshot->buffers[i * 2].data           = header;
+        snapshot->buffers[i * 2].dataLength     = 8;
+        snapshot->buffers[i * 2 + 1].data       = entity;
+        snapshot->buffers[i * 2 + 1].dataLength = sizeof(BenchEntity);
+    }
+}
+
+static int bench_lz() {
+    static BenchSnapshot snapshot;
+    static enet_uint8    dictionary[40 * (8 + sizeof(BenchEntity))];
+    static enet_uint8    compressed[ENET_PROTOCOL_MAXIMUM_MTU];
+    static enet_uint8    decompressed[ENET_PROTOCOL_MAXIMUM_MTU];
+    const size_t         length = 40 * (8 + sizeof(BenchEntity));
+    int                  result = 0;
+
+    /* both ends prime their dictionary with the layout of the first snapshot */
+    bench_snapshot_step(&snapshot, 0);
+    for (size_t i = 0, offset = 0; i < 80; offset += snapshot.buffers[i].dataLength, ++i) {
+        memcpy(&dictionary[offset], snapshot.buffers[i].data, snapshot.buffers[i].dataLength);
+    }
+
+    printf("lz          dictionary    bytes  compressed    ratio   cycles/B  (compress)  cycles/B  (decompress)\n");
+
+    for (int useDictionary = 0; useDictionary < 2; ++useDictionary) {
+        void       *compressor   = enet_lz_create(useDictionary ? dictionary : nullptr, useDictionary ? sizeof(dictionary) : 0);
+        void       *decompressor = enet_lz_create(useDictionary ? dictionary : nullptr, useDictionary ? sizeof(dictionary) : 0);
+        enet_uint32 tick         = 1;
+        size_t      total        = 0, count = 0, compressedLength = 0;
+
+        for (; tick < 600; ++tick) {
+            bench_snapshot_step(&snapshot, tick);
+            total += enet_lz_compress(compressor, snapshot.buffers, 80, length, compressed, length);
+            ++count;
+        }
+
+        double compress = bench_run([&] {
+            bench_snapshot_step(&snapshot, tick++);
+            compressedLength = enet_lz_compress(compressor, snapshot.buffers, 80, length, compressed, length);
+        });
+        double step = bench_run([&] { bench_snapshot_step(&snapshot, tick++); });
+        double decompress = bench_run([&] {
+            enet_lz_decompress(decompressor, compressed, compressedLength, decompressed, sizeof(decompressed));
+        });
+
+        compressedLength = enet_lz_compress(compressor, snapshot.buffers, 80, length, compressed, length);
+        if (compressedLength == 0 ||
+            enet_lz_decompress(decompressor, compressed, compressedLength, decompressed, sizeof(decompressed)) != length) {
+            printf("lz round trip failed\n");
+            result = 1;
+        }
+
+        for (size_t i = 0, offset = 0; !result && i < 80; offset += snapshot.buffers[i].dataLength, ++i) {
+            if (memcmp(&decompressed[offset], snapshot.buffers[i].data, snapshot.buffers[i].dataLength)) {
+                printf("lz round trip mismatch\n");
+                result = 1;
+            }
+        }
+
+        printf("%23s %8zu %11.1f %8.3f %10.2f %23.2f\n", useDictionary ? "snapshot" : "none", length,
+               (double)total / count, (double)total / count / length, (compress - step) * bench_cycles_per_ns / length,
+               decompress * bench_cycles_per_ns / length);
+
+        enet_lz_destroy(compressor);
+        enet_lz_destroy(decompressor);
+    }
+
+    return result;
+}
+
+/* Returns the address at which a host bound to any address on this machine is reached over loopback. */
+static ENetAddress bench_loopback(enet_uint16 port) {
+    ENetAddress address = {};
+
+    enet_address_set_host(&address, "127.0.0.1");
+    address.port = port;
+
+    return address;
+}
+
+/* Creates count client hosts of one peer each, lets setup configure every host and connects them to
+ * address. With a server, both sides are then serviced until every peer is connected. The clients
+ * are created even if setup fails for some of them, in which case -1 is returned. */
+template <typename Setup>
+static int bench_clients_connect(ENetHost *server, const ENetAddress *address, ENetHost **clients, ENetPeer **peers,
+                                 int count, Setup setup) {
+    ENetEvent event;
+    int       result = 0;
+
+    for (int i = 0; i < count; ++i) {
+        clients[i] = new ENetHost(nullptr, 1, 1, 0, 0);
+        result |= setup(clients[i]);
+        peers[i] = clients[i]->connect(address, 1, 0);
+    }
+
+    for (int connected = 0; server != nullptr && result == 0 && connected < count;) {
+        connected = 0;
+
+        for (int i = 0; i < count; ++i) {
+            clients[i]->service(&event, 0);
+            connected += peers[i]->state == ENetPeerState::CONNECTED;
+        }
+
+        while (server->service(&event, 1) > 0)
+            ;
+    }
+
+    return result < 0 ? -1 : 0;
+}
+
+static int bench_clients_connect(ENetHost *server, const ENetAddress *address, ENetHost **clients, ENetPeer **peers,
+                                 int count) {
+    return bench_clients_connect(server, address, clients, peers, count, [](ENetHost *) { return 0; });
+}
+
+static void bench_clients_destroy(ENetHost **clients, ENetPeer **peers, int count) {
+    for (int i = 0; i < count; ++i) {
+        peers[i]->disconnect_now(0);
+        delete clients[i];
+    }
+}
+
+static void ENET_CALLBACK bench_shard_event(ENetShard *, ENetEvent *event, void *context) {
+    if (event->type == ENetEventType::RECEIVE) {
+        ((std::atomic<size_t> *)context)->fetch_add(1, std::memory_order_relaxed);
+        enet_packet_destroy(event->packet);
+    }
+}
+
+/* Loopback throughput of a sharded host: one client thread per shard, each driving eight clients
+ * that send 64 byte unreliable packets for a second. */
+static int bench_shards() {
+    const size_t maximum = std::max<size_t>(std::thread::hardware_concurrency() / 2, 1);
+
+    printf("shards      clients    packets/s\n");
+
+    for (size_t shardCount = 1; shardCount <= 8 && shardCount <= maximum * 2; shardCount *= 2) {
+        std::atomic<size_t>      received{0};
+        std::atomic<bool>        sending{true};
+        std::vector<std::thread> clients;
+        ENetAddress              address = {};
+
+        address.host = ENET_HOST_ANY;
+
+        ENetShardedHost server(&address, shardCount, 64, 1, 0, 0);
+        if (server.shards.empty() || server.start(bench_shard_event, &received) < 0) {
+            printf("could not start %zu shards\n", shardCount);
+            return 1;
+        }
+
+        address = bench_loopback(server.address.port);
+
+        for (size_t thread = 0; thread < shardCount; ++thread) {
+            clients.emplace_back([&] {
+                static const enet_uint8 payload[64] = {0};
+                ENetHost *hosts[8];
+                ENetPeer *peers[8];
+                ENetEvent event;
+
+                bench_clients_connect(nullptr, &address, hosts, peers, 8);
+
+                while (sending) {
+                    for (int i = 0; i < 8; ++i) {
+                        if (peers[i]->state == ENetPeerState::CONNECTED) {
+                            for (int packet = 0; packet < 16; ++packet) {
+                                peers[i]->send(0, hosts[i]->create_packet(payload, sizeof(payload), 0));
+                            }
+                        }
+
+                        while (hosts[i]->service(&event, 0) > 0) {
+                            if (event.type == ENetEventType::RECEIVE) {
+                                enet_packet_destroy(event.packet);
+                            }
+                        }
+                    }
+                }
+
+                bench_clients_destroy(hosts, peers, 8);
+            });
+        }
+
+        /* let the handshakes settle before counting */
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        size_t start = received;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        size_t count = received - start;
+
+        sending = false;
+        for (auto &client : clients) {
+            client.join();
+        }
+
+        server.stop();
+        printf("%6zu %12zu %12zu\n", shardCount, shardCount * 8, count);
+    }
+
+    return 0;
+}
+
+/* Queues 16 clients x 512 unreliable packets on the server without dispatching them; a few
+ * may be lost on loopback, so the two loops are compared per event. */
+static size_t bench_service_fill(ENetHost *server, ENetHost **clients, ENetPeer **peers) {
+    static const enet_uint8 payload[16] = {0};
+    enet_uint32             received;
+
+    for (int i = 0; i < 16; ++i) {
+        for (int packet = 0; packet < 512; ++packet) {
+            peers[i]->send(0, clients[i]->create_packet(payload, sizeof(payload), 0));
+        }
+
+        clients[i]->flush();
+    }
+
+    do {
+        received = server->totalReceivedPackets;
+        server->service(nullptr, 1);
+    } while (server->totalReceivedPackets != received);
+
+    return 16 * 512;
+}
+
+static int bench_service() {
+    ENetAddress address = {};
+    ENetHost   *clients[16];
+    ENetPeer   *peers[16];
+    ENetEvent   events[256];
+    double      single = 0, batched = 0;
+    size_t      singleCount = 0, batchedCount = 0;
+
+    address.host = ENET_HOST_ANY;
+
+    ENetHost server(&address, 16, 1, 0, 0);
+    address = bench_loopback(server.address.port);
+
+    bench_clients_connect(&server, &address, clients, peers, 16);
+
+    for (int round = 0; round < 40; ++round) {
+        using clock = std::chrono::steady_clock;
+
+        bench_service_fill(&server, clients, peers);
+
+        auto start = clock::now();
+        while (server.service(events, 0) > 0) {
+            enet_packet_destroy(events[0].packet);
+            ++singleCount;
+        }
+        single += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        bench_service_fill(&server, clients, peers);
+
+        start = clock::now();
+        for (int count; (count = server.service_many(events, 256, 0)) > 0;) {
+            for (int i = 0; i < count; ++i) {
+                enet_packet_destroy(events[i].packet);
+            }
+
+            batchedCount += count;
+        }
+        batched += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+
+    printf("service        events   ns/event\n");
+    printf("single %15zu %10.1f\n", singleCount, single / singleCount);
+    printf("service_many %9zu %10.1f\n", batchedCount, batched / batchedCount);
+
+    bench_clients_destroy(clients, peers, 16);
+
+    return 0;
+}
+
+/* Opens a user-space cache miss counter for this thread, or returns -1 where the kernel or
+ * the hardware does not provide one. */
+static int bench_cache_misses_open() {
+#ifdef __linux__
+    perf_event_attr attr = {};
+
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void bench_cache_misses_enable(int counter, bool enable) {
+#ifdef __linux__
+    if (counter >= 0) {
+        ioctl(counter, enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+}
+
+static enet_uint64 bench_cache_misses_read(int counter) {
+    enet_uint64 count = 0;
+
+#ifdef __linux__
+    if (counter >= 0 && read(counter, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+    }
+#endif
+
+    return count;
+}
+
+/* Services a server holding 4095 connected peers, each of which receives one reliable packet
+ * and acknowledges it every pass, and reports the time and the user-space cache misses of the
+ * server per pass. Clients send in groups so that loopback socket buffers do not overflow. */
+static int bench_peers() {
+    constexpr int PEERS = 4095, GROUP = 128, PASSES = 20;
+
+    static const enet_uint8 payload[16] = {0};
+    ENetAddress             address     = {};
+    ENetEvent               event;
+    int                     counter = bench_cache_misses_open();
+    double                  elapsed = 0;
+    size_t                  events  = 0;
+
+    address.host = ENET_HOST_ANY;
+
+    ENetHost server(&address, PEERS, 1, 0, 0);
+    address = bench_loopback(server.address.port);
+
+    ENetHost                client(nullptr, PEERS, 1, 0, 0);
+    std::vector<ENetPeer *> peers;
+
+    for (int connected = 0; connected < PEERS;) {
+        if (peers.size() < PEERS && peers.size() < (size_t) connected + GROUP) {
+            peers.push_back(client.connect(&address, 1, 0));
+            continue;
+        }
+
+        while (client.service(&event, 1) > 0) {
+            connected += event.type == ENetEventType::CONNECT;
+        }
+
+        while (server.service(&event, 0) > 0)
+            ;
+    }
+
+    for (int pass = 0; pass < PASSES; ++pass) {
+        using clock = std::chrono::steady_clock;
+
+        for (int first = 0; first < PEERS; first += GROUP) {
+            for (int i = first; i < first + GROUP && i < PEERS; ++i) {
+                peers[i]->send(0, client.create_packet(payload, sizeof(payload), ENET_PACKET_FLAG_RELIABLE));
+            }
+
+            client.flush();
+
+            bench_cache_misses_enable(counter, true);
+            auto start = clock::now();
+
+            while (server.service(&event, 0) > 0) {
+                enet_packet_destroy(event.packet);
+                ++events;
+            }
+
+            elapsed += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            bench_cache_misses_enable(counter, false);
+
+            while (client.service(&event, 0) > 0)
+                ;
+        }
+    }
+
+    printf("peers   events   ns/pass   ns/event   misses/pass\n");
+    printf("%5d %8zu %9.0f %10.1f ", PEERS, events, elapsed / PASSES, elapsed / events);
+
+    if (counter >= 0) {
+        printf("%13.0f\n", (double) bench_cache_misses_read(counter) / PASSES);
+#ifdef __linux__
+        close(counter);
+#endif
+    } else {
+        printf("%13s\n", "n/a");
+    }
+
+    for (ENetPeer *peer : peers) {
+        peer->disconnect_now(0);
+    }
+
+    return 0;
+}
+
+#ifdef ENET_HAS_IO_URING
+/* Loopback datagram rate of one socket backend for a second: four clients send 1000 byte
+ * unreliable packets, one per datagram, in send batches of 32 to a server draining them with
+ * service_many(). Both ends run on this thread, so the CPU time covers sending and receiving. */
+static int bench_uring_backend(int uring, double *datagramsPerSecond, double *cpuPerDatagram) {
+    static const enet_uint8 payload[1000] = {0};
+    ENetAddress address = {};
+    ENetHost   *clients[4];
+    ENetPeer   *peers[4];
+    ENetEvent   events[256];
+    int         result;
+
+    address.host = ENET_HOST_ANY;
+
+    ENetHost server(&address, 4, 1, 0, 0);
+    address = bench_loopback(server.address.port);
+
+    server.set_receive_batch(32);
+    server.set_send_batch(32);
+    if (server.set_io_uring(uring) < 0) {
+        return -1;
+    }
+
+    result = bench_clients_connect(&server, &address, clients, peers, 4, [uring](ENetHost *client) {
+        client->set_receive_batch(32);
+        client->set_send_batch(32);
+        return client->set_io_uring(uring);
+    });
+
+    if (result == 0) {
+        using clock = std::chrono::steady_clock;
+
+        enet_uint32  received = server.totalReceivedPackets;
+        std::clock_t cpu      = std::clock();
+        auto         start    = clock::now();
+
+        while (clock::now() - start < std::chrono::seconds(1)) {
+            for (int i = 0; i < 4; ++i) {
+                for (int packet = 0; packet < 32; ++packet) {
+                    peers[i]->send(0, clients[i]->create_packet(payload, sizeof(payload), 0));
+                }
+
+                clients[i]->flush();
+            }
+
+            for (int count; (count = server.service_many(events, 256, 0)) > 0;) {
+                for (int i = 0; i < count; ++i) {
+                    if (events[i].type == ENetEventType::RECEIVE) {
+                        enet_packet_destroy(events[i].packet);
+                    }
+                }
+            }
+
+            for (int i = 0; i < 4; ++i) {
+                while (clients[i]->service(events, 0) > 0)
+                    ;
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        size_t count   = server.totalReceivedPackets - received;
+
+        *datagramsPerSecond = count / seconds;
+        *cpuPerDatagram     = (std::clock() - cpu) * (1e9 / CLOCKS_PER_SEC) / std::max<size_t>(count, 1);
+    }
+
+    bench_clients_destroy(clients, peers, 4);
+
+    return result;
+}
+#endif
+
+/* Compares the recvmmsg/sendmmsg path with the io_uring backend, see ENetHost::set_io_uring(). */
+static int bench_uring() {
+#ifdef ENET_HAS_IO_URING
+    static const char *const names[] = {"recvmmsg", "io_uring"};
+
+    printf("backend     datagrams/s   cpu ns/datagram\n");
+
+    for (int uring = 0; uring < 2; ++uring) {
+        double rate, cpu;
+
+        if (bench_uring_backend(uring, &rate, &cpu) < 0) {
+            printf("%-8s %14s %17s\n", names[uring], "n/a", "n/a");
+            continue;
+        }
+
+        printf("%-8s %14.0f %17.0f\n", names[uring], rate, cpu);
+    }
+#else
+    printf("io_uring is not available\n");
+#endif
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (enet_initialize() != 0) {
+        printf("An error occurred while initializing ENet.\n");
+        return 1;
+    }
+
+    const char *only   = argc > 1 ? argv[1] : nullptr;
+    int         result = 0;
+
+    bench_calibrate();
+
+    if (only == nullptr || !strcmp(only, "crc32")) {
+        result |= bench_crc32();
+    }
+
+    if (only == nullptr || !strcmp(only, "lz")) {
+        result |= bench_lz();
+    }
+
+    if (only == nullptr || !strcmp(only, "service")) {
+        result |= bench_service();
+    }
+
+    if (only == nullptr || !strcmp(only, "peers")) {
+        result |= bench_peers();
+    }
+
+    if (only == nullptr || !strcmp(only, "shards")) {
+        result |= bench_shards();
+    }
+
+    if (only == nullptr || !strcmp(only, "uring")) {
+        result |= bench_uring();
+    }
+
+    enet_deinitialize();
+    return result;
+}